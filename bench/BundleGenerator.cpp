@@ -0,0 +1,264 @@
+#include "BundleGenerator.h"
+#include <algorithm>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // std::mt19937_64 output is fixed by the standard, but the <random>
+    // distributions are not, so values are derived from the raw engine output
+    // to keep bundles identical across standard libraries.
+    class Rng
+    {
+    public:
+        explicit Rng(std::uint64_t seed) : engine_(seed) {}
+
+        std::uint64_t next() { return engine_(); }
+        std::size_t below(std::size_t n) { return n ? static_cast<std::size_t>(next() % n) : 0; }
+        double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+        bool chance(double p) { return unit() < p; }
+
+    private:
+        std::mt19937_64 engine_;
+    };
+
+    const char *const kEnumValues[] = {"alpha", "beta", "gamma", "delta"};
+    const char *const kWords[] = {"north", "south", "east", "west", "solar", "smart", "quiet", "rapid"};
+
+    void emitObjectValue(std::ostringstream &out, Rng &rng, const std::string &indent)
+    {
+        out << indent << "label: " << kWords[rng.below(8)] << "-" << rng.below(1000) << "\n"
+            << indent << "count: " << rng.below(100) << "\n"
+            << indent << "ratio: " << std::fixed << std::setprecision(2) << rng.unit() * 100.0 << "\n";
+        out.unsetf(std::ios::floatfield);
+    }
+}
+
+BundleGenerator::BundleGenerator(BundleGeneratorConfig config)
+    : config_(std::move(config))
+{
+    if (config_.depth == 0)
+        throw std::runtime_error("BundleGenerator requires depth >= 1");
+    if (config_.entitiesPerFile == 0)
+        throw std::runtime_error("BundleGenerator requires entitiesPerFile >= 1");
+}
+
+std::string BundleGenerator::schemaName(std::size_t level)
+{
+    return "Level" + std::to_string(level);
+}
+
+FieldMix BundleGenerator::parseFieldMix(const std::string &spec)
+{
+    FieldMix mix{0, 0, 0, 0, 0, 0, 0, 0};
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        auto eq = item.find('=');
+        if (eq == std::string::npos)
+            throw std::runtime_error("Invalid field mix entry '" + item + "', expected type=count");
+
+        std::string type = item.substr(0, eq);
+        std::size_t count = std::stoull(item.substr(eq + 1));
+
+        if (type == "string")
+            mix.strings = count;
+        else if (type == "integer")
+            mix.integers = count;
+        else if (type == "float")
+            mix.floats = count;
+        else if (type == "boolean")
+            mix.booleans = count;
+        else if (type == "enum")
+            mix.enums = count;
+        else if (type == "object")
+            mix.objects = count;
+        else if (type == "array")
+            mix.arrays = count;
+        else if (type == "reference")
+            mix.references = count;
+        else
+            throw std::runtime_error("Unknown field type in mix: " + type);
+    }
+    return mix;
+}
+
+std::string BundleGenerator::buildSchema(std::size_t level) const
+{
+    const FieldMix &mix = config_.fields;
+    std::ostringstream out;
+
+    out << (level == 0 ? "profile_name: " : "entity_name: ") << schemaName(level) << "\n";
+    if (level + 1 < config_.depth)
+    {
+        out << "children:\n"
+            << "  items:\n"
+            << "    entity: " << schemaName(level + 1) << "\n";
+    }
+
+    out << "fields:\n"
+        << "  name:\n"
+        << "    type: string\n"
+        << "    required: true\n";
+    for (std::size_t i = 0; i < mix.strings; ++i)
+        out << "  str" << i << ":\n    type: string\n";
+    for (std::size_t i = 0; i < mix.integers; ++i)
+        out << "  int" << i << ":\n    type: integer\n    min: 0\n    max: 1000000\n";
+    for (std::size_t i = 0; i < mix.floats; ++i)
+        out << "  float" << i << ":\n    type: float\n";
+    for (std::size_t i = 0; i < mix.booleans; ++i)
+        out << "  bool" << i << ":\n    type: boolean\n";
+    for (std::size_t i = 0; i < mix.enums; ++i)
+        out << "  enum" << i << ":\n    type: enum\n    values: [alpha, beta, gamma, delta]\n";
+    for (std::size_t i = 0; i < mix.objects; ++i)
+    {
+        out << "  obj" << i << ":\n"
+            << "    type: object\n"
+            << "    fields:\n"
+            << "      label:\n        type: string\n"
+            << "      count:\n        type: integer\n"
+            << "      ratio:\n        type: float\n";
+    }
+    for (std::size_t i = 0; i < mix.arrays; ++i)
+    {
+        out << "  list" << i << ":\n"
+            << "    type: array\n"
+            << "    element:\n"
+            << "      type: object\n"
+            << "      fields:\n"
+            << "        label:\n          type: string\n"
+            << "        count:\n          type: integer\n"
+            << "        ratio:\n          type: float\n";
+    }
+    for (std::size_t i = 0; i < mix.references; ++i)
+        out << "  ref" << i << ":\n    type: reference\n    target: " << schemaName(level) << "\n";
+
+    return out.str();
+}
+
+GeneratedBundle BundleGenerator::generate() const
+{
+    const FieldMix &mix = config_.fields;
+    Rng rng(config_.seed);
+
+    GeneratedBundle bundle;
+    bundle.idsByLevel.resize(config_.depth);
+    bundle.ids.reserve(config_.entityCount);
+    for (std::size_t level = 0; level < config_.depth; ++level)
+    {
+        bundle.schemaNames.push_back(schemaName(level));
+        bundle.schemas["level" + std::to_string(level) + ".yaml"] = buildSchema(level);
+    }
+
+    std::ostringstream out;
+    std::size_t inFile = 0;
+    // Ids already emitted in the current file, per level, so references only
+    // point at entities that precede them in load order.
+    std::vector<std::vector<std::string>> fileIdsByLevel(config_.depth);
+
+    auto flush = [&]()
+    {
+        if (inFile == 0)
+            return;
+        std::ostringstream name;
+        name << "data_" << std::setw(5) << std::setfill('0') << bundle.data.size() << ".yaml";
+        bundle.data[name.str()] = out.str();
+        out.str("");
+        out.clear();
+        inFile = 0;
+        for (auto &ids : fileIdsByLevel)
+            ids.clear();
+    };
+
+    auto emitEntity = [&](std::size_t level, const std::string &id, const std::string &parentId)
+    {
+        out << id << ":\n"
+            << "  _schema: " << schemaName(level) << "\n";
+        if (!parentId.empty())
+            out << "  _parentid: " << parentId << "\n";
+        out << "  name: " << kWords[rng.below(8)] << " " << id << "\n";
+
+        for (std::size_t i = 0; i < mix.strings; ++i)
+            out << "  str" << i << ": " << kWords[rng.below(8)] << "-" << rng.below(100000) << "\n";
+        for (std::size_t i = 0; i < mix.integers; ++i)
+            out << "  int" << i << ": " << rng.below(1000001) << "\n";
+        for (std::size_t i = 0; i < mix.floats; ++i)
+        {
+            out << "  float" << i << ": " << std::fixed << std::setprecision(3) << rng.unit() * 1000.0 << "\n";
+            out.unsetf(std::ios::floatfield);
+        }
+        for (std::size_t i = 0; i < mix.booleans; ++i)
+            out << "  bool" << i << ": " << (rng.chance(0.5) ? "true" : "false") << "\n";
+        for (std::size_t i = 0; i < mix.enums; ++i)
+            out << "  enum" << i << ": " << kEnumValues[rng.below(4)] << "\n";
+        for (std::size_t i = 0; i < mix.objects; ++i)
+        {
+            out << "  obj" << i << ":\n";
+            emitObjectValue(out, rng, "    ");
+        }
+        for (std::size_t i = 0; i < mix.arrays; ++i)
+        {
+            std::size_t length = rng.below(4);
+            if (length == 0)
+            {
+                out << "  list" << i << ": []\n";
+                continue;
+            }
+            out << "  list" << i << ":\n";
+            for (std::size_t e = 0; e < length; ++e)
+            {
+                std::ostringstream element;
+                emitObjectValue(element, rng, "      ");
+                std::string text = element.str();
+                text.replace(0, 6, "    - ");
+                out << text;
+            }
+        }
+        auto &candidates = fileIdsByLevel[level];
+        for (std::size_t i = 0; i < mix.references; ++i)
+        {
+            if (!candidates.empty() && rng.chance(config_.referenceDensity))
+                out << "  ref" << i << ": " << candidates[rng.below(candidates.size())] << "\n";
+        }
+        out << "\n";
+
+        candidates.push_back(id);
+        bundle.ids.push_back(id);
+        bundle.idsByLevel[level].push_back(id);
+        if (++inFile >= config_.entitiesPerFile)
+            flush();
+    };
+
+    // Depth-first emission of complete subtrees until the entity budget runs out.
+    struct Pending
+    {
+        std::size_t level;
+        std::string id;
+        std::string parentId;
+    };
+    std::vector<Pending> stack;
+    std::size_t root = 0;
+    while (bundle.ids.size() < config_.entityCount)
+    {
+        stack.push_back({0, "e" + std::to_string(root++), ""});
+        while (!stack.empty() && bundle.ids.size() < config_.entityCount)
+        {
+            Pending current = std::move(stack.back());
+            stack.pop_back();
+            emitEntity(current.level, current.id, current.parentId);
+
+            if (current.level + 1 < config_.depth)
+            {
+                for (std::size_t c = config_.fanOut; c-- > 0;)
+                    stack.push_back({current.level + 1, current.id + "_" + std::to_string(c), current.id});
+            }
+        }
+        stack.clear();
+    }
+    flush();
+
+    return bundle;
+}
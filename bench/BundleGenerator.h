@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Number of fields of each type generated on every entity schema, in addition
+// to the required `name` string.
+struct FieldMix
+{
+    std::size_t strings = 1;
+    std::size_t integers = 1;
+    std::size_t floats = 1;
+    std::size_t booleans = 1;
+    std::size_t enums = 1;
+    std::size_t objects = 1;
+    std::size_t arrays = 1; // arrays of objects
+    std::size_t references = 1;
+};
+
+struct BundleGeneratorConfig
+{
+    std::size_t entityCount = 1000;
+    std::size_t depth = 3;          // schema levels, Level0 is the root profile
+    std::size_t fanOut = 4;         // children per entity on every non-leaf level
+    double referenceDensity = 0.5;  // probability that a reference field is set
+    std::size_t entitiesPerFile = 10000;
+    std::uint64_t seed = 42;
+    FieldMix fields;
+};
+
+struct GeneratedBundle
+{
+    std::unordered_map<std::string, std::string> schemas;
+    std::unordered_map<std::string, std::string> data;
+    std::vector<std::string> schemaNames;              // index == level
+    std::vector<std::string> ids;                      // emission order
+    std::vector<std::vector<std::string>> idsByLevel;  // index == level
+};
+
+// Emits YAML schema and data bundles shaped like examples/schemas and
+// examples/data, deterministically from the configured seed.
+class BundleGenerator
+{
+public:
+    explicit BundleGenerator(BundleGeneratorConfig config);
+
+    GeneratedBundle generate() const;
+
+    static std::string schemaName(std::size_t level);
+    static FieldMix parseFieldMix(const std::string &spec);
+
+private:
+    std::string buildSchema(std::size_t level) const;
+
+    BundleGeneratorConfig config_;
+};
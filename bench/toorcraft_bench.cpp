@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include <nlohmann/json.hpp>
+#include "SchemaManager.h"
+#include "EntityManager.h"
+#include "ToorCraftEngine.h"
+#include "ToorCraftJSON.h"
+#include "BundleGenerator.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::vector<std::size_t> sizes = {1000, 10000, 100000};
+        std::size_t ops = 10000;
+        BundleGeneratorConfig generator;
+        std::string outPath;
+    };
+
+    long peakRssKb()
+    {
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss; // kilobytes on Linux
+    }
+
+    // Runs `op` `count` times and reports throughput plus p50/p99 latency.
+    json measure(std::size_t count, const std::function<void(std::size_t)> &op)
+    {
+        std::vector<double> latenciesNs;
+        latenciesNs.reserve(count);
+
+        auto begin = Clock::now();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto start = Clock::now();
+            op(i);
+            latenciesNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+        double totalSec = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        auto percentile = [&](double p)
+        {
+            if (latenciesNs.empty())
+                return 0.0;
+            std::size_t idx = static_cast<std::size_t>(p * static_cast<double>(latenciesNs.size() - 1));
+            std::nth_element(latenciesNs.begin(), latenciesNs.begin() + idx, latenciesNs.end());
+            return latenciesNs[idx];
+        };
+
+        json result;
+        result["ops"] = count;
+        result["total_ms"] = totalSec * 1e3;
+        result["ops_per_sec"] = totalSec > 0 ? static_cast<double>(count) / totalSec : 0.0;
+        result["p50_us"] = percentile(0.50) / 1e3;
+        result["p99_us"] = percentile(0.99) / 1e3;
+        return result;
+    }
+
+    void expectOk(const std::string &response, const char *what)
+    {
+        if (json::parse(response)["status"] != "ok")
+            throw std::runtime_error(std::string(what) + " failed: " + response);
+    }
+
+    json runSize(std::size_t entityCount, const BenchOptions &options)
+    {
+        auto &engine = ToorCraftEngine::instance();
+        auto &api = ToorCraftJSON::instance();
+        std::mt19937_64 rng(options.generator.seed);
+
+        json result;
+        result["entities"] = entityCount;
+
+        BundleGeneratorConfig config = options.generator;
+        config.entityCount = entityCount;
+        GeneratedBundle bundle = BundleGenerator(config).generate();
+
+        std::size_t bytes = 0;
+        for (const auto &pair : bundle.data)
+            bytes += pair.second.size();
+        result["data_bytes"] = bytes;
+        result["data_files"] = bundle.data.size();
+
+        json ops;
+        ops["parseSchemaBundle"] = measure(100, [&](std::size_t)
+                                           { SchemaManager::instance().parseSchemaBundle(bundle.schemas); });
+
+        ops["parseDataBundle"] = measure(1, [&](std::size_t)
+                                         { EntityManager::instance().parseDataBundle(bundle.data); });
+        ops["parseDataBundle"]["entities_per_sec"] =
+            static_cast<double>(entityCount) / (ops["parseDataBundle"]["total_ms"].get<double>() / 1e3);
+        result["rss_after_load_kb"] = peakRssKb();
+
+        auto pick = [&](const std::vector<std::string> &ids) -> const std::string &
+        {
+            return ids[rng() % ids.size()];
+        };
+
+        const std::size_t leafLevel = bundle.idsByLevel.size() - 1;
+        const auto &leafIds = bundle.idsByLevel[leafLevel];
+        const std::vector<std::string> *parentIds = leafLevel > 0 ? &bundle.idsByLevel[leafLevel - 1] : nullptr;
+
+        ops["queryEntity"] = measure(options.ops, [&](std::size_t)
+                                     {
+            if (!engine.queryEntity(pick(bundle.ids)))
+                throw std::runtime_error("queryEntity returned null"); });
+
+        ops["json.queryEntity"] = measure(options.ops, [&](std::size_t)
+                                          { expectOk(api.queryEntity(pick(bundle.ids)), "queryEntity"); });
+
+        ops["setField"] = measure(options.ops, [&](std::size_t i)
+                                  { engine.setField(pick(bundle.ids), "name", "Renamed " + std::to_string(i)); });
+
+        ops["createEntity"] = measure(options.ops, [&](std::size_t i)
+                                      {
+            std::unordered_map<std::string, std::string> fields = {{"name", "Bench " + std::to_string(i)}};
+            if (config.fields.arrays > 0)
+                fields["list0"] = R"([{"label":"bench","count":1,"ratio":1.5}])";
+            std::string parentId = parentIds && !parentIds->empty() ? pick(*parentIds) : "";
+            engine.createEntity(bundle.schemaNames[leafLevel], "bench_new_" + std::to_string(i), parentId, fields); });
+
+        if (!leafIds.empty())
+        {
+            std::vector<std::string> victims = leafIds;
+            std::shuffle(victims.begin(), victims.end(), rng);
+            std::size_t deletes = std::min(options.ops, victims.size());
+            ops["deleteEntity"] = measure(deletes, [&](std::size_t i)
+                                          { engine.deleteEntity(victims[i]); });
+        }
+
+        // getTree serializes the whole store, so scale the repetitions down with size.
+        std::size_t treeRuns = std::max<std::size_t>(1, std::min<std::size_t>(20, 1000000 / entityCount));
+        ops["json.getTree"] = measure(treeRuns, [&](std::size_t)
+                                      { expectOk(api.getTree(), "getTree"); });
+
+        result["peak_rss_kb"] = peakRssKb();
+
+        ops["clear"] = measure(1, [&](std::size_t)
+                               { EntityManager::instance().clear(); });
+        result["ops"] = ops;
+        return result;
+    }
+
+    std::vector<std::size_t> parseSizes(const std::string &list)
+    {
+        std::vector<std::size_t> sizes;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            if (!item.empty())
+                sizes.push_back(static_cast<std::size_t>(std::stod(item)));
+        }
+        return sizes;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc)
+        {
+            options.sizes = parseSizes(argv[++i]);
+        }
+        else if (arg == "--full")
+        {
+            options.sizes = {1000, 10000, 100000, 1000000, 10000000};
+        }
+        else if (arg == "--ops" && i + 1 < argc)
+        {
+            options.ops = std::stoull(argv[++i]);
+        }
+        else if (arg == "--entities-per-file" && i + 1 < argc)
+        {
+            options.generator.entitiesPerFile = std::max<std::size_t>(1, std::stoull(argv[++i]));
+        }
+        else if (arg == "--depth" && i + 1 < argc)
+        {
+            options.generator.depth = std::max<std::size_t>(1, std::stoull(argv[++i]));
+        }
+        else if (arg == "--fanout" && i + 1 < argc)
+        {
+            options.generator.fanOut = std::stoull(argv[++i]);
+        }
+        else if (arg == "--fields" && i + 1 < argc)
+        {
+            options.generator.fields = BundleGenerator::parseFieldMix(argv[++i]);
+        }
+        else if (arg == "--ref-density" && i + 1 < argc)
+        {
+            options.generator.referenceDensity = std::stod(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.generator.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            options.outPath = argv[++i];
+        }
+        else if (arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " [--sizes 1e3,1e4,...] [--full] [--ops N] [--out file.json]\n"
+                      << "       [--depth N] [--fanout N] [--fields type=count,...] [--ref-density 0..1]\n"
+                      << "       [--entities-per-file N] [--seed N]   (generator options, see toorcraft-gen)\n";
+            return 0;
+        }
+    }
+
+    json report;
+    report["benchmark"] = "toorcraft-bench";
+    report["seed"] = options.generator.seed;
+    report["results"] = json::array();
+
+    try
+    {
+        for (std::size_t size : options.sizes)
+        {
+            std::cerr << "running " << size << " entities..." << std::endl;
+            report["results"].push_back(runSize(size, options));
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << R"({"status": "error", "message": ")" << ex.what() << "\"}" << std::endl;
+        return 1;
+    }
+
+    report["peak_rss_kb"] = peakRssKb();
+
+    if (options.outPath.empty())
+    {
+        std::cout << report.dump(2) << std::endl;
+    }
+    else
+    {
+        std::ofstream out(options.outPath);
+        out << report.dump(2) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "BundleGenerator.h"
+
+namespace fs = std::filesystem;
+
+static void writeBundle(const fs::path &dir, const std::unordered_map<std::string, std::string> &files)
+{
+    fs::create_directories(dir);
+    for (const auto &[name, content] : files)
+    {
+        std::ofstream out(dir / name, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("Cannot write " + (dir / name).string());
+        out << content;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    BundleGeneratorConfig config;
+    fs::path outDir;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--entities" && i + 1 < argc)
+                config.entityCount = static_cast<std::size_t>(std::stod(argv[++i]));
+            else if (arg == "--depth" && i + 1 < argc)
+                config.depth = std::stoull(argv[++i]);
+            else if (arg == "--fanout" && i + 1 < argc)
+                config.fanOut = std::stoull(argv[++i]);
+            else if (arg == "--fields" && i + 1 < argc)
+                config.fields = BundleGenerator::parseFieldMix(argv[++i]);
+            else if (arg == "--ref-density" && i + 1 < argc)
+                config.referenceDensity = std::stod(argv[++i]);
+            else if (arg == "--entities-per-file" && i + 1 < argc)
+                config.entitiesPerFile = std::stoull(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc)
+                config.seed = std::stoull(argv[++i]);
+            else if (arg == "--out" && i + 1 < argc)
+                outDir = argv[++i];
+            else if (arg == "--help")
+            {
+                std::cout << "Usage: " << argv[0] << " --out <dir> [--entities N] [--depth N] [--fanout N]\n"
+                          << "       [--fields string=1,integer=1,float=1,boolean=1,enum=1,object=1,array=1,reference=1]\n"
+                          << "       [--ref-density 0..1] [--entities-per-file N] [--seed N]\n"
+                          << "Writes <dir>/schemas and <dir>/data, loadable with toorcraft-cli --schemas/--data.\n";
+                return 0;
+            }
+        }
+
+        if (outDir.empty())
+        {
+            std::cerr << R"({"status": "error", "message": "Usage: toorcraft-gen --out <dir> [options]"})" << std::endl;
+            return 1;
+        }
+
+        GeneratedBundle bundle = BundleGenerator(config).generate();
+        writeBundle(outDir / "schemas", bundle.schemas);
+        writeBundle(outDir / "data", bundle.data);
+
+        nlohmann::json summary;
+        summary["status"] = "ok";
+        summary["entities"] = bundle.ids.size();
+        summary["schemas"] = bundle.schemaNames;
+        summary["dataFiles"] = bundle.data.size();
+        summary["seed"] = config.seed;
+        std::cout << summary.dump(2) << std::endl;
+    }
+    catch (const std::exception &ex)
+    {
+        nlohmann::json error = {{"status", "error"}, {"message", ex.what()}};
+        std::cerr << error.dump() << std::endl;
+        return 1;
+    }
+    return 0;
+}
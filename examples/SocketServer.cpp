@@ -0,0 +1,316 @@
+#include "SocketServer.h"
+#include "ToorCraftRouter.h"
+#include "ToorCraftJSON.h"
+#include "ToorCraftEngine.h"
+#include <stdexcept>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define TOORCRAFT_HAS_SOCKETS 1
+#endif
+
+#ifdef TOORCRAFT_HAS_SOCKETS
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+    int wakeFds[2] = {-1, -1};
+
+    void onSignal(int)
+    {
+        const char byte = 1;
+        ssize_t ignored = write(wakeFds[1], &byte, 1);
+        (void)ignored;
+    }
+
+    struct Connection
+    {
+        explicit Connection(int socketFd) : fd(socketFd) {}
+        ~Connection() { close(fd); }
+
+        const int fd;
+        std::string input; // received bytes not yet split into lines; poll thread only
+
+        std::mutex mutex;
+        std::deque<std::string> pending; // complete requests not yet run
+        bool busy = false;               // queued for, or owned by, a worker
+    };
+
+    // Connections with pending requests. A connection is in the queue at most
+    // once (guarded by its `busy` flag), so its requests run in order.
+    class WorkQueue
+    {
+    public:
+        void push(std::shared_ptr<Connection> connection)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(connection));
+            }
+            ready_.notify_one();
+        }
+
+        // Returns nullptr once stopped.
+        std::shared_ptr<Connection> pop()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]
+                        { return stopped_ || !queue_.empty(); });
+            if (stopped_)
+                return nullptr;
+            auto connection = std::move(queue_.front());
+            queue_.pop_front();
+            return connection;
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            ready_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::deque<std::shared_ptr<Connection>> queue_;
+        bool stopped_ = false;
+    };
+
+    bool sendAll(int fd, const std::string &data)
+    {
+        std::size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // Holding the store lock across the whole request also keeps a batch, or
+    // a command registered outside the engine, atomic.
+    std::string runRequest(ToorCraftRouter &router, const StoreLock &storeLock, const std::string &line)
+    {
+        nlohmann::json request;
+        try
+        {
+            request = nlohmann::json::parse(line);
+        }
+        catch (const std::exception &)
+        {
+            return router.handleRequest(line); // renders the parse error
+        }
+
+        if (router.isReadOnly(request))
+        {
+            StoreLock::ReadGuard guard(storeLock);
+            return router.handleParsedRequest(request);
+        }
+        StoreLock::WriteGuard guard(storeLock);
+        return router.handleParsedRequest(request);
+    }
+
+    // Runs one request per turn and requeues the connection if it has more,
+    // so a client streaming requests cannot starve the others.
+    void runWorker(ToorCraftRouter &router, const StoreLock &storeLock, WorkQueue &queue)
+    {
+        ToorCraftJSON::CompactOutput compact;
+        while (auto connection = queue.pop())
+        {
+            std::string line;
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                line = std::move(connection->pending.front());
+                connection->pending.pop_front();
+            }
+
+            std::string response = runRequest(router, storeLock, line);
+            response += '\n';
+            sendAll(connection->fd, response); // a client that left just loses its responses
+
+            bool more;
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                more = !connection->pending.empty();
+                connection->busy = more;
+            }
+            if (more)
+                queue.push(std::move(connection));
+        }
+    }
+
+    void splitLines(Connection &connection, std::vector<std::string> &lines)
+    {
+        std::size_t start = 0;
+        std::size_t end;
+        while ((end = connection.input.find('\n', start)) != std::string::npos)
+        {
+            std::size_t length = end - start;
+            if (length > 0 && connection.input[end - 1] == '\r')
+                --length;
+            if (length > 0)
+                lines.emplace_back(connection.input, start, length);
+            start = end + 1;
+        }
+        connection.input.erase(0, start);
+    }
+}
+
+SocketServer::SocketServer(ToorCraftRouter &router, ToorCraftEngine &engine, std::size_t workers)
+    : router_(router), engine_(engine), workers_(workers == 0 ? 1 : workers) {}
+
+void SocketServer::serve(const std::string &socketPath)
+{
+    sockaddr_un address{};
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Invalid socket path: " + socketPath);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0)
+    {
+        const std::string error = std::strerror(errno);
+        close(listenFd);
+        throw std::runtime_error("Cannot listen on " + socketPath + ": " + error);
+    }
+
+    if (pipe(wakeFds) < 0)
+    {
+        close(listenFd);
+        throw std::runtime_error(std::string("pipe: ") + std::strerror(errno));
+    }
+    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    struct sigaction previousInt{}, previousTerm{};
+    sigaction(SIGINT, &action, &previousInt);
+    sigaction(SIGTERM, &action, &previousTerm);
+
+    const StoreLock &storeLock = engine_.storeLock();
+    WorkQueue queue;
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < workers_; ++i)
+        workers.emplace_back(runWorker, std::ref(router_), std::cref(storeLock), std::ref(queue));
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+    std::vector<pollfd> fds;
+    std::vector<std::string> lines;
+    std::vector<char> buffer(64 * 1024);
+
+    while (true)
+    {
+        fds.clear();
+        fds.push_back({wakeFds[0], POLLIN, 0});
+        fds.push_back({listenFd, POLLIN, 0});
+        for (const auto &entry : connections)
+            fds.push_back({entry.first, POLLIN, 0});
+
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[0].revents)
+            break;
+
+        if (fds[1].revents & POLLIN)
+        {
+            int client = accept(listenFd, nullptr, nullptr);
+            if (client >= 0)
+                connections.emplace(client, std::make_shared<Connection>(client));
+        }
+
+        for (std::size_t i = 2; i < fds.size(); ++i)
+        {
+            if (!fds[i].revents)
+                continue;
+
+            auto it = connections.find(fds[i].fd);
+            ssize_t n = recv(it->first, buffer.data(), buffer.size(), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                // Requests already received still run; the socket closes
+                // when the last worker lets go of the connection.
+                connections.erase(it);
+                continue;
+            }
+
+            Connection &connection = *it->second;
+            connection.input.append(buffer.data(), static_cast<std::size_t>(n));
+            lines.clear();
+            splitLines(connection, lines);
+            if (lines.empty())
+                continue;
+
+            bool schedule;
+            {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                for (auto &line : lines)
+                    connection.pending.push_back(std::move(line));
+                schedule = !connection.busy;
+                connection.busy = true;
+            }
+            if (schedule)
+                queue.push(it->second);
+        }
+    }
+
+    queue.stop();
+    for (auto &worker : workers)
+        worker.join();
+    connections.clear();
+
+    sigaction(SIGINT, &previousInt, nullptr);
+    sigaction(SIGTERM, &previousTerm, nullptr);
+    close(wakeFds[0]);
+    close(wakeFds[1]);
+    wakeFds[0] = wakeFds[1] = -1;
+    close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+#else
+
+SocketServer::SocketServer(ToorCraftRouter &router, ToorCraftEngine &engine, std::size_t workers)
+    : router_(router), engine_(engine), workers_(workers) {}
+
+void SocketServer::serve(const std::string &)
+{
+    throw std::runtime_error("--serve is not supported on this platform");
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+class ToorCraftEngine;
+class ToorCraftRouter;
+
+// Serves ToorCraftRouter over a Unix domain socket using the --stream
+// protocol: each client sends one JSON request per line and receives one
+// compact JSON response line per request, in order.
+//
+// One thread polls the listening socket and all clients and splits their
+// input into requests; a pool of workers runs them. Requests of one client
+// run one at a time, requests of different clients in parallel. Read-only
+// requests (see ToorCraftRouter::isReadOnly) share the engine, mutations
+// run exclusively.
+class SocketServer
+{
+public:
+    // `router` must route to `engine`, whose store lock the server takes.
+    SocketServer(ToorCraftRouter &router, ToorCraftEngine &engine, std::size_t workers);
+
+    // Binds `socketPath` (replacing a stale socket file) and serves until
+    // SIGINT or SIGTERM, then removes the socket file. Throws if the socket
+    // cannot be set up or the platform has no Unix sockets.
+    void serve(const std::string &socketPath);
+
+private:
+    ToorCraftRouter &router_;
+    ToorCraftEngine &engine_;
+    std::size_t workers_;
+};
@@ -1,11 +1,16 @@
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <nlohmann/json.hpp>
 #include "ToorCraftRouter.h"
+#include "ToorCraftEngine.h"
+#include "ToorCraftJSON.h"
+#include "SocketServer.h"
 
 namespace fs = std::filesystem;
 
@@ -30,7 +35,13 @@ int main(int argc, char *argv[])
 {
     fs::path schemaDir;
     fs::path dataDir;
+    fs::path snapshotPath;
     bool interactive = false;
+    bool stream = false;
+    std::size_t flushEvery = 0;
+    std::string servePath;
+    std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    double autoPurge = 0;
 
     // --- Parse CLI arguments ---
     for (int i = 1; i < argc; ++i)
@@ -44,17 +55,58 @@ int main(int argc, char *argv[])
         {
             dataDir = argv[++i];
         }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            snapshotPath = argv[++i];
+        }
         else if (arg == "--interactive")
         {
             interactive = true;
         }
+        else if (arg == "--stream")
+        {
+            stream = true;
+        }
+        else if (arg == "--flush-every" && i + 1 < argc)
+        {
+            flushEvery = std::stoull(argv[++i]);
+        }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            servePath = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workers = std::stoull(argv[++i]);
+        }
+        else if (arg == "--auto-purge" && i + 1 < argc)
+        {
+            autoPurge = std::stod(argv[++i]);
+        }
         else if (arg == "--help")
         {
-            std::cout << "Usage: " << argv[0] << " --schemas <path> --data <path> [--interactive]\n";
+            std::cout << "Usage: " << argv[0] << " --schemas <path> --data <path> [--snapshot <file>] [--auto-purge R]\n"
+                      << "       [--interactive | --stream [--flush-every N] | --serve <socket> [--workers N]]\n"
+                      << "  --snapshot  open <file> if it was built from the same schemas and data,\n"
+                      << "              otherwise load the YAML and write <file> for the next run\n"
+                      << "  --stream    read one JSON request per line and write one compact response\n"
+                      << "              line each; output is flushed when no input is pending, or\n"
+                      << "              every N responses with --flush-every N\n"
+                      << "  --serve     keep the engine loaded and serve the --stream protocol to any\n"
+                      << "              number of clients on a Unix socket; read-only requests run\n"
+                      << "              in parallel on N workers, mutations one at a time\n"
+                      << "  --auto-purge free deleted entities once they exceed fraction R of the\n"
+                      << "              store; the purgeDeleted command still lists their ids\n";
             return 0;
         }
     }
 
+    if (stream)
+    {
+        // Lets std::cin buffer ahead, so pending input can be detected below.
+        std::ios::sync_with_stdio(false);
+    }
+
     if (schemaDir.empty() || dataDir.empty())
     {
         std::cerr << R"({"status": "error", "message": "Usage: toorcraft-cli --schemas <path> --data <path>"})" << std::endl;
@@ -81,32 +133,77 @@ int main(int argc, char *argv[])
 
     // --- Use Router for everything ---
     auto &router = ToorCraftRouter::instance();
+    auto &engine = ToorCraftEngine::instance();
 
-    // ✅ Load schemas
-    nlohmann::json loadSchemasReq;
-    loadSchemasReq["command"] = "loadSchemas";
-    loadSchemasReq["schemas"] = schemas;
+    bool fromSnapshot = false;
+    if (!snapshotPath.empty())
+    {
+        try
+        {
+            fromSnapshot = engine.openSnapshot(snapshotPath.string(), schemas, data);
+        }
+        catch (const std::exception &ex)
+        {
+            // A corrupt snapshot is only a cache miss; it is rewritten below.
+            std::cerr << nlohmann::json{{"status", "warning"}, {"message", ex.what()}}.dump() << std::endl;
+        }
+    }
 
-    auto schemaRespJson = nlohmann::json::parse(router.handleRequest(loadSchemasReq.dump()));
-    if (schemaRespJson["status"] == "error")
+    if (!fromSnapshot)
     {
-        std::cerr << schemaRespJson.dump(2) << std::endl;
-        return 1;
+        // ✅ Load schemas
+        nlohmann::json loadSchemasReq;
+        loadSchemasReq["command"] = "loadSchemas";
+        loadSchemasReq["schemas"] = schemas;
+
+        auto schemaRespJson = nlohmann::json::parse(router.handleRequest(loadSchemasReq.dump()));
+        if (schemaRespJson["status"] == "error")
+        {
+            std::cerr << schemaRespJson.dump(2) << std::endl;
+            return 1;
+        }
+
+        // ✅ Load data
+        nlohmann::json loadDataReq;
+        loadDataReq["command"] = "loadData";
+        loadDataReq["data"] = data;
+
+        auto dataRespJson = nlohmann::json::parse(router.handleRequest(loadDataReq.dump()));
+        if (dataRespJson["status"] == "error")
+        {
+            std::cerr << dataRespJson.dump(2) << std::endl;
+            return 1;
+        }
+
+        if (!snapshotPath.empty())
+        {
+            try
+            {
+                engine.saveSnapshot(snapshotPath.string());
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << nlohmann::json{{"status", "warning"}, {"message", ex.what()}}.dump() << std::endl;
+            }
+        }
     }
 
-    // ✅ Load data
-    nlohmann::json loadDataReq;
-    loadDataReq["command"] = "loadData";
-    loadDataReq["data"] = data;
+    engine.setAutoPurgeRatio(autoPurge);
 
-    auto dataRespJson = nlohmann::json::parse(router.handleRequest(loadDataReq.dump()));
-    if (dataRespJson["status"] == "error")
+    if (!servePath.empty())
     {
-        std::cerr << dataRespJson.dump(2) << std::endl;
-        return 1;
+        try
+        {
+            std::cerr << nlohmann::json{{"status", "ok"}, {"listening", servePath}, {"workers", workers}}.dump() << std::endl;
+            SocketServer(router, engine, workers).serve(servePath);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << nlohmann::json{{"status", "error"}, {"message", ex.what()}}.dump() << std::endl;
+            return 1;
+        }
     }
-
-    if (interactive)
+    else if (interactive)
     {
         std::cout << "✅ ToorCraft CLI ready. Type JSON commands and press Enter.\n";
         std::cout << "ℹ️  Type 'help' for example commands, 'exit' to quit.\n";
@@ -127,7 +224,10 @@ int main(int argc, char *argv[])
     {"command": "getSchemaList"},
     {"command": "queryEntity", "id": "device1"},
     {"command": "setField", "id": "device1", "field": "name", "value": "NewName"},
-    {"command": "validateEntity", "id": "device1"}
+    {"command": "validateEntity", "id": "device1"},
+    {"command": "batch", "stopOnError": true, "requests": [
+      {"command": "setField", "id": "device1", "field": "name", "value": "NewName"},
+      {"command": "queryEntity", "id": "device1"}]}
   ]
 })" << std::endl;
                 continue;
@@ -151,6 +251,30 @@ int main(int argc, char *argv[])
             }
         }
     }
+    else if (stream)
+    {
+        // ✅ Streaming: newline-delimited requests, one response line each
+        ToorCraftJSON::CompactOutput compact;
+        std::string line;
+        std::size_t unflushed = 0;
+        while (std::getline(std::cin, line))
+        {
+            if (line.empty() || line == "\r")
+                continue;
+
+            std::cout << router.handleRequest(line) << '\n';
+            ++unflushed;
+
+            // Flush before the next read could block, so a client waiting
+            // for this response is never stalled behind the buffer.
+            if ((flushEvery > 0 && unflushed >= flushEvery) || std::cin.rdbuf()->in_avail() <= 0)
+            {
+                std::cout.flush();
+                unflushed = 0;
+            }
+        }
+        std::cout.flush();
+    }
     else
     {
         // ✅ Non-interactive: read stdin all at once
@@ -412,13 +412,33 @@ public:
     }
 };
 
-// ------- LuaManager Singleton API --------
+// ------- LuaManager API --------
+namespace
+{
+    thread_local LuaManager *activeLua = nullptr;
+}
+
 LuaManager &LuaManager::instance()
+{
+    return activeLua ? *activeLua : defaultInstance();
+}
+
+LuaManager &LuaManager::defaultInstance()
 {
     static LuaManager instance;
     return instance;
 }
 
+LuaManager::Scope::Scope(LuaManager &manager) : previous_(activeLua)
+{
+    activeLua = &manager;
+}
+
+LuaManager::Scope::~Scope()
+{
+    activeLua = previous_;
+}
+
 LuaManager::LuaManager()
     : impl_(new LuaManagerImpl()) {}
 
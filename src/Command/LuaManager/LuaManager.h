@@ -7,7 +7,27 @@
 class LuaManager
 {
 public:
+    LuaManager();
+    ~LuaManager();
+
+    // The Lua state active on this thread (see Scope), else defaultInstance().
     static LuaManager &instance();
+    // The process-wide Lua state used by ToorCraftEngine::instance().
+    static LuaManager &defaultInstance();
+
+    // Makes `manager` what instance() returns on this thread while alive.
+    class Scope
+    {
+    public:
+        explicit Scope(LuaManager &manager);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        LuaManager *previous_;
+    };
+
     void setBasePath(const std::filesystem::path &basePath);
     void runScript(const std::string &scriptPath_,
                    const Entity &entity,
@@ -17,9 +37,6 @@ private:
     class LuaManagerImpl;
     LuaManagerImpl *impl_;
 
-    LuaManager();
-    ~LuaManager();
-
     LuaManager(const LuaManager &) = delete;
     LuaManager &operator=(const LuaManager &) = delete;
 };
@@ -1,16 +1,41 @@
 #include "Entity.h"
 #include "FieldValueFactory.h" // Use FieldValueFactory, not FieldSchemaFactory
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
+#include <utility>
 
 Entity::Entity(const EntitySchema &schema)
-    : schema_(schema)
+    : schema_(schema), slots_(FieldArena::current())
+{
+    auto &factory = FieldValueFactory::instance();
+    slots_.resize(schema_.getFieldCount());
+    for (FieldId id = 0; id < slots_.size(); ++id)
+    {
+        const FieldSchema *fieldSchema = schema_.getField(id);
+        const std::string typeName = fieldSchema->getTypeName();
+        if (fieldSchema->isPrimitive() && factory.canBind(typeName))
+        {
+            slots_[id].isInline = true;
+        }
+        else
+        {
+            slots_[id].value = factory.create(typeName, *fieldSchema);
+        }
+    }
+}
+
+// Runs `fn` on the field's value, using a stack-bound view for inline fields
+// that have no handle yet. The cell is only mutated by the setters, so the
+// const_cast does not change observable state.
+template <typename Fn>
+void Entity::visitField(FieldId fieldId, Fn &&fn) const
 {
-    for (const auto &[fieldName, fieldSchemaPtr] : schema_.getFields())
+    auto &slot = const_cast<FieldSlot &>(slots_[fieldId]);
+    if (slot.value)
+    {
+        fn(*slot.value);
+    }
+    else
     {
-        auto fieldValue = FieldValueFactory::instance().create(fieldSchemaPtr->getTypeName(), *fieldSchemaPtr);
-        fieldValues_.emplace(fieldName, std::move(fieldValue));
+        FieldValueFactory::withBoundValue(*schema_.getField(fieldId), slot.cell, fn);
     }
 }
 
@@ -21,12 +46,45 @@ const EntitySchema &Entity::getSchema() const
 
 FieldValue *Entity::getFieldValue(const std::string &fieldName)
 {
-    auto it = fieldValues_.find(fieldName);
-    if (it != fieldValues_.end())
+    return getFieldValue(schema_.getFieldId(fieldName));
+}
+
+FieldValue *Entity::getFieldValue(FieldId fieldId)
+{
+    if (fieldId >= slots_.size())
+    {
+        return nullptr;
+    }
+
+    auto &slot = slots_[fieldId];
+    if (!slot.value)
+    {
+        slot.value = FieldValueFactory::instance().bind(*schema_.getField(fieldId), slot.cell);
+    }
+    return slot.value.get();
+}
+
+FieldCell *Entity::getFieldCell(FieldId fieldId)
+{
+    return const_cast<FieldCell *>(std::as_const(*this).getFieldCell(fieldId));
+}
+
+const FieldCell *Entity::getFieldCell(FieldId fieldId) const
+{
+    if (fieldId >= slots_.size() || !slots_[fieldId].isInline)
+    {
+        return nullptr;
+    }
+    return &slots_[fieldId].cell;
+}
+
+const FieldValue *Entity::getFieldNode(FieldId fieldId) const
+{
+    if (fieldId >= slots_.size() || slots_[fieldId].isInline)
     {
-        return it->second.get();
+        return nullptr;
     }
-    return nullptr;
+    return slots_[fieldId].value.get();
 }
 
 void Entity::setFieldValue(const std::string &fieldName, const std::string &value)
@@ -40,16 +98,40 @@ void Entity::setFieldValue(const std::string &fieldName, const std::string &valu
     fieldValue->setValueFromString(value);
 }
 
-void Entity::validate() const
+void Entity::setFieldValue(FieldId fieldId, const std::string &value)
 {
-    for (const auto &[name, fieldValue] : fieldValues_)
+    if (fieldId >= slots_.size())
     {
-        if (fieldValue->getSchema().isRequired() && fieldValue->isEmpty())
-        {
-            throw std::runtime_error("Missing required field '" + name + "' in entity '" + _id + "'");
-        }
+        throw std::runtime_error("Field not found: #" + std::to_string(fieldId));
+    }
+
+    visitField(fieldId, [&](FieldValue &fieldValue)
+               { fieldValue.setValueFromString(value); });
+}
+
+void Entity::setFieldJson(const std::string &fieldName, const nlohmann::json &value)
+{
+    auto *fieldValue = getFieldValue(fieldName);
+    if (!fieldValue)
+    {
+        throw std::runtime_error("Field not found: " + fieldName);
+    }
+
+    fieldValue->setValueFromJson(value);
+}
 
-        fieldValue->validate();
+void Entity::validate() const
+{
+    for (FieldId id = 0; id < slots_.size(); ++id)
+    {
+        visitField(id, [&](const FieldValue &fieldValue)
+                   {
+            if (fieldValue.getSchema().isRequired() && fieldValue.isEmpty())
+            {
+                throw std::runtime_error("Missing required field '" + fieldValue.getSchema().getName() + "' in entity '" + _id + "'");
+            }
+
+            fieldValue.validate(); });
     }
 }
 
@@ -76,45 +158,55 @@ const std::string &Entity::getParentId() const
 std::unordered_map<std::string, std::string> Entity::getDict() const
 {
     std::unordered_map<std::string, std::string> dict;
-    for (const auto &[key, valuePtr] : fieldValues_)
+    dict.reserve(slots_.size());
+    for (FieldId id = 0; id < slots_.size(); ++id)
     {
-        dict[key] = valuePtr->toString();
+        visitField(id, [&](const FieldValue &fieldValue)
+                   { dict[fieldValue.getSchema().getName()] = fieldValue.toString(); });
     }
     return dict;
 }
 
-std::string Entity::getJson() const
+void Entity::writeJson(JsonWriter &writer) const
 {
-    json entityJson;
-    entityJson["id"] = _id;
-    entityJson["schema"] = schema_.getName();
-    entityJson["parentId"] = _parentId.empty() ? json(nullptr) : json(_parentId);
-
-    switch (state_)
+    writer.beginObject();
+    writer.key("id");
+    writer.value(_id);
+    writer.key("schema");
+    writer.value(schema_.getName());
+    writer.key("parentId");
+    if (_parentId.empty())
+        writer.null();
+    else
+        writer.value(_parentId);
+    writer.key("state");
+    writer.value(entityStateName(state_));
+
+    for (FieldId id = 0; id < slots_.size(); ++id)
     {
-    case EntityState::Added:
-        entityJson["state"] = "Added";
-        break;
-    case EntityState::Modified:
-        entityJson["state"] = "Modified";
-        break;
-    case EntityState::Deleted:
-        entityJson["state"] = "Deleted";
-        break;
-    case EntityState::Unchanged:
-        entityJson["state"] = "Unchanged";
-        break;
+        visitField(id, [&](const FieldValue &fieldValue)
+                   {
+            writer.key(fieldValue.getSchema().getName());
+            fieldValue.writeJson(writer); });
     }
+    writer.endObject();
+}
 
-    for (const auto &pair : fieldValues_)
+void Entity::writeFieldJson(FieldId fieldId, JsonWriter &writer) const
+{
+    if (fieldId >= slots_.size())
     {
-        const std::string &fieldName = pair.first;
-        const auto &fieldValue = pair.second;
-
-        if (fieldValue)
-        {
-            entityJson[fieldName] = json::parse(fieldValue->toJson());
-        }
+        throw std::runtime_error("Field not found: #" + std::to_string(fieldId));
     }
-    return entityJson.dump(2); // pretty print for readability
+
+    visitField(fieldId, [&](const FieldValue &fieldValue)
+               { fieldValue.writeJson(writer); });
+}
+
+std::string Entity::getJson() const
+{
+    std::string out;
+    JsonWriter writer(out, 2); // pretty print for readability
+    writeJson(writer);
+    return out;
 }
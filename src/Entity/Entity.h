@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <memory>
+#include <memory_resource>
 #include "EntitySchema.h"
 #include "FieldValue.h"
+#include "FieldCell.h"
 
 class EntitySchema; // Forward declaration
 
@@ -16,28 +20,78 @@ enum class EntityState
     Deleted
 };
 
+inline const char *entityStateName(EntityState state)
+{
+    switch (state)
+    {
+    case EntityState::Added:
+        return "Added";
+    case EntityState::Modified:
+        return "Modified";
+    case EntityState::Deleted:
+        return "Deleted";
+    case EntityState::Unchanged:
+        break;
+    }
+    return "Unchanged";
+}
+
 class Entity
 {
 public:
     explicit Entity(const EntitySchema &schema);
+
+    static void *operator new(std::size_t size) { return FieldArena::allocate(size); }
+    static void operator delete(void *ptr, std::size_t size) { FieldArena::deallocate(ptr, size); }
+
     const EntitySchema &getSchema() const;
     FieldValue *getFieldValue(const std::string &fieldName);
+    FieldValue *getFieldValue(FieldId fieldId);
+    // Raw inline storage of a primitive field; nullptr for objects and arrays.
+    const FieldCell *getFieldCell(FieldId fieldId) const;
+    // Writable access for loaders restoring trusted values; skips validation.
+    FieldCell *getFieldCell(FieldId fieldId);
+    // Value node of an object or array field; nullptr for primitives.
+    const FieldValue *getFieldNode(FieldId fieldId) const;
     void setFieldValue(const std::string &fieldName, const std::string &value);
+    void setFieldValue(FieldId fieldId, const std::string &value);
+    void setFieldJson(const std::string &fieldName, const nlohmann::json &value);
     void validate() const;
     void setId(const std::string &id);
     const std::string &getId() const;
     void setParentId(const std::string &parentId);
     const std::string &getParentId() const;
     std::unordered_map<std::string, std::string> getDict() const;
+    // Fields follow id, schema, parentId and state in FieldId order.
+    void writeJson(JsonWriter &writer) const;
+    void writeFieldJson(FieldId fieldId, JsonWriter &writer) const;
     std::string getJson() const;
     void setState(EntityState newState) { state_ = newState; }
     EntityState getState() const { return state_; }
     bool isDeleted() const { return state_ == EntityState::Deleted; }
 
 private:
+    friend class EntityManager;
+    friend class EntityList;
+
+    // Primitive fields keep their value inline in `cell`; `value` is only
+    // created on demand as a handle bound to it. Objects and arrays own a node.
+    struct FieldSlot
+    {
+        FieldCell cell;
+        std::unique_ptr<FieldValue> value;
+        bool isInline = false;
+    };
+
+    template <typename Fn>
+    void visitField(FieldId fieldId, Fn &&fn) const;
+
     const EntitySchema &schema_;
-    std::unordered_map<std::string, std::unique_ptr<FieldValue>> fieldValues_;
+    std::pmr::vector<FieldSlot> slots_; // indexed by FieldId, never resized after construction
     std::string _id;
     std::string _parentId;
     EntityState state_ = EntityState::Unchanged;
+    std::uint32_t schemaSlot_ = 0; // position in EntityManager's per-schema index
+    Entity *prevSibling_ = nullptr; // links in the EntityList holding the entity
+    Entity *nextSibling_ = nullptr;
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include "Entity.h"
+
+// Ordered list of entities linked through the entities themselves, used by
+// EntityManager for the roots and for each parent's children. Appending and
+// unlinking are O(1) and keep the order of the others. An entity is in at
+// most one list at a time.
+class EntityList
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Entity *;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Entity *const *;
+        using reference = Entity *;
+
+        const_iterator() = default;
+
+        Entity *operator*() const { return current_; }
+
+        const_iterator &operator++()
+        {
+            current_ = current_->nextSibling_;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        // Stepping back from end() reaches the last entity.
+        const_iterator &operator--()
+        {
+            current_ = current_ ? current_->prevSibling_ : list_->last_;
+            return *this;
+        }
+        const_iterator operator--(int)
+        {
+            const_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const { return current_ == other.current_; }
+        bool operator!=(const const_iterator &other) const { return current_ != other.current_; }
+
+    private:
+        friend class EntityList;
+        const_iterator(const EntityList *list, Entity *current) : list_(list), current_(current) {}
+
+        const EntityList *list_ = nullptr;
+        Entity *current_ = nullptr;
+    };
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    EntityList() = default;
+    EntityList(const EntityList &) = delete;
+    EntityList &operator=(const EntityList &) = delete;
+
+    const_iterator begin() const { return {this, first_}; }
+    const_iterator end() const { return {this, nullptr}; }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    Entity *front() const { return first_; }
+    Entity *back() const { return last_; }
+
+    void push_back(Entity *entity)
+    {
+        entity->prevSibling_ = last_;
+        entity->nextSibling_ = nullptr;
+        (last_ ? last_->nextSibling_ : first_) = entity;
+        last_ = entity;
+        ++size_;
+    }
+
+    // `entity` must be in this list.
+    void erase(Entity *entity)
+    {
+        (entity->prevSibling_ ? entity->prevSibling_->nextSibling_ : first_) = entity->nextSibling_;
+        (entity->nextSibling_ ? entity->nextSibling_->prevSibling_ : last_) = entity->prevSibling_;
+        entity->prevSibling_ = nullptr;
+        entity->nextSibling_ = nullptr;
+        --size_;
+    }
+
+    // Forgets the entities without unlinking them, for when they go too.
+    void clear()
+    {
+        first_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    Entity *first_ = nullptr;
+    Entity *last_ = nullptr;
+    std::size_t size_ = 0;
+};
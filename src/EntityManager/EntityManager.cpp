@@ -3,9 +3,13 @@
 #include "EntitySchema.h"
 #include "FieldSchemaFactory.h"
 #include "FieldValueFactory.h"
+#include "ReferenceFieldValue.h"
+#include "ThreadPool.h"
+#include "StreamingDataLoader.h"
 #include <yaml-cpp/yaml.h>
 #include <stdexcept>
 #include <algorithm>
+#include <utility>
 
 static void populateFieldValue(FieldValue *fieldValue, const FieldSchema &schema, const YAML::Node &node);
 static void populateObjectField(ObjectFieldValue *objValue, const ObjectFieldSchema &objSchema, const YAML::Node &node);
@@ -83,30 +87,231 @@ static void populateFieldValue(FieldValue *fieldValue, const FieldSchema &schema
     }
 }
 
+namespace
+{
+    thread_local EntityManager *activeManager = nullptr;
+
+    // Calls `visit(cell)` for each reference cell, empty or not, in `value`.
+    template <typename Visit>
+    void visitReferenceCells(const FieldSchema &schema, FieldValue *value, Visit &visit)
+    {
+        if (!value || !schema.holdsReferences())
+            return;
+
+        const std::string type = schema.getTypeName();
+        if (type == "reference")
+        {
+            visit(static_cast<PrimitiveFieldValue *>(value)->getCell());
+        }
+        else if (type == "object")
+        {
+            auto *object = static_cast<ObjectFieldValue *>(value);
+            for (const auto &[name, field] : static_cast<const ObjectFieldSchema &>(schema).getFields())
+                visitReferenceCells(*field, object->getFieldValue(name), visit);
+        }
+        else if (type == "array")
+        {
+            const FieldSchema &element = static_cast<const ArrayFieldSchema &>(schema).getElementSchema();
+            for (const auto &item : static_cast<ArrayFieldValue *>(value)->getElements())
+                visitReferenceCells(element, item.get(), visit);
+        }
+    }
+
+    // Same for a top-level field; inline reference cells are used in place.
+    template <typename Visit>
+    void visitReferenceCells(Entity &entity, FieldId fieldId, Visit &&visit)
+    {
+        if (FieldCell *cell = entity.getFieldCell(fieldId))
+            visit(*cell);
+        else
+            visitReferenceCells(*entity.getSchema().getField(fieldId), entity.getFieldValue(fieldId), visit);
+    }
+
+    bool holdsTarget(const FieldCell &cell)
+    {
+        return !cell.isEmpty() && !cell.getString().empty();
+    }
+}
+
 EntityManager &EntityManager::instance()
+{
+    return activeManager ? *activeManager : defaultInstance();
+}
+
+EntityManager &EntityManager::defaultInstance()
 {
     static EntityManager manager;
     return manager;
 }
 
+EntityManager::Scope::Scope(EntityManager &manager) : previous_(activeManager)
+{
+    activeManager = &manager;
+}
+
+EntityManager::Scope::~Scope()
+{
+    activeManager = previous_;
+}
+
 void EntityManager::addEntity(std::unique_ptr<Entity> entity)
 {
-    const std::string &id = entity->getId();
-    const std::string &parentId = entity->getParentId();
+    if (!insertEntity(entity))
+        throw std::runtime_error("Entity already exists: " + entity->getId());
+}
 
-    entities_.emplace(id, std::move(entity));
+bool EntityManager::insertEntity(std::unique_ptr<Entity> &entity)
+{
+    Entity *ptr = entity.get();
+    auto [it, inserted] = entities_.try_emplace(ptr->getId(), std::move(entity));
+    if (!inserted)
+        return false;
 
-    Entity *ptr = entities_[id].get();
-    if (!parentId.empty())
+    if (!ptr->isDeleted())
     {
-        childrenIndex_[parentId].push_back(ptr);
+        try
+        {
+            indexSchema(ptr);
+        }
+        catch (...)
+        {
+            entities_.erase(it);
+            throw;
+        }
+        for (FieldId fieldId : ptr->getSchema().getReferenceFields())
+            indexReferences(ptr, fieldId);
     }
-    else
+
+    // Restored tombstones stay addressable but, as after removeEntity, are
+    // not listed as roots or under their parent.
+    if (ptr->isDeleted())
     {
+        ++deletedCount_;
+        return true;
+    }
+
+    const std::string &parentId = ptr->getParentId();
+    if (parentId.empty())
         parents_.push_back(ptr);
+    else
+        childrenIndex_[parentId].push_back(ptr);
+    return true;
+}
+
+void EntityManager::indexSchema(Entity *entity)
+{
+    const EntitySchema &schema = entity->getSchema();
+    auto [it, created] = schemaIndex_.try_emplace(&schema);
+    SchemaMembers &members = it->second;
+    if (created)
+    {
+        for (FieldId fieldId : schema.getIndexedFields())
+            members.fieldIndexes.emplace_back(schema, fieldId);
+    }
+
+    // Checked before anything is indexed, so a rejected entity leaves no trace.
+    for (const FieldIndex &index : members.fieldIndexes)
+        index.checkUnique(*entity);
+
+    entity->schemaSlot_ = static_cast<std::uint32_t>(members.entities.size());
+    members.entities.push_back(entity);
+    for (FieldIndex &index : members.fieldIndexes)
+        index.insert(entity);
+}
+
+void EntityManager::unindexSchema(Entity *entity)
+{
+    auto it = schemaIndex_.find(&entity->getSchema());
+    if (it == schemaIndex_.end())
+        return;
+
+    auto &members = it->second.entities;
+    Entity *last = members.back();
+    members[entity->schemaSlot_] = last;
+    last->schemaSlot_ = entity->schemaSlot_;
+    members.pop_back();
+
+    for (FieldIndex &index : it->second.fieldIndexes)
+        index.erase(entity);
+}
+
+void EntityManager::indexReferences(Entity *entity, FieldId fieldId)
+{
+    visitReferenceCells(*entity, fieldId, [&](const FieldCell &cell)
+                        {
+        if (holdsTarget(cell))
+            referrers_[std::string(cell.getString())].push_back({entity, fieldId}); });
+}
+
+void EntityManager::unindexReferences(Entity *entity, FieldId fieldId)
+{
+    visitReferenceCells(*entity, fieldId, [&](const FieldCell &cell)
+                        {
+        if (!holdsTarget(cell))
+            return;
+        auto it = referrers_.find(std::string(cell.getString()));
+        if (it == referrers_.end())
+            return;
+
+        auto &referrers = it->second;
+        auto pos = std::find_if(referrers.begin(), referrers.end(), [&](const Referrer &referrer)
+                                { return referrer.entity == entity && referrer.fieldId == fieldId; });
+        if (pos != referrers.end())
+        {
+            *pos = referrers.back();
+            referrers.pop_back();
+        }
+        if (referrers.empty())
+            referrers_.erase(it); });
+}
+
+// Empties every reference to `targetId` held by a live entity.
+void EntityManager::clearReferencesTo(const std::string &targetId)
+{
+    auto node = referrers_.extract(targetId);
+    if (node.empty())
+        return;
+
+    auto clear = [&](FieldCell &cell)
+    {
+        if (holdsTarget(cell) && cell.getString() == targetId)
+            cell.clear();
+    };
+    for (const Referrer &referrer : node.mapped())
+    {
+        Entity &entity = *referrer.entity;
+        writeField(entity, referrer.fieldId, [&]
+                   { visitReferenceCells(entity, referrer.fieldId, clear); });
+        if (entity.getState() != EntityState::Added)
+            entity.setState(EntityState::Modified);
     }
 }
 
+std::vector<Entity *> EntityManager::getAllEntities() const
+{
+    std::vector<Entity *> all;
+    all.reserve(entities_.size());
+    for (const auto &pair : entities_)
+        all.push_back(pair.second.get());
+    return all;
+}
+
+void EntityManager::reserve(std::size_t entityCount)
+{
+    entities_.reserve(entityCount);
+}
+
+std::pmr::memory_resource *EntityManager::createArena(std::size_t initialSize)
+{
+    arenas_.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>(std::max<std::size_t>(initialSize, 64 * 1024)));
+    return arenas_.back().get();
+}
+
+void EntityManager::retainStorage(std::shared_ptr<const void> storage)
+{
+    retainedStorage_.push_back(std::move(storage));
+}
+
 Entity *EntityManager::getEntityById(const std::string &id) const
 {
     auto it = entities_.find(id);
@@ -124,100 +329,153 @@ bool EntityManager::removeEntity(const std::string &id)
         return false;
 
     Entity *entity = it->second.get();
+    if (entity->isDeleted())
+        return true;
 
-    entity->setState(EntityState::Deleted);
-
-    auto childIt = childrenIndex_.find(id);
-    if (childIt != childrenIndex_.end())
+    // Only the top of the subtree is unlinked; the lists below it are
+    // dropped whole.
+    const std::string &parentId = entity->getParentId();
+    if (parentId.empty())
     {
-        for (Entity *child : childIt->second)
-        {
-            removeEntity(child->getId());
-        }
+        parents_.erase(entity);
+    }
+    else if (auto siblings = childrenIndex_.find(parentId); siblings != childrenIndex_.end())
+    {
+        siblings->second.erase(entity);
     }
 
-    const std::string &parentId = entity->getParentId();
-    if (!parentId.empty())
+    // An explicit stack rather than recursion, so deep trees cannot
+    // overflow the call stack.
+    std::vector<Entity *> removed;
+    std::vector<Entity *> pending = {entity};
+    while (!pending.empty())
     {
-        auto parentChildren = childrenIndex_.find(parentId);
-        if (parentChildren != childrenIndex_.end())
+        Entity *current = pending.back();
+        pending.pop_back();
+
+        unindexSchema(current);
+        for (FieldId fieldId : current->getSchema().getReferenceFields())
+            unindexReferences(current, fieldId);
+        current->setState(EntityState::Deleted);
+        removed.push_back(current);
+
+        auto children = childrenIndex_.find(current->getId());
+        if (children != childrenIndex_.end())
         {
-            auto &siblings = parentChildren->second;
-            siblings.erase(std::remove(siblings.begin(), siblings.end(), entity), siblings.end());
+            for (Entity *child : children->second)
+                pending.push_back(child);
+            childrenIndex_.erase(children);
         }
     }
 
+    // With the whole subtree unindexed, only references from outside it are
+    // left to empty.
+    for (Entity *gone : removed)
+        clearReferencesTo(gone->getId());
+
+    deletedCount_ += removed.size();
+    if (autoPurgeRatio_ > 0 && deletedCount_ > autoPurgeRatio_ * entities_.size())
+    {
+        std::vector<std::string> purged = purgeDeleted();
+        purgedIds_.insert(purgedIds_.end(), std::make_move_iterator(purged.begin()), std::make_move_iterator(purged.end()));
+    }
     return true;
 }
 
-// bool EntityManager::removeEntity(const std::string &id)
-//{
-//     auto it = entities_.find(id);
-//     if (it == entities_.end())
-//         return false;
-//
-//     Entity *entity = it->second.get();
-//
-//     std::vector<Entity *> childrenCopy;
-//     auto childIt = childrenIndex_.find(id);
-//     if (childIt != childrenIndex_.end())
-//     {
-//         childrenCopy = childIt->second;
-//         childrenIndex_.erase(childIt);
-//     }
-//
-//     for (Entity *child : childrenCopy)
-//     {
-//         removeEntity(child->getId());
-//     }
-//
-//     const std::string parentId = entity->getParentId();
-//     if (!parentId.empty())
-//     {
-//         auto parentChildrenIt = childrenIndex_.find(parentId);
-//         if (parentChildrenIt != childrenIndex_.end())
-//         {
-//             auto &siblings = parentChildrenIt->second;
-//             siblings.erase(std::remove(siblings.begin(), siblings.end(), entity), siblings.end());
-//             if (siblings.empty())
-//             {
-//                 childrenIndex_.erase(parentChildrenIt);
-//             }
-//         }
-//     }
-//     else
-//     {
-//         parents_.erase(std::remove(parents_.begin(), parents_.end(), entity), parents_.end());
-//     }
-//
-//     for (auto &pair : entities_)
-//     {
-//         Entity *otherEntity = pair.second.get();
-//         for (const auto &fieldSchemaEntry : otherEntity->getSchema().getFields())
-//         {
-//             FieldValue *value = otherEntity->getFieldValue(fieldSchemaEntry.first);
-//
-//             if (auto refValue = dynamic_cast<ReferenceFieldValue *>(value))
-//             {
-//                 if (refValue->getReferencedId().has_value() &&
-//                     refValue->getReferencedId().value() == id)
-//                 {
-//                     refValue->setReferencedId("");
-//                 }
-//             }
-//         }
-//     }
-//
-//     entities_.erase(it);
-//
-//     return true;
-// }
+std::vector<std::string> EntityManager::purgeDeleted()
+{
+    std::vector<std::string> purged;
+    std::unordered_map<const std::pmr::memory_resource *, std::size_t> liveByArena;
+    for (const auto &[id, entity] : entities_)
+    {
+        if (entity->isDeleted())
+            purged.push_back(id);
+        else
+            ++liveByArena[FieldArena::resourceOf(entity.get())];
+    }
+    std::sort(purged.begin(), purged.end());
+
+    for (const std::string &id : purged)
+    {
+        entities_.erase(id);
+        // References may have been pointed at the tombstone since it was
+        // deleted; they would dangle now.
+        clearReferencesTo(id);
+        auto children = childrenIndex_.find(id);
+        if (children != childrenIndex_.end() && children->second.empty())
+            childrenIndex_.erase(children);
+    }
+    entities_.rehash(0);
+    deletedCount_ = 0;
+
+    // Loaded entities live in their file's arena, which frees nothing until
+    // released as a whole.
+    arenas_.erase(std::remove_if(arenas_.begin(), arenas_.end(), [&](const auto &arena)
+                                 { return !liveByArena.count(arena.get()); }),
+                  arenas_.end());
+    return purged;
+}
+
+std::vector<std::string> EntityManager::takePurgedIds()
+{
+    return std::exchange(purgedIds_, {});
+}
 
 void EntityManager::clear()
 {
     entities_.clear();
     childrenIndex_.clear();
+    schemaIndex_.clear();
+    referrers_.clear();
     parents_.clear();
+    deletedCount_ = 0;
+    purgedIds_.clear();
+    arenas_.clear();
+    retainedStorage_.clear();
+}
+
+// Runs `write` on a field of a live entity, moving the entity to its new
+// value in the field's index and its references to their new targets. If
+// the write throws or the new value is taken in a unique field, the old
+// value is put back (a composite field keeps whatever the write left).
+void EntityManager::writeField(Entity &entity, FieldId fieldId, const std::function<void()> &write)
+{
+    const FieldSchema *field = entity.isDeleted() ? nullptr : entity.getSchema().getField(fieldId);
+    FieldIndex *index = field && field->isIndexed() ? getFieldIndex(entity.getSchema(), fieldId) : nullptr;
+    FieldCell *cell = index ? entity.getFieldCell(fieldId) : nullptr;
+    const bool references = field && field->holdsReferences();
+    if (!cell && !references)
+    {
+        write();
+        return;
+    }
+
+    const FieldCell previous = cell ? *cell : FieldCell();
+    if (cell)
+        index->erase(&entity);
+    if (references)
+        unindexReferences(&entity, fieldId);
+    try
+    {
+        write();
+        if (cell)
+            index->checkUnique(entity);
+    }
+    catch (...)
+    {
+        if (cell)
+        {
+            *cell = previous;
+            index->insert(&entity);
+        }
+        if (references)
+            indexReferences(&entity, fieldId);
+        throw;
+    }
+    if (cell)
+        index->insert(&entity);
+    if (references)
+        indexReferences(&entity, fieldId);
 }
 
 void EntityManager::setFieldValue(const std::string &entityId,
@@ -230,7 +488,22 @@ void EntityManager::setFieldValue(const std::string &entityId,
         throw std::runtime_error("Entity not found: " + entityId);
     }
 
-    entity->setFieldValue(fieldName, value);
+    writeField(*entity, entity->getSchema().getFieldId(fieldName), [&]
+               { entity->setFieldValue(fieldName, value); });
+}
+
+void EntityManager::setFieldJson(const std::string &entityId,
+                                 const std::string &fieldName,
+                                 const nlohmann::json &value)
+{
+    auto entity = getEntityById(entityId);
+    if (!entity)
+    {
+        throw std::runtime_error("Entity not found: " + entityId);
+    }
+
+    writeField(*entity, entity->getSchema().getFieldId(fieldName), [&]
+               { entity->setFieldJson(fieldName, value); });
 }
 
 FieldValue *EntityManager::getFieldValue(const std::string &entityId, const std::string &fieldName)
@@ -257,7 +530,7 @@ std::vector<Entity *> EntityManager::query(const IEntityQuery &query) const
     return query.execute(*this);
 }
 
-const std::vector<Entity *> *EntityManager::getChildren(const std::string &parentId) const
+const EntityList *EntityManager::getChildren(const std::string &parentId) const
 {
     auto it = childrenIndex_.find(parentId);
     if (it != childrenIndex_.end())
@@ -267,70 +540,250 @@ const std::vector<Entity *> *EntityManager::getChildren(const std::string &paren
     return nullptr;
 }
 
-const std::vector<Entity *> &EntityManager::getParents() const
+const std::vector<Entity *> *EntityManager::getEntitiesBySchema(const std::string &schemaName) const
+{
+    const EntitySchema *schema = SchemaManager::instance().getEntitySchema(schemaName);
+    auto it = schema ? schemaIndex_.find(schema) : schemaIndex_.end();
+    if (it == schemaIndex_.end() || it->second.entities.empty())
+        return nullptr;
+    return &it->second.entities;
+}
+
+const FieldIndex *EntityManager::getFieldIndex(const EntitySchema &schema, FieldId fieldId) const
+{
+    auto it = schemaIndex_.find(&schema);
+    if (it == schemaIndex_.end())
+        return nullptr;
+    for (const FieldIndex &index : it->second.fieldIndexes)
+    {
+        if (index.getFieldId() == fieldId)
+            return &index;
+    }
+    return nullptr;
+}
+
+FieldIndex *EntityManager::getFieldIndex(const EntitySchema &schema, FieldId fieldId)
+{
+    return const_cast<FieldIndex *>(std::as_const(*this).getFieldIndex(schema, fieldId));
+}
+
+std::vector<Entity *> EntityManager::findByField(const std::string &schemaName,
+                                                 const std::string &fieldName,
+                                                 const nlohmann::json &value) const
+{
+    const EntitySchema *schema = SchemaManager::instance().getEntitySchema(schemaName);
+    if (!schema)
+        throw std::runtime_error("Schema not found: " + schemaName);
+    const FieldId fieldId = schema->getFieldId(fieldName);
+    const FieldSchema *field = schema->getField(fieldId);
+    if (!field)
+        throw std::runtime_error("Field '" + fieldName + "' not defined in schema '" + schemaName + "'");
+    if (!field->isIndexed())
+        throw std::runtime_error("Field '" + schemaName + "." + fieldName + "' is not indexed");
+
+    // Converted and checked like a write to the field, minus the target
+    // lookup of references: asking for a missing target just finds nothing.
+    FieldCell cell;
+    std::vector<PendingReference> unchecked;
+    ReferenceFieldValue::DeferredResolution deferred(unchecked);
+    FieldValueFactory::withBoundValue(*field, cell, [&](FieldValue &fieldValue)
+                                      { fieldValue.setValueFromJson(value); });
+    if (cell.isEmpty())
+        throw std::runtime_error("Empty values are not indexed");
+
+    const FieldIndex *index = getFieldIndex(*schema, fieldId);
+    return index ? index->find(cell) : std::vector<Entity *>{};
+}
+
+std::vector<EntityManager::Referrer> EntityManager::getReferrers(const std::string &targetId) const
+{
+    auto it = referrers_.find(targetId);
+    if (it == referrers_.end())
+        return {};
+
+    std::vector<Referrer> referrers = it->second;
+    std::sort(referrers.begin(), referrers.end(), [](const Referrer &a, const Referrer &b)
+              {
+        if (a.entity != b.entity)
+            return a.entity->getId() < b.entity->getId();
+        return a.fieldId < b.fieldId; });
+    referrers.erase(std::unique(referrers.begin(), referrers.end(), [](const Referrer &a, const Referrer &b)
+                                { return a.entity == b.entity && a.fieldId == b.fieldId; }),
+                    referrers.end());
+    return referrers;
+}
+
+const EntityList &EntityManager::getParents() const
 {
     return parents_;
 }
 
-void EntityManager::parseDataBundle(const std::unordered_map<std::string, std::string> &bundleContent)
+// Builds the entities of one data file from its YAML::Node tree. Used for
+// files the streaming loader cannot handle (aliases). Runs on a pool thread,
+// so it only reads shared state (schemas) and keeps what it creates in `out`.
+static void loadDataFile(const std::string &fileName, const std::string &yamlContent, LoadedDataFile &out)
 {
-    clear();
+    YAML::Node root = YAML::Load(yamlContent);
+    if (!root.IsMap())
+    {
+        throw std::runtime_error("Invalid data format in file: " + fileName);
+    }
 
-    for (const auto &pair : bundleContent)
+    for (auto it = root.begin(); it != root.end(); ++it)
     {
-        const std::string &fileName = pair.first;
-        const std::string &yamlContent = pair.second;
+        std::string entityId = it->first.as<std::string>();
+        YAML::Node entityNode = it->second;
 
-        YAML::Node root = YAML::Load(yamlContent);
-        if (!root.IsMap())
+        if (!entityNode["_schema"])
         {
-            throw std::runtime_error("Invalid data format in file: " + fileName);
+            throw std::runtime_error("Entity '" + entityId + "' in file '" + fileName + "' is missing '_schema'");
         }
 
-        for (auto it = root.begin(); it != root.end(); ++it)
+        std::string schemaName = entityNode["_schema"].as<std::string>();
+
+        EntitySchema *schema = SchemaManager::instance().getEntitySchema(schemaName);
+        if (!schema)
         {
-            std::string entityId = it->first.as<std::string>();
-            YAML::Node entityNode = it->second;
+            throw std::runtime_error("Entity '" + entityId + "' refers to unknown schema: " + schemaName);
+        }
 
-            if (!entityNode["_schema"])
-            {
-                throw std::runtime_error("Entity '" + entityId + "' in file '" + fileName + "' is missing '_schema'");
-            }
+        auto entity = std::make_unique<Entity>(*schema);
+        entity->setId(entityId);
 
-            std::string schemaName = entityNode["_schema"].as<std::string>();
+        if (entityNode["_parentid"] && !entityNode["_parentid"].IsNull())
+        {
+            entity->setParentId(entityNode["_parentid"].as<std::string>());
+        }
 
-            EntitySchema *schema = SchemaManager::instance().getEntitySchema(schemaName);
-            if (!schema)
-            {
-                throw std::runtime_error("Entity '" + entityId + "' refers to unknown schema: " + schemaName);
-            }
+        for (auto fit = entityNode.begin(); fit != entityNode.end(); ++fit)
+        {
+            std::string key = fit->first.as<std::string>();
+            if (key == "_schema" || key == "_parentid")
+                continue;
 
-            auto entity = std::make_unique<Entity>(*schema);
-            entity->setId(entityId);
+            FieldId fieldId = schema->getFieldId(key);
+            const FieldSchema *fieldSchema = schema->getField(fieldId);
+            if (!fieldSchema)
+                throw std::runtime_error("Field '" + key + "' not defined in schema '" + schemaName + "'");
 
-            if (entityNode["_parentid"] && !entityNode["_parentid"].IsNull())
+            if (fieldSchema->isPrimitive())
             {
-                entity->setParentId(entityNode["_parentid"].as<std::string>());
+                // Written straight into the entity's inline slot, no handle needed.
+                if (!fit->second.IsScalar())
+                    throw std::runtime_error("Expected scalar for primitive field type: " + fieldSchema->getTypeName());
+                entity->setFieldValue(fieldId, fit->second.as<std::string>());
+                continue;
             }
 
-            for (auto fit = entityNode.begin(); fit != entityNode.end(); ++fit)
-            {
-                std::string key = fit->first.as<std::string>();
-                if (key == "_schema" || key == "_parentid")
-                    continue;
+            FieldValue *fieldValue = entity->getFieldValue(fieldId);
+            if (!fieldValue)
+                throw std::runtime_error("Field '" + key + "' missing from entity");
+
+            populateFieldValue(fieldValue, *fieldSchema, fit->second);
+        }
+
+        out.addEntity(std::move(entity));
+    }
+}
+
+void EntityManager::parseDataBundle(const std::unordered_map<std::string, std::string> &bundleContent)
+{
+    clear();
+
+    // Files are parsed in parallel but merged in name order, so the resulting
+    // store (and the error for duplicate ids) does not depend on scheduling.
+    std::vector<const std::pair<const std::string, std::string> *> files;
+    files.reserve(bundleContent.size());
+    for (const auto &pair : bundleContent)
+        files.push_back(&pair);
+    std::sort(files.begin(), files.end(), [](const auto *a, const auto *b)
+              { return a->first < b->first; });
+
+    // One arena per file since monotonic resources are not thread-safe. The
+    // in-memory store is roughly the size of its YAML source, so start there.
+    std::vector<std::pmr::memory_resource *> arenas;
+    arenas.reserve(files.size());
+    for (const auto *file : files)
+        arenas.push_back(createArena(file->second.size()));
+
+    // References may point into files loaded by other threads, so their
+    // targets are only checked once every entity has been merged.
+    // Pool threads see this store and the caller's schemas as current.
+    SchemaManager &schemas = SchemaManager::instance();
+    std::vector<LoadedDataFile> loaded(files.size());
+    ThreadPool::instance().parallelFor(files.size(), [&](std::size_t i)
+                                       {
+        EntityManager::Scope storeScope(*this);
+        SchemaManager::Scope schemaScope(schemas);
+        FieldArena::Scope arenaScope(arenas[i]);
+        ReferenceFieldValue::DeferredResolution deferred(loaded[i].references);
+        if (!StreamingDataLoader::load(files[i]->first, files[i]->second, loaded[i]))
+            loadDataFile(files[i]->first, files[i]->second, loaded[i]); });
+
+    // An entity whose id is taken stays in `loaded`, since its pending
+    // references point into it, and fails the load before they are resolved.
+    std::size_t duplicateCount = 0;
+    std::string duplicates;
+    for (std::size_t i = 0; i < loaded.size(); ++i)
+    {
+        for (auto &entity : loaded[i].entities)
+        {
+            if (!insertEntity(entity))
+                duplicates += (duplicateCount++ == 0 ? "" : "; ") + ("'" + entity->getId() + "' in " + files[i]->first);
+        }
+    }
 
-                const FieldSchema *fieldSchema = schema->getField(key);
-                if (!fieldSchema)
-                    throw std::runtime_error("Field '" + key + "' not defined in schema '" + schemaName + "'");
+    if (duplicateCount > 0)
+    {
+        loaded.clear(); // before the arenas holding the rejected entities go
+        clear();
+        throw std::runtime_error(std::to_string(duplicateCount) + " duplicate entity id(s) in data bundle: " + duplicates);
+    }
 
-                FieldValue *fieldValue = entity->getFieldValue(key);
-                if (!fieldValue)
-                    throw std::runtime_error("Field '" + key + "' missing from entity");
+    resolveReferences(loaded);
+}
 
-                populateFieldValue(fieldValue, *fieldSchema, fit->second);
+// Every entity exists once the files are merged and the store is not modified
+// until this returns, so targets are looked up concurrently. All dangling
+// references are collected and reported in a single error.
+void EntityManager::resolveReferences(const std::vector<LoadedDataFile> &loaded)
+{
+    std::vector<const PendingReference *> references;
+    for (const auto &file : loaded)
+    {
+        for (const auto &reference : file.references)
+            references.push_back(&reference);
+    }
+
+    constexpr std::size_t chunkSize = 4096;
+    const std::size_t chunkCount = (references.size() + chunkSize - 1) / chunkSize;
+    std::vector<std::vector<std::string>> problems(chunkCount);
+    ThreadPool::instance().parallelFor(chunkCount, [&](std::size_t chunk)
+                                       {
+        EntityManager::Scope storeScope(*this);
+        const std::size_t end = std::min(references.size(), (chunk + 1) * chunkSize);
+        for (std::size_t i = chunk * chunkSize; i < end; ++i)
+        {
+            const PendingReference &reference = *references[i];
+            if (auto problem = ReferenceFieldValue::resolve(reference))
+            {
+                std::string owner = reference.owner ? reference.owner->getId() : "?";
+                problems[chunk].push_back("entity '" + owner + "' field '" + reference.schema->getName() + "': " + *problem);
             }
+        } });
 
-            addEntity(std::move(entity));
+    std::size_t problemCount = 0;
+    std::string message;
+    for (const auto &chunk : problems)
+    {
+        for (const auto &problem : chunk)
+        {
+            message += (problemCount++ == 0 ? "" : "; ") + problem;
         }
     }
+
+    if (problemCount > 0)
+    {
+        throw std::runtime_error(std::to_string(problemCount) + " unresolved reference(s) in data bundle: " + message);
+    }
 }
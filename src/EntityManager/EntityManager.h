@@ -4,9 +4,15 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <functional>
 #include "Entity.h"
+#include "EntityList.h"
+#include "FieldIndex.h"
+#include "StoreLock.h"
 
 class EntityManager;
+struct LoadedDataFile;
 
 class IEntityQuery
 {
@@ -15,35 +21,164 @@ public:
     virtual std::vector<Entity *> execute(const EntityManager &manager) const = 0;
 };
 
+// Concurrency: EntityManager does no locking of its own. Callers that share
+// it between threads hold a guard on lock() for the whole operation,
+// including any use of the Entity pointers it returns: a ReadGuard for const
+// access, a WriteGuard for anything that modifies entities or the indexes
+// (Entity::getFieldValue counts as a modification, it may create a handle).
+// ToorCraftEngine and ToorCraftJSON take these guards for their callers.
+// Entity pointers stay valid until clear() or the next parseDataBundle();
+// deleting an entity only marks it, until purgeDeleted() frees it.
+//
+// Secondary indexes (schema membership, `index: true` fields, references)
+// follow the writes made through this class. Writing a field through a
+// FieldValue handle from getFieldValue() bypasses them; use
+// setFieldValue/setFieldJson for indexed and reference fields.
 class EntityManager
 {
 public:
+    EntityManager() = default;
+
+    // The store active on this thread (see Scope), else defaultInstance().
+    // Code below the engine (references, Lua, loaders) reaches the store of
+    // the engine it runs for through this.
     static EntityManager &instance();
+    // The process-wide store used by ToorCraftEngine::instance().
+    static EntityManager &defaultInstance();
+
+    // Makes `manager` what instance() returns on this thread while alive.
+    class Scope
+    {
+    public:
+        explicit Scope(EntityManager &manager);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        EntityManager *previous_;
+    };
+
+    StoreLock &lock() const { return lock_; }
 
     void parseDataBundle(const std::unordered_map<std::string, std::string> &bundleContent);
+    // Throws, adding nothing, if the id is taken (by a deleted entity too,
+    // until it is purged) or the entity duplicates a value of a unique field.
     void addEntity(std::unique_ptr<Entity> entity);
+    void reserve(std::size_t entityCount);
     Entity *getEntityById(const std::string &id) const;
+    std::size_t getEntityCount() const { return entities_.size(); }
+    std::vector<Entity *> getAllEntities() const;
+    // Marks the entity and its descendants deleted, in time proportional to
+    // the size of the subtree; a deleted entity is left as it is. References
+    // to them from live entities are emptied, and those entities become
+    // Modified (unless Added), even where the reference is required.
     bool removeEntity(const std::string &id);
     void clear();
 
+    // Deleted entities stay addressable, with their values, as tombstones
+    // until purged. Purging frees them and returns their ids in order, for
+    // callers that track changes to record as deletions first. It also
+    // empties references still pointing at them, and releases each data
+    // file's arena once none of its entities remain.
+    std::vector<std::string> purgeDeleted();
+    std::size_t getDeletedCount() const { return deletedCount_; }
+    // Purges after a removeEntity() leaves more than `ratio` of the store
+    // deleted; 0 (the default) turns this off. The ids purged this way are
+    // kept for takePurgedIds().
+    void setAutoPurgeRatio(double ratio) { autoPurgeRatio_ = ratio; }
+    std::vector<std::string> takePurgedIds();
+
+    // Throws, leaving the field as it was, if the value is invalid or taken
+    // in a unique field.
     void setFieldValue(const std::string &entityId,
                        const std::string &fieldName,
                        const std::string &value);
+    void setFieldJson(const std::string &entityId,
+                      const std::string &fieldName,
+                      const nlohmann::json &value);
 
     FieldValue *getFieldValue(const std::string &entityId, const std::string &fieldName);
 
     void validate(const std::string &entityId);
 
     std::vector<Entity *> query(const IEntityQuery &query) const;
-    const std::vector<Entity *> &getParents() const;
-    const std::vector<Entity *> *getChildren(const std::string &parentId) const;
+    // Live roots, and the live children of a parent (nullptr if it never had
+    // any), in the order they were added.
+    const EntityList &getParents() const;
+    const EntityList *getChildren(const std::string &parentId) const;
+    // The live entities of a schema, in no particular order; nullptr if it
+    // has none. Like the children index, deleted entities are not listed.
+    const std::vector<Entity *> *getEntitiesBySchema(const std::string &schemaName) const;
+    // Live entities whose indexed field holds `value` (converted as by
+    // setFieldJson; reference targets need not exist).
+    // Throws if the schema or field is unknown, the field has no index or
+    // `value` is null (empty fields are not indexed).
+    std::vector<Entity *> findByField(const std::string &schemaName,
+                                      const std::string &fieldName,
+                                      const nlohmann::json &value) const;
+    // Index of a field declared with `index` or `unique`, else nullptr.
+    const FieldIndex *getFieldIndex(const EntitySchema &schema, FieldId fieldId) const;
+
+    // A top-level field of a live entity that references some target,
+    // directly or from inside an object or array.
+    struct Referrer
+    {
+        Entity *entity;
+        FieldId fieldId;
+    };
+    // Who references `targetId`, sorted by entity id and then FieldId, each
+    // field listed once however many references it holds.
+    std::vector<Referrer> getReferrers(const std::string &targetId) const;
+
+    // For loaders outside this class (snapshots): an arena owned by the store
+    // for building entities in, and storage that entities point into (e.g. a
+    // mapped file). Both are kept until clear().
+    std::pmr::memory_resource *createArena(std::size_t initialSize);
+    void retainStorage(std::shared_ptr<const void> storage);
 
 private:
-    EntityManager() = default;
     EntityManager(const EntityManager &) = delete;
     EntityManager &operator=(const EntityManager &) = delete;
 
-    std::vector<Entity *> parents_;
+    void resolveReferences(const std::vector<LoadedDataFile> &loaded);
+    // addEntity() without the duplicate check: returns false, leaving
+    // `entity` with the caller, if the id is taken.
+    bool insertEntity(std::unique_ptr<Entity> &entity);
+    void indexSchema(Entity *entity);
+    void unindexSchema(Entity *entity);
+    FieldIndex *getFieldIndex(const EntitySchema &schema, FieldId fieldId);
+    void writeField(Entity &entity, FieldId fieldId, const std::function<void()> &write);
+    void indexReferences(Entity *entity, FieldId fieldId);
+    void unindexReferences(Entity *entity, FieldId fieldId);
+    void clearReferencesTo(const std::string &targetId);
+
+    // Back every entity and field tree built by parseDataBundle (one per data
+    // file); released as a whole by clear() once the entities referencing them
+    // are gone. Declared first so they also outlive them on destruction.
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas_;
+    std::vector<std::shared_ptr<const void>> retainedStorage_;
+
+    mutable StoreLock lock_;
+
+    EntityList parents_;
     std::unordered_map<std::string, std::unique_ptr<Entity>> entities_;
-    std::unordered_map<std::string, std::vector<Entity *>> childrenIndex_;
+    std::unordered_map<std::string, EntityList> childrenIndex_;
+    struct SchemaMembers
+    {
+        // Entity::schemaSlot_ holds each entity's position, so removal swaps
+        // the last entity into its place instead of searching.
+        std::vector<Entity *> entities;
+        std::vector<FieldIndex> fieldIndexes; // one per EntitySchema::getIndexedFields()
+    };
+    // Keyed by schema rather than name: entities left over from a schema set
+    // that was recompiled in place never share an entry with the new one.
+    std::unordered_map<const EntitySchema *, SchemaMembers> schemaIndex_;
+    // Target id -> one entry per non-empty reference held by a live entity.
+    // Like the children index, removal searches the target's vector.
+    std::unordered_map<std::string, std::vector<Referrer>> referrers_;
+
+    std::size_t deletedCount_ = 0;
+    double autoPurgeRatio_ = 0;
+    std::vector<std::string> purgedIds_;
 };
@@ -0,0 +1,156 @@
+#include "FieldIndex.h"
+#include "Entity.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    std::string describe(const FieldIndex::Key &key)
+    {
+        if (auto *text = std::get_if<std::string>(&key))
+            return *text;
+        if (auto *flag = std::get_if<bool>(&key))
+            return *flag ? "true" : "false";
+        std::ostringstream out;
+        std::visit([&](const auto &value)
+                   { out << value; },
+                   key);
+        return out.str();
+    }
+}
+
+FieldIndex::FieldIndex(const EntitySchema &schema, FieldId fieldId)
+    : schema_(schema),
+      fieldId_(fieldId),
+      kind_(schema.getField(fieldId)->getIndexKind()),
+      unique_(schema.getField(fieldId)->isUnique())
+{
+}
+
+bool FieldIndex::EntryOrder::operator()(const Entry &a, const Entry &b) const
+{
+    if (a.key != b.key)
+        return a.key < b.key;
+    return a.entity->getId() < b.entity->getId();
+}
+
+FieldIndex::OrderedKey FieldIndex::orderedKey(const Key &key)
+{
+    if (auto *integer = std::get_if<std::int64_t>(&key))
+        return *integer;
+    if (auto *number = std::get_if<double>(&key))
+        return *number;
+    throw std::runtime_error("Ordered indexes hold integer and float values only");
+}
+
+std::optional<FieldIndex::Key> FieldIndex::keyOf(const FieldCell &cell)
+{
+    switch (cell.getKind())
+    {
+    case FieldCell::Kind::Integer:
+        return Key(cell.getInteger());
+    case FieldCell::Kind::Float:
+        if (std::isnan(cell.getFloat()))
+            return std::nullopt;
+        return Key(cell.getFloat());
+    case FieldCell::Kind::Boolean:
+        return Key(cell.getBoolean());
+    case FieldCell::Kind::String:
+        return Key(std::string(cell.getString()));
+    case FieldCell::Kind::Empty:
+        break;
+    }
+    return std::nullopt;
+}
+
+std::optional<FieldIndex::Key> FieldIndex::keyOf(const Entity &entity) const
+{
+    const FieldCell *cell = entity.getFieldCell(fieldId_);
+    return cell ? keyOf(*cell) : std::nullopt;
+}
+
+std::vector<Entity *> FieldIndex::find(const FieldCell &value) const
+{
+    auto key = keyOf(value);
+    if (!key)
+        return {};
+
+    if (isOrdered())
+    {
+        std::vector<Entity *> found;
+        auto [first, last] = ordered_.equal_range(orderedKey(*key));
+        for (auto it = first; it != last; ++it)
+            found.push_back(it->entity);
+        return found;
+    }
+    auto it = buckets_.find(*key);
+    return it != buckets_.end() ? it->second : std::vector<Entity *>{};
+}
+
+void FieldIndex::checkUnique(const Entity &entity) const
+{
+    if (!unique_)
+        return;
+    auto key = keyOf(entity);
+    if (!key)
+        return;
+
+    const Entity *holder = nullptr;
+    if (isOrdered())
+    {
+        auto it = ordered_.find(orderedKey(*key));
+        holder = it != ordered_.end() ? it->entity : nullptr;
+    }
+    else
+    {
+        auto it = buckets_.find(*key);
+        holder = it != buckets_.end() ? it->second.front() : nullptr;
+    }
+    if (!holder)
+        return;
+
+    const std::string &field = schema_.getField(fieldId_)->getName();
+    throw std::runtime_error("Duplicate value '" + describe(*key) + "' for unique field '" + schema_.getName() + "." + field +
+                             "': entities '" + holder->getId() + "' and '" + entity.getId() + "'");
+}
+
+void FieldIndex::insert(Entity *entity)
+{
+    auto key = keyOf(*entity);
+    if (!key)
+        return;
+
+    if (isOrdered())
+        ordered_.insert({orderedKey(*key), entity});
+    else
+        buckets_[std::move(*key)].push_back(entity);
+}
+
+void FieldIndex::erase(Entity *entity)
+{
+    auto key = keyOf(*entity);
+    if (!key)
+        return;
+
+    if (isOrdered())
+    {
+        ordered_.erase({orderedKey(*key), entity});
+        return;
+    }
+
+    auto it = buckets_.find(*key);
+    if (it == buckets_.end())
+        return;
+
+    auto &bucket = it->second;
+    auto pos = std::find(bucket.begin(), bucket.end(), entity);
+    if (pos != bucket.end())
+    {
+        *pos = bucket.back();
+        bucket.pop_back();
+    }
+    if (bucket.empty())
+        buckets_.erase(it);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "EntitySchema.h"
+#include "FieldCell.h"
+
+class Entity;
+
+// Secondary index over one top-level primitive field of one schema, kept by
+// EntityManager for the live entities of the schema. Empty fields (and NaN,
+// which equals nothing) are not indexed.
+//
+// A hash index maps each value to a plain vector, like the children index:
+// removal searches the entity's bucket, which stays short for the selective
+// fields (serials, codes, names) such an index is declared on. An ordered
+// index (integer and float fields) is a tree sorted by value and then id,
+// so ranges are read in order and removal is logarithmic however many
+// entities share a value.
+class FieldIndex
+{
+public:
+    using Key = std::variant<std::int64_t, double, bool, std::string>;
+    using OrderedKey = std::variant<std::int64_t, double>;
+
+    // One end of an ordered range; the key has the field's type.
+    struct Bound
+    {
+        OrderedKey key;
+        bool inclusive = true;
+    };
+
+    FieldIndex(const EntitySchema &schema, FieldId fieldId);
+
+    FieldId getFieldId() const { return fieldId_; }
+    bool isUnique() const { return unique_; }
+    bool isOrdered() const { return kind_ == FieldIndexKind::Ordered; }
+
+    static std::optional<Key> keyOf(const FieldCell &cell);
+
+    // Entities holding `value`.
+    std::vector<Entity *> find(const FieldCell &value) const;
+
+    // Ordered indexes: calls `visit(entity, key)` for the entities between
+    // the bounds (a null bound is open), ascending or descending by value,
+    // until it returns false. Returns true if the range was exhausted.
+    template <typename Visit>
+    bool scan(const Bound *lower, const Bound *upper, bool descending, Visit &&visit) const
+    {
+        auto first = !lower ? ordered_.begin()
+                            : (lower->inclusive ? ordered_.lower_bound(lower->key) : ordered_.upper_bound(lower->key));
+        auto last = !upper ? ordered_.end()
+                           : (upper->inclusive ? ordered_.upper_bound(upper->key) : ordered_.lower_bound(upper->key));
+        if (first == ordered_.end() || (last != ordered_.end() && !ordered_.key_comp()(*first, *last)))
+            return true;
+
+        if (!descending)
+        {
+            for (auto it = first; it != last; ++it)
+            {
+                if (!visit(it->entity, it->key))
+                    return false;
+            }
+            return true;
+        }
+        for (auto it = last; it != first;)
+        {
+            --it;
+            if (!visit(it->entity, it->key))
+                return false;
+        }
+        return true;
+    }
+
+    // Throws if `entity` would duplicate the value of another entity in a
+    // unique index. Call before insert(), with `entity` not in the index.
+    void checkUnique(const Entity &entity) const;
+    void insert(Entity *entity);
+    void erase(Entity *entity);
+
+private:
+    struct Entry
+    {
+        OrderedKey key;
+        Entity *entity;
+    };
+
+    // By value, then id; also compares entries with bare keys.
+    struct EntryOrder
+    {
+        using is_transparent = void;
+        bool operator()(const Entry &a, const Entry &b) const;
+        bool operator()(const Entry &a, const OrderedKey &b) const { return a.key < b; }
+        bool operator()(const OrderedKey &a, const Entry &b) const { return a < b.key; }
+    };
+
+    std::optional<Key> keyOf(const Entity &entity) const;
+    static OrderedKey orderedKey(const Key &key);
+
+    const EntitySchema &schema_;
+    FieldId fieldId_;
+    FieldIndexKind kind_;
+    bool unique_;
+    std::unordered_map<Key, std::vector<Entity *>> buckets_;
+    std::set<Entry, EntryOrder> ordered_;
+};
@@ -0,0 +1,87 @@
+#include "StoreLock.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    struct HeldLock
+    {
+        const StoreLock *lock;
+        bool exclusive;
+    };
+
+    // Locks held by this thread; rarely more than one entry.
+    thread_local std::vector<HeldLock> heldLocks;
+
+    const HeldLock *findHeld(const StoreLock *lock)
+    {
+        for (const auto &held : heldLocks)
+        {
+            if (held.lock == lock)
+                return &held;
+        }
+        return nullptr;
+    }
+
+    void releaseHeld(const StoreLock *lock)
+    {
+        auto it = std::find_if(heldLocks.begin(), heldLocks.end(), [lock](const HeldLock &held)
+                               { return held.lock == lock; });
+        if (it != heldLocks.end())
+            heldLocks.erase(it);
+    }
+
+    // Spreads threads over the shards round-robin in order of first use.
+    std::size_t readerShard(std::size_t shardCount)
+    {
+        static std::atomic<std::size_t> nextSlot{0};
+        thread_local const std::size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+        return slot % shardCount;
+    }
+}
+
+StoreLock::ReadGuard::ReadGuard(const StoreLock &lock)
+{
+    if (findHeld(&lock))
+        return;
+
+    shard_ = readerShard(ShardCount);
+    lock.shards_[shard_].mutex.lock_shared();
+    heldLocks.push_back({&lock, false});
+    lock_ = &lock;
+}
+
+StoreLock::ReadGuard::~ReadGuard()
+{
+    if (!lock_)
+        return;
+    releaseHeld(lock_);
+    lock_->shards_[shard_].mutex.unlock_shared();
+}
+
+StoreLock::WriteGuard::WriteGuard(const StoreLock &lock)
+{
+    if (const HeldLock *held = findHeld(&lock))
+    {
+        if (!held->exclusive)
+            throw std::runtime_error("Cannot modify the entity store while reading it on the same thread");
+        return;
+    }
+
+    // Always in shard order, so two writers cannot deadlock.
+    for (auto &shard : lock.shards_)
+        shard.mutex.lock();
+    heldLocks.push_back({&lock, true});
+    lock_ = &lock;
+}
+
+StoreLock::WriteGuard::~WriteGuard()
+{
+    if (!lock_)
+        return;
+    releaseHeld(lock_);
+    for (auto it = lock_->shards_.rbegin(); it != lock_->shards_.rend(); ++it)
+        it->mutex.unlock();
+}
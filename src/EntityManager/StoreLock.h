@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <shared_mutex>
+
+// Reader-writer lock guarding one entity store (EntityManager) together with
+// the schemas its entities point to.
+//
+// Readers lock one of several shards, picked per thread, so concurrent
+// queries do not contend on a single cache line; writers lock every shard.
+// Guards are reentrant per thread: a guard taken while the thread already
+// holds the lock (in a mode at least as strong) is a no-op, so API layers can
+// nest freely. Taking a WriteGuard while only a ReadGuard is held throws.
+class StoreLock
+{
+public:
+    StoreLock() = default;
+    StoreLock(const StoreLock &) = delete;
+    StoreLock &operator=(const StoreLock &) = delete;
+
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const StoreLock &lock);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+    private:
+        const StoreLock *lock_ = nullptr; // null if nested
+        std::size_t shard_ = 0;
+    };
+
+    class WriteGuard
+    {
+    public:
+        explicit WriteGuard(const StoreLock &lock);
+        ~WriteGuard();
+        WriteGuard(const WriteGuard &) = delete;
+        WriteGuard &operator=(const WriteGuard &) = delete;
+
+    private:
+        const StoreLock *lock_ = nullptr; // null if nested
+    };
+
+private:
+    static constexpr std::size_t ShardCount = 16;
+
+    struct alignas(64) Shard
+    {
+        std::shared_mutex mutex;
+    };
+
+    mutable std::array<Shard, ShardCount> shards_;
+};
@@ -0,0 +1,431 @@
+#include "StreamingDataLoader.h"
+#include "SchemaManager.h"
+#include "EntitySchema.h"
+#include "ArrayFieldSchema.h"
+#include "ObjectFieldSchema.h"
+#include "ArrayFieldValue.h"
+#include "ObjectFieldValue.h"
+#include "FieldValueFactory.h"
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/parser.h>
+#include <yaml-cpp/yaml.h>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+
+namespace
+{
+    // Lets YAML::Parser read the bundle string in place instead of copying it
+    // into a stringstream.
+    class StringViewBuffer : public std::streambuf
+    {
+    public:
+        explicit StringViewBuffer(const std::string &text)
+        {
+            char *begin = const_cast<char *>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+
+    // Thrown from OnAlias to abandon streaming for the current file.
+    struct AliasEncountered
+    {
+    };
+
+    enum class EventType
+    {
+        Scalar,
+        Null,
+        MapStart,
+        MapEnd,
+        SequenceStart,
+        SequenceEnd
+    };
+
+    class EntityEventBuilder : public YAML::EventHandler
+    {
+    public:
+        EntityEventBuilder(const std::string &fileName, LoadedDataFile &out)
+            : fileName_(fileName), out_(out) {}
+
+        bool sawDocument() const { return sawDocument_; }
+
+        void OnDocumentStart(const YAML::Mark &) override { sawDocument_ = true; }
+        void OnDocumentEnd() override {}
+
+        void OnNull(const YAML::Mark &, YAML::anchor_t) override { dispatch(EventType::Null, empty_); }
+        void OnAlias(const YAML::Mark &, YAML::anchor_t) override { throw AliasEncountered{}; }
+        void OnScalar(const YAML::Mark &, const std::string &, YAML::anchor_t, const std::string &value) override
+        {
+            dispatch(EventType::Scalar, value);
+        }
+        void OnSequenceStart(const YAML::Mark &, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override
+        {
+            dispatch(EventType::SequenceStart, empty_);
+        }
+        void OnSequenceEnd() override { dispatch(EventType::SequenceEnd, empty_); }
+        void OnMapStart(const YAML::Mark &, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override
+        {
+            dispatch(EventType::MapStart, empty_);
+        }
+        void OnMapEnd() override { dispatch(EventType::MapEnd, empty_); }
+
+    private:
+        struct Frame
+        {
+            enum class Kind
+            {
+                Root,
+                Entity,
+                Object,
+                Array,
+                Skip
+            };
+
+            explicit Frame(Kind kind, bool expectKey = true, FieldValue *value = nullptr,
+                           const FieldSchema *schema = nullptr, int depth = 0)
+                : kind(kind), expectKey(expectKey), value(value), schema(schema), depth(depth)
+            {
+            }
+
+            Kind kind;
+            bool expectKey;
+            std::string key;
+            FieldId fieldId = InvalidFieldId;
+            FieldValue *value;
+            const FieldSchema *schema;
+            int depth;
+        };
+
+        struct RecordedEvent
+        {
+            EventType type;
+            std::string text;
+        };
+
+        static bool opens(EventType type) { return type == EventType::MapStart || type == EventType::SequenceStart; }
+        static bool closes(EventType type) { return type == EventType::MapEnd || type == EventType::SequenceEnd; }
+
+        void dispatch(EventType type, const std::string &text)
+        {
+            if (stack_.empty())
+            {
+                if (type != EventType::MapStart || finished_)
+                    throw std::runtime_error("Invalid data format in file: " + fileName_);
+                stack_.emplace_back(Frame::Kind::Root);
+                return;
+            }
+
+            switch (stack_.back().kind)
+            {
+            case Frame::Kind::Root:
+                onRoot(type, text);
+                break;
+            case Frame::Kind::Entity:
+                if (schema_)
+                    onEntity(type, text);
+                else
+                    onEntityBeforeSchema(type, text);
+                break;
+            case Frame::Kind::Object:
+                onObject(type, text);
+                break;
+            case Frame::Kind::Array:
+                onArray(type, text);
+                break;
+            case Frame::Kind::Skip:
+                onSkip(type);
+                break;
+            }
+        }
+
+        // Marks the value of the current top frame as complete.
+        void valueDone()
+        {
+            if (!stack_.empty())
+                stack_.back().expectKey = true;
+        }
+
+        void pop()
+        {
+            stack_.pop_back();
+            valueDone();
+        }
+
+        std::string requireKey(EventType type, const std::string &text) const
+        {
+            if (type == EventType::Scalar)
+                return text;
+            if (type == EventType::Null)
+                return "null";
+            throw std::runtime_error("Only scalar keys are supported in data file: " + fileName_);
+        }
+
+        void onRoot(EventType type, const std::string &text)
+        {
+            Frame &root = stack_.back();
+            if (root.expectKey)
+            {
+                if (type == EventType::MapEnd)
+                {
+                    stack_.pop_back();
+                    finished_ = true;
+                    return;
+                }
+                entityId_ = requireKey(type, text);
+                root.expectKey = false;
+                return;
+            }
+
+            if (type != EventType::MapStart)
+                throw std::runtime_error("Entity '" + entityId_ + "' in file '" + fileName_ + "' is missing '_schema'");
+
+            schema_ = nullptr;
+            entity_.reset();
+            recorded_.clear();
+            recordDepth_ = 0;
+            recordExpectKey_ = true;
+            awaitingSchema_ = false;
+            stack_.emplace_back(Frame::Kind::Entity);
+        }
+
+        // Until `_schema` is seen, entity events are recorded verbatim.
+        void onEntityBeforeSchema(EventType type, const std::string &text)
+        {
+            if (awaitingSchema_)
+            {
+                if (type != EventType::Scalar)
+                    throw std::runtime_error("Entity '" + entityId_ + "' in file '" + fileName_ + "' has an invalid '_schema'");
+                startEntity(text);
+                return;
+            }
+
+            if (recordDepth_ == 0)
+            {
+                if (type == EventType::MapEnd)
+                    throw std::runtime_error("Entity '" + entityId_ + "' in file '" + fileName_ + "' is missing '_schema'");
+                if (recordExpectKey_ && type == EventType::Scalar && text == "_schema")
+                {
+                    awaitingSchema_ = true;
+                    return;
+                }
+            }
+
+            recorded_.push_back({type, text});
+            if (opens(type))
+                ++recordDepth_;
+            else if (closes(type))
+                --recordDepth_;
+
+            if (recordDepth_ == 0)
+                recordExpectKey_ = closes(type) ? true : !recordExpectKey_;
+        }
+
+        void startEntity(const std::string &schemaName)
+        {
+            schema_ = SchemaManager::instance().getEntitySchema(schemaName);
+            if (!schema_)
+                throw std::runtime_error("Entity '" + entityId_ + "' refers to unknown schema: " + schemaName);
+
+            entity_ = std::make_unique<Entity>(*schema_);
+            entity_->setId(entityId_);
+            awaitingSchema_ = false;
+
+            std::vector<RecordedEvent> replay;
+            replay.swap(recorded_);
+            for (const auto &event : replay)
+                dispatch(event.type, event.text);
+        }
+
+        void onEntity(EventType type, const std::string &text)
+        {
+            Frame &frame = stack_.back();
+            if (frame.expectKey)
+            {
+                if (type == EventType::MapEnd)
+                {
+                    out_.addEntity(std::move(entity_));
+                    schema_ = nullptr;
+                    pop();
+                    return;
+                }
+
+                frame.key = requireKey(type, text);
+                frame.expectKey = false;
+                if (frame.key == "_schema" || frame.key == "_parentid")
+                    return;
+
+                frame.fieldId = schema_->getFieldId(frame.key);
+                if (!schema_->getField(frame.fieldId))
+                    throw std::runtime_error("Field '" + frame.key + "' not defined in schema '" + schema_->getName() + "'");
+                return;
+            }
+
+            if (frame.key == "_schema")
+            {
+                skipValue(type);
+                return;
+            }
+
+            if (frame.key == "_parentid")
+            {
+                if (type == EventType::Scalar)
+                    entity_->setParentId(text);
+                else if (type != EventType::Null)
+                    throw std::runtime_error("Entity '" + entityId_ + "' in file '" + fileName_ + "' has an invalid '_parentid'");
+                frame.expectKey = true;
+                return;
+            }
+
+            const FieldSchema &fieldSchema = *schema_->getField(frame.fieldId);
+            if (fieldSchema.isPrimitive())
+            {
+                // Written straight into the entity's inline slot, no handle needed.
+                if (type != EventType::Scalar)
+                    throw std::runtime_error("Expected scalar for primitive field type: " + fieldSchema.getTypeName());
+                entity_->setFieldValue(frame.fieldId, text);
+                frame.expectKey = true;
+                return;
+            }
+
+            FieldValue *value = entity_->getFieldValue(frame.fieldId);
+            if (!value)
+                throw std::runtime_error("Field '" + frame.key + "' missing from entity");
+            beginValue(type, text, value, fieldSchema);
+        }
+
+        void onObject(EventType type, const std::string &text)
+        {
+            Frame &frame = stack_.back();
+            if (frame.expectKey)
+            {
+                if (type == EventType::MapEnd)
+                {
+                    pop();
+                    return;
+                }
+
+                frame.key = requireKey(type, text);
+                frame.expectKey = false;
+                return;
+            }
+
+            const auto &objSchema = static_cast<const ObjectFieldSchema &>(*frame.schema);
+            const FieldSchema *subSchema = objSchema.getField(frame.key);
+            if (!subSchema)
+                throw std::runtime_error("Subfield '" + frame.key + "' not defined in object schema");
+
+            FieldValue *subValue = static_cast<ObjectFieldValue *>(frame.value)->getFieldValue(frame.key);
+            if (!subValue)
+                throw std::runtime_error("Subfield '" + frame.key + "' not present in object value");
+
+            beginValue(type, text, subValue, *subSchema);
+        }
+
+        void onArray(EventType type, const std::string &text)
+        {
+            Frame &frame = stack_.back();
+            if (type == EventType::SequenceEnd)
+            {
+                pop();
+                return;
+            }
+
+            const auto &arrSchema = static_cast<const ArrayFieldSchema &>(*frame.schema);
+            const FieldSchema &elementSchema = arrSchema.getElementSchema();
+            auto element = FieldValueFactory::instance().create(elementSchema.getTypeName(), elementSchema);
+            FieldValue *elementPtr = element.get();
+            static_cast<ArrayFieldValue *>(frame.value)->addElement(std::move(element));
+
+            beginValue(type, text, elementPtr, elementSchema);
+        }
+
+        void onSkip(EventType type)
+        {
+            Frame &frame = stack_.back();
+            if (opens(type))
+                ++frame.depth;
+            else if (closes(type) && --frame.depth == 0)
+                pop();
+        }
+
+        void skipValue(EventType type)
+        {
+            if (opens(type))
+                stack_.emplace_back(Frame::Kind::Skip, false, nullptr, nullptr, 1);
+            else
+                valueDone();
+        }
+
+        // First event of a nested value: scalars are assigned, objects and
+        // arrays push a frame that receives the events up to their end.
+        void beginValue(EventType type, const std::string &text, FieldValue *value, const FieldSchema &schema)
+        {
+            const std::string typeName = schema.getTypeName();
+            if (typeName == "object")
+            {
+                if (type != EventType::MapStart)
+                    throw std::runtime_error("Expected YAML map for object field");
+                if (!dynamic_cast<ObjectFieldValue *>(value))
+                    throw std::runtime_error("Schema says object but value is not ObjectFieldValue");
+                stack_.emplace_back(Frame::Kind::Object, true, value, &schema);
+                return;
+            }
+
+            if (typeName == "array")
+            {
+                if (type != EventType::SequenceStart)
+                    throw std::runtime_error("Expected YAML sequence for array field");
+                if (!dynamic_cast<ArrayFieldValue *>(value))
+                    throw std::runtime_error("Schema says array but value is not ArrayFieldValue");
+                stack_.emplace_back(Frame::Kind::Array, false, value, &schema);
+                return;
+            }
+
+            if (type != EventType::Scalar)
+                throw std::runtime_error("Expected scalar for primitive field type: " + typeName);
+            value->setValueFromString(text);
+            valueDone();
+        }
+
+        const std::string &fileName_;
+        LoadedDataFile &out_;
+        const std::string empty_;
+
+        std::vector<Frame> stack_;
+        bool sawDocument_ = false;
+        bool finished_ = false;
+
+        std::string entityId_;
+        const EntitySchema *schema_ = nullptr;
+        std::unique_ptr<Entity> entity_;
+
+        std::vector<RecordedEvent> recorded_;
+        int recordDepth_ = 0;
+        bool recordExpectKey_ = true;
+        bool awaitingSchema_ = false;
+    };
+}
+
+bool StreamingDataLoader::load(const std::string &fileName, const std::string &yamlContent, LoadedDataFile &out)
+{
+    StringViewBuffer buffer(yamlContent);
+    std::istream input(&buffer);
+    YAML::Parser parser(input);
+
+    EntityEventBuilder builder(fileName, out);
+    try
+    {
+        parser.HandleNextDocument(builder);
+    }
+    catch (const AliasEncountered &)
+    {
+        out.entities.clear();
+        out.references.clear();
+        return false;
+    }
+
+    if (!builder.sawDocument())
+        throw std::runtime_error("Invalid data format in file: " + fileName);
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Entity.h"
+#include "ReferenceFieldValue.h"
+
+// Entities built from one data file, before they are merged into the store.
+struct LoadedDataFile
+{
+    std::vector<std::unique_ptr<Entity>> entities;
+    std::vector<PendingReference> references;
+
+    // Takes a finished entity and tags the references recorded while building it.
+    void addEntity(std::unique_ptr<Entity> entity)
+    {
+        for (auto it = references.rbegin(); it != references.rend() && !it->owner; ++it)
+            it->owner = entity.get();
+        entities.push_back(std::move(entity));
+    }
+};
+
+// Builds entities directly from YAML parser events, guided by the compiled
+// schemas, without materializing a YAML::Node tree for the file. Keys that
+// appear before an entity's `_schema` are recorded and replayed once the
+// schema is known.
+class StreamingDataLoader
+{
+public:
+    // Returns false, leaving `out` empty, if the file uses aliases; those
+    // files have to go through the YAML::Node based loader instead.
+    static bool load(const std::string &fileName, const std::string &yamlContent, LoadedDataFile &out);
+};
@@ -4,6 +4,9 @@
 #include "EntitySchema.h"
 #include "FieldValue.h"
 #include "Entity.h"
+#include <algorithm>
+#include <memory_resource>
+#include <nlohmann/json.hpp>
 
 TEST_CASE("EntityManager handles complex nested schema, state tracking, and soft deletion")
 {
@@ -147,6 +150,45 @@ sensor2:
     REQUIRE(house->getState() == EntityState::Unchanged);
   }
 
+  SECTION("Field ids address the same slots as field names")
+  {
+    Entity *device = mgr.getEntityById("device2");
+    REQUIRE(device != nullptr);
+
+    const EntitySchema &schema = device->getSchema();
+    REQUIRE(schema.getFieldCount() == 3);
+
+    FieldId nameId = schema.getFieldId("name");
+    REQUIRE(nameId != InvalidFieldId);
+    REQUIRE(schema.getField(nameId)->getName() == "name");
+    REQUIRE(device->getFieldValue(nameId) == device->getFieldValue("name"));
+    REQUIRE(device->getFieldValue(nameId)->toString() == "Air Purifier");
+
+    REQUIRE(schema.getFieldId("missing") == InvalidFieldId);
+    REQUIRE(device->getFieldValue(InvalidFieldId) == nullptr);
+  }
+
+  SECTION("Primitive fields are stored inline, composites as nodes")
+  {
+    Entity *device = mgr.getEntityById("device1");
+    REQUIRE(device != nullptr);
+    const EntitySchema &schema = device->getSchema();
+
+    const FieldCell *power = device->getFieldCell(schema.getFieldId("power"));
+    REQUIRE(power != nullptr);
+    REQUIRE(power->getKind() == FieldCell::Kind::Boolean);
+    REQUIRE(power->getBoolean() == true);
+
+    REQUIRE(device->getFieldCell(schema.getFieldId("specs")) == nullptr);
+
+    // A bound handle writes through to the same cell.
+    device->getFieldValue("name")->setValueFromString("Smart Thermostat");
+    const FieldCell *name = device->getFieldCell(schema.getFieldId("name"));
+    REQUIRE(name != nullptr);
+    REQUIRE(name->getString() == "Smart Thermostat");
+    REQUIRE(device->getDict().at("name") == "Smart Thermostat");
+  }
+
   SECTION("Soft delete marks entity as deleted but keeps it accessible")
   {
     // Delete device1
@@ -186,12 +228,12 @@ sensor2:
     const auto *device1Children = mgr.getChildren("device1");
     REQUIRE(device1Children != nullptr);
     REQUIRE(device1Children->size() == 1);
-    REQUIRE((*device1Children)[0]->getId() == "sensor1");
+    REQUIRE(device1Children->front()->getId() == "sensor1");
 
     const auto *device2Children = mgr.getChildren("device2");
     REQUIRE(device2Children != nullptr);
     REQUIRE(device2Children->size() == 1);
-    REQUIRE((*device2Children)[0]->getId() == "sensor2");
+    REQUIRE(device2Children->front()->getId() == "sensor2");
   }
 
   SECTION("Sensors have nested readings array parsed")
@@ -207,3 +249,886 @@ sensor2:
     REQUIRE(readings->toString().find("23.5") != std::string::npos);
   }
 }
+
+TEST_CASE("EntityManager resolves references across data files regardless of load order")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["library.yaml"] = R"(
+profile_name: Library
+fields:
+  name:
+    type: string
+)";
+  schemas["book.yaml"] = R"(
+entity_name: Book
+fields:
+  title:
+    type: string
+  sequel:
+    type: reference
+    target: Book
+  related:
+    type: array
+    element:
+      type: reference
+      target: Book
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  EntityManager &mgr = EntityManager::instance();
+
+  SECTION("References into files that sort later are accepted")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["a_first.yaml"] = R"(
+book1:
+  _schema: Book
+  title: Part One
+  sequel: book2
+  related:
+    - book3
+)";
+    data["b_second.yaml"] = R"(
+book2:
+  _schema: Book
+  title: Part Two
+)";
+    data["c_third.yaml"] = R"(
+book3:
+  _schema: Book
+  title: Appendix
+  sequel: book1
+)";
+
+    mgr.parseDataBundle(data);
+
+    REQUIRE(mgr.getEntityById("book1")->getFieldValue("sequel")->toString() == "book2");
+    REQUIRE(mgr.getEntityById("book3")->getFieldValue("sequel")->toString() == "book1");
+    REQUIRE(mgr.getEntityById("book1")->getFieldValue("related")->toString().find("book3") != std::string::npos);
+  }
+
+  SECTION("All dangling references are reported together")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["a.yaml"] = R"(
+book1:
+  _schema: Book
+  title: Orphan
+  sequel: missing_book
+)";
+    data["b.yaml"] = R"(
+library1:
+  _schema: Library
+  name: City Library
+book2:
+  _schema: Book
+  title: Misfiled
+  related:
+    - book1
+    - library1
+)";
+
+    REQUIRE_THROWS_WITH(mgr.parseDataBundle(data),
+                        "2 unresolved reference(s) in data bundle: "
+                        "entity 'book1' field 'sequel': Referenced entity with ID 'missing_book' does not exist; "
+                        "entity 'book2' field 'related_elem': Referenced entity type mismatch, expected 'Book'");
+  }
+
+  SECTION("Duplicate ids fail the load before references are resolved")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["a.yaml"] = R"(
+book1:
+  _schema: Book
+  title: Original
+book2:
+  _schema: Book
+  title: Other
+)";
+    data["b.yaml"] = R"(
+book1:
+  _schema: Book
+  title: Copy
+  sequel: book2
+  related:
+    - missing_book
+)";
+
+    REQUIRE_THROWS_WITH(mgr.parseDataBundle(data),
+                        "1 duplicate entity id(s) in data bundle: 'book1' in b.yaml");
+    REQUIRE(mgr.getEntityCount() == 0);
+    REQUIRE(mgr.getReferrers("book2").empty());
+  }
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager loads data files independent of key order and YAML features")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["shop.yaml"] = R"(
+profile_name: Shop
+fields:
+  name:
+    type: string
+  address:
+    type: object
+    fields:
+      city:
+        type: string
+      zipcode:
+        type: integer
+  tags:
+    type: array
+    element:
+      type: string
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  EntityManager &mgr = EntityManager::instance();
+
+  SECTION("Fields listed before _schema are applied once the schema is known")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["shops.yaml"] = R"(
+shop1:
+  name: Corner Shop
+  address: {city: Girona, zipcode: 17001}
+  tags: [food, "late night"]
+  _schema: Shop
+shop2:
+  _schema: Shop
+  name: ~
+)";
+
+    REQUIRE_THROWS_WITH(mgr.parseDataBundle(data), "Expected scalar for primitive field type: string");
+
+    data["shops.yaml"] = R"(
+shop1:
+  name: Corner Shop
+  address: {city: Girona, zipcode: 17001}
+  tags: [food, "late night"]
+  _schema: Shop
+)";
+    mgr.parseDataBundle(data);
+
+    Entity *shop = mgr.getEntityById("shop1");
+    REQUIRE(shop != nullptr);
+    REQUIRE(shop->getFieldValue("name")->toString() == "Corner Shop");
+    REQUIRE(shop->getFieldValue("address")->toString().find("Girona") != std::string::npos);
+    REQUIRE(shop->getFieldValue("tags")->toString() == "[food, late night]");
+  }
+
+  SECTION("Files using anchors and aliases still load")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["shops.yaml"] = R"(
+shop1:
+  _schema: Shop
+  name: Corner Shop
+  address: &main
+    city: Girona
+    zipcode: 17001
+shop2:
+  _schema: Shop
+  name: Second Shop
+  address: *main
+)";
+    mgr.parseDataBundle(data);
+
+    REQUIRE(mgr.getEntityById("shop2")->getFieldValue("address")->toString() ==
+            mgr.getEntityById("shop1")->getFieldValue("address")->toString());
+  }
+
+  SECTION("Entities without _schema are rejected")
+  {
+    std::unordered_map<std::string, std::string> data;
+    data["shops.yaml"] = R"(
+shop1:
+  name: Nameless
+)";
+    REQUIRE_THROWS_WITH(mgr.parseDataBundle(data), "Entity 'shop1' in file 'shops.yaml' is missing '_schema'");
+  }
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager indexes live entities by schema")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["garden.yaml"] = R"(
+profile_name: Garden
+children:
+  beds:
+    entity: Bed
+fields:
+  name:
+    type: string
+)";
+  schemas["bed.yaml"] = R"(
+entity_name: Bed
+children:
+  plants:
+    entity: Plant
+fields:
+  name:
+    type: string
+)";
+  schemas["plant.yaml"] = R"(
+entity_name: Plant
+fields:
+  name:
+    type: string
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  std::string yaml = "garden:\n  _schema: Garden\n";
+  for (int b = 0; b < 3; ++b)
+  {
+    const std::string bed = "bed" + std::to_string(b);
+    yaml += bed + ":\n  _schema: Bed\n  _parentid: garden\n";
+    for (int p = 0; p < 4; ++p)
+      yaml += bed + "_plant" + std::to_string(p) + ":\n  _schema: Plant\n  _parentid: " + bed + "\n";
+  }
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"garden.yaml", yaml}});
+
+  auto ids = [&](const std::string &schemaName)
+  {
+    std::vector<std::string> out;
+    if (const auto *members = mgr.getEntitiesBySchema(schemaName))
+    {
+      for (const Entity *entity : *members)
+      {
+        REQUIRE(entity->getSchema().getName() == schemaName);
+        out.push_back(entity->getId());
+      }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+
+  REQUIRE(ids("Garden") == std::vector<std::string>{"garden"});
+  REQUIRE(ids("Bed") == std::vector<std::string>{"bed0", "bed1", "bed2"});
+  REQUIRE(ids("Plant").size() == 12);
+  REQUIRE(mgr.getEntitiesBySchema("Tree") == nullptr);
+
+  // Deleting a bed drops it and its plants; deleting again changes nothing.
+  REQUIRE(mgr.removeEntity("bed1"));
+  REQUIRE(mgr.removeEntity("bed1"));
+  REQUIRE(mgr.removeEntity("bed0_plant0"));
+  REQUIRE(ids("Bed") == std::vector<std::string>{"bed0", "bed2"});
+  REQUIRE(ids("Plant") == std::vector<std::string>{"bed0_plant1", "bed0_plant2", "bed0_plant3",
+                                                   "bed2_plant0", "bed2_plant1", "bed2_plant2", "bed2_plant3"});
+
+  // Adding an entity under an id in use fails and leaves the index as it was.
+  auto duplicate = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Plant"));
+  duplicate->setId("bed2_plant0");
+  duplicate->setParentId("bed2");
+  REQUIRE_THROWS_WITH(mgr.addEntity(std::move(duplicate)), "Entity already exists: bed2_plant0");
+  REQUIRE(ids("Plant").size() == 7);
+
+  auto added = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Plant"));
+  added->setId("bed2_plant4");
+  added->setParentId("bed2");
+  mgr.addEntity(std::move(added));
+  REQUIRE(ids("Plant").size() == 8);
+
+  mgr.clear();
+  REQUIRE(mgr.getEntitiesBySchema("Plant") == nullptr);
+}
+
+TEST_CASE("EntityManager keeps field indexes current")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["device.yaml"] = R"(
+entity_name: Device
+fields:
+  serial:
+    type: string
+    unique: true
+  model:
+    type: enum
+    values: [hub, plug, bulb]
+    index: true
+  watts:
+    type: integer
+    index: true
+  peer:
+    type: reference
+    target: Device
+    index: true
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"devices.yaml", R"(
+d1:
+  _schema: Device
+  serial: SN-1
+  model: hub
+  watts: 5
+d2:
+  _schema: Device
+  serial: SN-2
+  model: plug
+  watts: 5
+  peer: d1
+d3:
+  _schema: Device
+  model: plug
+  peer: d1
+)"}});
+
+  auto find = [&](const std::string &field, const nlohmann::json &value)
+  {
+    std::vector<std::string> out;
+    for (const Entity *entity : mgr.findByField("Device", field, value))
+      out.push_back(entity->getId());
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+
+  REQUIRE(find("serial", "SN-2") == std::vector<std::string>{"d2"});
+  REQUIRE(find("serial", "SN-9").empty());
+  REQUIRE(find("model", "plug") == std::vector<std::string>{"d2", "d3"});
+  REQUIRE(find("watts", 5) == std::vector<std::string>{"d1", "d2"});
+  REQUIRE(find("watts", "5") == std::vector<std::string>{"d1", "d2"});
+  REQUIRE(find("peer", "d1") == std::vector<std::string>{"d2", "d3"});
+  REQUIRE(find("peer", "nowhere").empty());
+
+  REQUIRE_THROWS(mgr.findByField("Device", "watts", "lots"));
+  REQUIRE_THROWS(mgr.findByField("Device", "colour", "red"));
+  REQUIRE_THROWS(mgr.findByField("Lamp", "serial", "SN-1"));
+  REQUIRE_THROWS_WITH(mgr.findByField("Device", "serial", nullptr), "Empty values are not indexed");
+
+  // Writes move entities between buckets.
+  mgr.setFieldValue("d3", "serial", "SN-3");
+  mgr.setFieldJson("d2", "model", "bulb");
+  mgr.setFieldJson("d1", "watts", 7);
+  REQUIRE(find("serial", "SN-3") == std::vector<std::string>{"d3"});
+  REQUIRE(find("model", "plug") == std::vector<std::string>{"d3"});
+  REQUIRE(find("model", "bulb") == std::vector<std::string>{"d2"});
+  REQUIRE(find("watts", 5) == std::vector<std::string>{"d2"});
+  REQUIRE(find("watts", 7) == std::vector<std::string>{"d1"});
+
+  // A taken unique value, or an invalid one, leaves the field as it was.
+  REQUIRE_THROWS_WITH(mgr.setFieldValue("d3", "serial", "SN-1"),
+                      "Duplicate value 'SN-1' for unique field 'Device.serial': entities 'd1' and 'd3'");
+  REQUIRE(mgr.getEntityById("d3")->getFieldValue("serial")->toString() == "SN-3");
+  REQUIRE(find("serial", "SN-3") == std::vector<std::string>{"d3"});
+  REQUIRE_THROWS(mgr.setFieldValue("d1", "watts", "lots"));
+  REQUIRE(find("watts", 7) == std::vector<std::string>{"d1"});
+  mgr.setFieldValue("d3", "serial", "SN-3");
+  REQUIRE(find("serial", "SN-3") == std::vector<std::string>{"d3"});
+
+  // New entities are checked before anything is stored.
+  auto clash = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Device"));
+  clash->setId("d4");
+  clash->setFieldValue("serial", "SN-2");
+  REQUIRE_THROWS(mgr.addEntity(std::move(clash)));
+  REQUIRE(mgr.getEntityById("d4") == nullptr);
+  REQUIRE(mgr.getEntitiesBySchema("Device")->size() == 3);
+
+  // Deleted entities leave every index, and free their unique values.
+  REQUIRE(mgr.removeEntity("d1"));
+  REQUIRE(find("serial", "SN-1").empty());
+  REQUIRE(find("watts", 7).empty());
+  auto reuse = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Device"));
+  reuse->setId("d5");
+  reuse->setFieldValue("serial", "SN-1");
+  mgr.addEntity(std::move(reuse));
+  REQUIRE(find("serial", "SN-1") == std::vector<std::string>{"d5"});
+
+  // Duplicates in a bundle fail the load.
+  REQUIRE_THROWS_WITH(mgr.parseDataBundle({{"devices.yaml", R"(
+a:
+  _schema: Device
+  serial: SN-1
+b:
+  _schema: Device
+  serial: SN-1
+)"}}),
+                      "Duplicate value 'SN-1' for unique field 'Device.serial': entities 'a' and 'b'");
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager keeps ordered indexes in value order")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["sensor.yaml"] = R"(
+entity_name: Sensor
+fields:
+  slot:
+    type: integer
+    index: ordered
+    unique: true
+  reading:
+    type: float
+    index: ordered
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  const EntitySchema &sensor = *SchemaManager::instance().getEntitySchema("Sensor");
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"sensors.yaml", R"(
+s1:
+  _schema: Sensor
+  slot: 3
+  reading: 2.5
+s2:
+  _schema: Sensor
+  slot: 1
+  reading: -1
+s3:
+  _schema: Sensor
+  slot: 2
+  reading: 2.5
+s4:
+  _schema: Sensor
+)"}});
+
+  const EntityManager &view = mgr;
+  const FieldIndex &slots = *view.getFieldIndex(sensor, sensor.getFieldId("slot"));
+  const FieldIndex &readings = *view.getFieldIndex(sensor, sensor.getFieldId("reading"));
+  REQUIRE(slots.isOrdered());
+
+  auto scan = [](const FieldIndex &index, const FieldIndex::Bound *lower, const FieldIndex::Bound *upper,
+                 bool descending = false)
+  {
+    std::vector<std::string> out;
+    index.scan(lower, upper, descending, [&](Entity *entity, const FieldIndex::OrderedKey &)
+               {
+                 out.push_back(entity->getId());
+                 return true;
+               });
+    return out;
+  };
+
+  // Empty fields are left out; equal values are ordered by id.
+  REQUIRE(scan(slots, nullptr, nullptr) == std::vector<std::string>{"s2", "s3", "s1"});
+  REQUIRE(scan(readings, nullptr, nullptr) == std::vector<std::string>{"s2", "s1", "s3"});
+  REQUIRE(scan(readings, nullptr, nullptr, true) == std::vector<std::string>{"s3", "s1", "s2"});
+
+  const FieldIndex::Bound two{std::int64_t{2}};
+  const FieldIndex::Bound belowThree{std::int64_t{3}, false};
+  const FieldIndex::Bound aboveThree{std::int64_t{3}, false};
+  REQUIRE(scan(slots, &two, nullptr) == std::vector<std::string>{"s3", "s1"});
+  REQUIRE(scan(slots, nullptr, &belowThree) == std::vector<std::string>{"s2", "s3"});
+  REQUIRE(scan(slots, &aboveThree, nullptr).empty());
+  REQUIRE(scan(slots, &aboveThree, &two).empty());
+
+  // Stopping early reports that the range was not exhausted.
+  std::size_t visited = 0;
+  REQUIRE_FALSE(slots.scan(nullptr, nullptr, false, [&](Entity *, const FieldIndex::OrderedKey &)
+                           { return ++visited < 2; }));
+  REQUIRE(visited == 2);
+
+  auto find = [&](const std::string &field, const nlohmann::json &value)
+  {
+    std::vector<std::string> out;
+    for (const Entity *entity : mgr.findByField("Sensor", field, value))
+      out.push_back(entity->getId());
+    return out;
+  };
+  REQUIRE(find("reading", 2.5) == std::vector<std::string>{"s1", "s3"});
+  REQUIRE(find("reading", -1) == std::vector<std::string>{"s2"});
+
+  // Writes and deletes move entities within the order.
+  mgr.setFieldJson("s4", "slot", 0);
+  mgr.setFieldJson("s1", "reading", -2);
+  REQUIRE(scan(slots, nullptr, nullptr) == std::vector<std::string>{"s4", "s2", "s3", "s1"});
+  REQUIRE(scan(readings, nullptr, nullptr) == std::vector<std::string>{"s1", "s2", "s3"});
+  REQUIRE_THROWS_WITH(mgr.setFieldJson("s2", "slot", 2),
+                      "Duplicate value '2' for unique field 'Sensor.slot': entities 's3' and 's2'");
+  REQUIRE(scan(slots, nullptr, nullptr) == std::vector<std::string>{"s4", "s2", "s3", "s1"});
+  REQUIRE(mgr.removeEntity("s3"));
+  REQUIRE(scan(slots, nullptr, nullptr) == std::vector<std::string>{"s4", "s2", "s1"});
+  REQUIRE(find("reading", 2.5).empty());
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager indexes references by target")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["rack.yaml"] = R"(
+entity_name: Rack
+children:
+  nodes:
+    entity: Node
+fields:
+  name:
+    type: string
+)";
+  schemas["node.yaml"] = R"(
+entity_name: Node
+fields:
+  peer:
+    type: reference
+    target: Node
+    index: true
+  mount:
+    type: object
+    fields:
+      host:
+        type: reference
+        target: Node
+  links:
+    type: array
+    element:
+      type: reference
+      target: Node
+  rack:
+    type: reference
+    target: Rack
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"nodes.yaml", R"(
+r1:
+  _schema: Rack
+n1:
+  _schema: Node
+  _parentid: r1
+  rack: r1
+n2:
+  _schema: Node
+  peer: n1
+  mount:
+    host: n1
+  links: [n1, n3, n1]
+n3:
+  _schema: Node
+  peer: n1
+  links: [n2]
+)"}});
+
+  auto referrers = [&](const std::string &target)
+  {
+    std::vector<std::string> out;
+    for (const auto &referrer : mgr.getReferrers(target))
+      out.push_back(referrer.entity->getId() + "." + referrer.entity->getSchema().getField(referrer.fieldId)->getName());
+    return out;
+  };
+  auto fields = [&](const std::string &id)
+  { return nlohmann::json::parse(mgr.getEntityById(id)->getJson()); };
+
+  // Each referencing field is listed once, nested references included.
+  REQUIRE(referrers("n1") == std::vector<std::string>{"n2.peer", "n2.mount", "n2.links", "n3.peer"});
+  REQUIRE(referrers("n2") == std::vector<std::string>{"n3.links"});
+  REQUIRE(referrers("r1") == std::vector<std::string>{"n1.rack"});
+  REQUIRE(referrers("nowhere").empty());
+
+  // Writes move references to their new targets.
+  mgr.setFieldJson("n3", "peer", "n2");
+  mgr.setFieldJson("n2", "links", nlohmann::json::array({"n3"}));
+  REQUIRE(referrers("n1") == std::vector<std::string>{"n2.peer", "n2.mount"});
+  REQUIRE(referrers("n2") == std::vector<std::string>{"n3.peer", "n3.links"});
+  REQUIRE(referrers("n3") == std::vector<std::string>{"n2.links"});
+  REQUIRE_THROWS(mgr.setFieldValue("n3", "peer", "nowhere"));
+  REQUIRE(referrers("n2") == std::vector<std::string>{"n3.peer", "n3.links"});
+
+  // Deleting a target empties the references to it, wherever they sit, and
+  // marks their holders modified.
+  mgr.setFieldJson("n3", "links", nlohmann::json::array({"n1", "n2"}));
+  REQUIRE(mgr.removeEntity("n1"));
+  REQUIRE(referrers("n1").empty());
+  REQUIRE(fields("n2")["peer"].is_null());
+  REQUIRE(fields("n2")["mount"]["host"].is_null());
+  REQUIRE(fields("n3")["links"] == nlohmann::json::array({nullptr, "n2"}));
+  REQUIRE(mgr.getEntityById("n2")->getState() == EntityState::Modified);
+  REQUIRE(mgr.getEntityById("n3")->getState() == EntityState::Modified);
+  REQUIRE(mgr.findByField("Node", "peer", "n1").empty());
+  REQUIRE(referrers("n2") == std::vector<std::string>{"n3.peer", "n3.links"});
+
+  // A deleted entity's own references leave the index but keep their value.
+  REQUIRE(mgr.removeEntity("n3"));
+  REQUIRE(referrers("n2").empty());
+  REQUIRE(fields("n3")["peer"] == "n2");
+
+  // References from inside a deleted subtree are not cleared.
+  REQUIRE(fields("n1")["rack"] == "r1");
+  REQUIRE(mgr.getEntityById("n1")->getState() == EntityState::Deleted);
+
+  mgr.clear();
+  REQUIRE(referrers("n2").empty());
+}
+
+TEST_CASE("EntityManager unlinks deleted entities in place and cascades without recursion")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["node.yaml"] = R"(
+entity_name: Node
+children:
+  nodes:
+    entity: Node
+fields:
+  name:
+    type: string
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  const EntitySchema &node = *SchemaManager::instance().getEntitySchema("Node");
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.clear();
+  auto add = [&](const std::string &id, const std::string &parentId)
+  {
+    auto entity = std::make_unique<Entity>(node);
+    entity->setId(id);
+    entity->setParentId(parentId);
+    mgr.addEntity(std::move(entity));
+  };
+  auto ids = [](const EntityList &list)
+  {
+    std::vector<std::string> out;
+    for (const Entity *entity : list)
+      out.push_back(entity->getId());
+    return out;
+  };
+
+  add("root", "");
+  add("other", "");
+  for (int i = 0; i < 5; ++i)
+    add("c" + std::to_string(i), "root");
+
+  // Siblings keep their order, wherever the unlinked one was.
+  REQUIRE(mgr.removeEntity("c2"));
+  REQUIRE(ids(*mgr.getChildren("root")) == std::vector<std::string>{"c0", "c1", "c3", "c4"});
+  REQUIRE(mgr.removeEntity("c0"));
+  REQUIRE(mgr.removeEntity("c4"));
+  REQUIRE(ids(*mgr.getChildren("root")) == std::vector<std::string>{"c1", "c3"});
+  const EntityList &children = *mgr.getChildren("root");
+  std::vector<std::string> reversed;
+  for (auto it = children.rbegin(); it != children.rend(); ++it)
+    reversed.push_back((*it)->getId());
+  REQUIRE(reversed == std::vector<std::string>{"c3", "c1"});
+  add("c5", "root");
+  REQUIRE(ids(*mgr.getChildren("root")) == std::vector<std::string>{"c1", "c3", "c5"});
+
+  // Deleted roots leave the root list.
+  REQUIRE(mgr.removeEntity("other"));
+  REQUIRE(ids(mgr.getParents()) == std::vector<std::string>{"root"});
+
+  // A chain far deeper than the call stack could follow.
+  constexpr int depth = 100000;
+  add("d0", "c1");
+  for (int i = 1; i < depth; ++i)
+    add("d" + std::to_string(i), "d" + std::to_string(i - 1));
+  REQUIRE(mgr.removeEntity("c1"));
+  REQUIRE(mgr.getEntityById("d" + std::to_string(depth - 1))->isDeleted());
+  REQUIRE(mgr.getEntitiesBySchema("Node")->size() == 3);
+  REQUIRE(ids(*mgr.getChildren("root")) == std::vector<std::string>{"c3", "c5"});
+  REQUIRE(mgr.getChildren("d0") == nullptr);
+
+  REQUIRE(mgr.removeEntity("root"));
+  REQUIRE(mgr.getParents().empty());
+  REQUIRE(mgr.getEntitiesBySchema("Node") == nullptr);
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager purges deleted entities")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["node.yaml"] = R"(
+entity_name: Node
+children:
+  nodes:
+    entity: Node
+fields:
+  name:
+    type: string
+  peer:
+    type: reference
+    target: Node
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"a.yaml", R"(
+a1:
+  _schema: Node
+  name: first
+a2:
+  _schema: Node
+  _parentid: a1
+  name: second
+)"},
+                       {"b.yaml", R"(
+b1:
+  _schema: Node
+  name: kept
+  peer: a2
+b2:
+  _schema: Node
+  _parentid: b1
+  name: child
+b3:
+  _schema: Node
+  _parentid: b1
+  name: gone
+)"}});
+
+  auto ids = [](const EntityList &list)
+  {
+    std::vector<std::string> out;
+    for (const Entity *entity : list)
+      out.push_back(entity->getId());
+    return out;
+  };
+
+  REQUIRE(mgr.purgeDeleted().empty());
+
+  // Deleted entities stay readable until purged.
+  REQUIRE(mgr.removeEntity("a1"));
+  REQUIRE(mgr.removeEntity("b3"));
+  REQUIRE(mgr.getDeletedCount() == 3);
+  REQUIRE(mgr.getEntityById("a2")->isDeleted());
+  REQUIRE(mgr.getEntityById("b1")->getState() == EntityState::Modified);
+
+  REQUIRE(mgr.purgeDeleted() == std::vector<std::string>{"a1", "a2", "b3"});
+  REQUIRE(mgr.getDeletedCount() == 0);
+  REQUIRE(mgr.getEntityById("a1") == nullptr);
+  REQUIRE(mgr.getEntityById("a2") == nullptr);
+  REQUIRE(mgr.getEntityById("b3") == nullptr);
+  REQUIRE(mgr.purgeDeleted().empty());
+
+  // The survivors, values loaded with them included, are untouched.
+  REQUIRE(ids(mgr.getParents()) == std::vector<std::string>{"b1"});
+  REQUIRE(ids(*mgr.getChildren("b1")) == std::vector<std::string>{"b2"});
+  REQUIRE(mgr.getChildren("a1") == nullptr);
+  REQUIRE(mgr.getEntitiesBySchema("Node")->size() == 2);
+  REQUIRE(mgr.getEntityById("b2")->getFieldValue("name")->toString() == "child");
+  REQUIRE(mgr.getReferrers("a2").empty());
+
+  // Entities created since the load live on the heap, and purge the same way.
+  auto entity = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Node"));
+  entity->setId("c1");
+  entity->setParentId("b2");
+  mgr.addEntity(std::move(entity));
+  mgr.setFieldValue("b1", "peer", "c1");
+  REQUIRE(mgr.removeEntity("b2"));
+  REQUIRE(mgr.purgeDeleted() == std::vector<std::string>{"b2", "c1"});
+  REQUIRE(mgr.getChildren("b1")->empty());
+  REQUIRE(nlohmann::json::parse(mgr.getEntityById("b1")->getJson())["peer"].is_null());
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityManager purges automatically past a deleted ratio")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["node.yaml"] = R"(
+entity_name: Node
+fields:
+  name:
+    type: string
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  const EntitySchema &node = *SchemaManager::instance().getEntitySchema("Node");
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.clear();
+  for (int i = 0; i < 10; ++i)
+  {
+    auto entity = std::make_unique<Entity>(node);
+    entity->setId("n" + std::to_string(i));
+    mgr.addEntity(std::move(entity));
+  }
+
+  mgr.setAutoPurgeRatio(0.25);
+  REQUIRE(mgr.removeEntity("n0"));
+  REQUIRE(mgr.removeEntity("n1"));
+  REQUIRE(mgr.getDeletedCount() == 2);
+  REQUIRE(mgr.takePurgedIds().empty());
+
+  // The third deletion crosses 25% of the store.
+  REQUIRE(mgr.removeEntity("n2"));
+  REQUIRE(mgr.getDeletedCount() == 0);
+  REQUIRE(mgr.getEntityById("n0") == nullptr);
+  REQUIRE(mgr.takePurgedIds() == std::vector<std::string>{"n0", "n1", "n2"});
+  REQUIRE(mgr.takePurgedIds().empty());
+
+  // Counted against the store as it is after purging.
+  REQUIRE(mgr.removeEntity("n3"));
+  REQUIRE(mgr.getDeletedCount() == 1);
+  REQUIRE(mgr.removeEntity("n4"));
+  REQUIRE(mgr.takePurgedIds() == std::vector<std::string>{"n3", "n4"});
+
+  mgr.setAutoPurgeRatio(0);
+  REQUIRE(mgr.removeEntity("n5"));
+  REQUIRE(mgr.getDeletedCount() == 1);
+  mgr.clear();
+  REQUIRE(mgr.getDeletedCount() == 0);
+}
+
+TEST_CASE("EntityManager edits loaded entities without growing their arena")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["note.yaml"] = R"(
+entity_name: Note
+fields:
+  text:
+    type: string
+  tags:
+    type: array
+    element:
+      type: string
+  meta:
+    type: object
+    fields:
+      author:
+        type: string
+)";
+  SchemaManager::instance().parseSchemaBundle(schemas);
+
+  // Stands in for a data file's arena, counting what is taken from it.
+  struct CountingResource : std::pmr::memory_resource
+  {
+    std::size_t allocated = 0;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      allocated += bytes;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) override
+    {
+      std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+  } arena;
+
+  EntityManager &mgr = EntityManager::instance();
+  mgr.clear();
+  {
+    FieldArena::Scope scope(&arena);
+    auto note = std::make_unique<Entity>(*SchemaManager::instance().getEntitySchema("Note"));
+    note->setId("note1");
+    note->setFieldValue("text", "loaded");
+    note->setFieldJson("tags", nlohmann::json::array({"a", "b"}));
+    note->setFieldJson("meta", {{"author", "ann"}});
+    mgr.addEntity(std::move(note));
+  }
+  const std::size_t loaded = arena.allocated;
+  REQUIRE(loaded > 0);
+
+  for (int i = 1; i <= 50; ++i)
+  {
+    mgr.setFieldValue("note1", "text", std::string(i * 40, 'x'));
+    mgr.setFieldJson("note1", "tags", nlohmann::json(std::vector<std::string>(i, std::string(i, 't'))));
+    mgr.setFieldJson("note1", "meta", {{"author", std::string(i * 40, 'y')}});
+  }
+  REQUIRE(arena.allocated == loaded);
+
+  auto fields = nlohmann::json::parse(mgr.getEntityById("note1")->getJson());
+  REQUIRE(fields["text"] == std::string(2000, 'x'));
+  REQUIRE(fields["tags"].size() == 50);
+  REQUIRE(fields["meta"]["author"] == std::string(2000, 'y'));
+
+  mgr.clear();
+}
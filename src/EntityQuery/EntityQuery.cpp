@@ -0,0 +1,774 @@
+#include "EntityQuery.h"
+#include "Entity.h"
+#include "EntitySchema.h"
+#include "JsonWriter.h"
+#include "ObjectFieldSchema.h"
+#include "ObjectFieldValue.h"
+#include "PrimitiveFieldValue.h"
+#include "SchemaManager.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace
+{
+    // A field value or query constant as compared; strings are borrowed.
+    using ScalarView = std::variant<std::monostate, std::int64_t, double, bool, std::string_view>;
+
+    enum class PseudoField
+    {
+        None,
+        Id,
+        ParentId,
+        Schema,
+        State
+    };
+
+    // A path split once per query; the FieldId of `field` differs per schema.
+    struct Path
+    {
+        PseudoField pseudo = PseudoField::None;
+        std::string field;
+        std::vector<std::string> members;
+    };
+
+    Path parsePath(const std::string &text)
+    {
+        Path path;
+        if (text == "_id")
+            path.pseudo = PseudoField::Id;
+        else if (text == "_parentid")
+            path.pseudo = PseudoField::ParentId;
+        else if (text == "_schema")
+            path.pseudo = PseudoField::Schema;
+        else if (text == "_state")
+            path.pseudo = PseudoField::State;
+        if (path.pseudo != PseudoField::None)
+            return path;
+
+        std::size_t start = 0;
+        while (true)
+        {
+            std::size_t dot = text.find('.', start);
+            std::string segment = text.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+            if (segment.empty())
+                throw std::runtime_error("Invalid field path: '" + text + "'");
+            if (path.field.empty())
+                path.field = std::move(segment);
+            else
+                path.members.push_back(std::move(segment));
+            if (dot == std::string::npos)
+                return path;
+            start = dot + 1;
+        }
+    }
+
+    ScalarView viewOf(const FieldCell &cell)
+    {
+        switch (cell.getKind())
+        {
+        case FieldCell::Kind::Integer:
+            return cell.getInteger();
+        case FieldCell::Kind::Float:
+            return cell.getFloat();
+        case FieldCell::Kind::Boolean:
+            return cell.getBoolean();
+        case FieldCell::Kind::String:
+            return cell.getString();
+        case FieldCell::Kind::Empty:
+            break;
+        }
+        return std::monostate{};
+    }
+
+    ScalarView viewOf(const QueryValue &value)
+    {
+        return std::visit([](const auto &v) -> ScalarView
+                          { return v; },
+                          value);
+    }
+
+    bool isNumber(const ScalarView &value)
+    {
+        return std::holds_alternative<std::int64_t>(value) || std::holds_alternative<double>(value);
+    }
+
+    double asDouble(const ScalarView &value)
+    {
+        if (auto *integer = std::get_if<std::int64_t>(&value))
+            return static_cast<double>(*integer);
+        return std::get<double>(value);
+    }
+
+    // Float fields store float precision, so a number compared with one is
+    // rounded the same way: 0.1 in a query equals the 0.1 that was stored.
+    double toFloatPrecision(double value)
+    {
+        if (std::fabs(value) > std::numeric_limits<float>::max())
+            return value; // beyond every float, and not representable as one
+        return static_cast<double>(static_cast<float>(value));
+    }
+
+    template <typename T>
+    int threeWay(const T &a, const T &b)
+    {
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    // nullopt if the values have no order between them (different types).
+    std::optional<int> compare(const ScalarView &a, const ScalarView &b)
+    {
+        if (isNumber(a) && isNumber(b))
+        {
+            if (a.index() == b.index() && std::holds_alternative<std::int64_t>(a))
+                return threeWay(std::get<std::int64_t>(a), std::get<std::int64_t>(b));
+            return threeWay(asDouble(a), asDouble(b));
+        }
+        if (a.index() != b.index())
+            return std::nullopt;
+
+        switch (a.index())
+        {
+        case 0:
+            return 0;
+        case 3:
+            return threeWay(std::get<bool>(a), std::get<bool>(b));
+        case 4:
+            return threeWay(std::get<std::string_view>(a), std::get<std::string_view>(b));
+        }
+        return std::nullopt;
+    }
+
+    // The node an object member path leads to, or nullptr.
+    const FieldValue *memberNode(const Entity &entity, const Path &path, FieldId fieldId)
+    {
+        const FieldValue *node = entity.getFieldNode(fieldId);
+        for (const auto &member : path.members)
+        {
+            auto *object = dynamic_cast<const ObjectFieldValue *>(node);
+            if (!object)
+                return nullptr;
+            node = object->getFieldValue(member);
+        }
+        return node;
+    }
+
+    // Value at `path`; nullopt if the entity has no scalar there.
+    std::optional<ScalarView> valueAt(const Entity &entity, const Path &path, FieldId fieldId)
+    {
+        switch (path.pseudo)
+        {
+        case PseudoField::Id:
+            return std::string_view(entity.getId());
+        case PseudoField::ParentId:
+            if (entity.getParentId().empty())
+                return ScalarView{};
+            return std::string_view(entity.getParentId());
+        case PseudoField::Schema:
+            return std::string_view(entity.getSchema().getName());
+        case PseudoField::State:
+            return std::string_view(entityStateName(entity.getState()));
+        case PseudoField::None:
+            break;
+        }
+
+        if (fieldId == InvalidFieldId)
+            return std::nullopt;
+        if (path.members.empty())
+        {
+            if (const FieldCell *cell = entity.getFieldCell(fieldId))
+                return viewOf(*cell);
+            return std::nullopt;
+        }
+        if (auto *primitive = dynamic_cast<const PrimitiveFieldValue *>(memberNode(entity, path, fieldId)))
+            return viewOf(primitive->getCell());
+        return std::nullopt;
+    }
+
+    // `operand` as compared with `value`; only float fields hold doubles.
+    ScalarView operandFor(const ScalarView &value, const QueryValue &operand)
+    {
+        ScalarView view = viewOf(operand);
+        if (std::holds_alternative<double>(value) && isNumber(view))
+            return toFloatPrecision(asDouble(view));
+        return view;
+    }
+
+    bool matches(const std::optional<ScalarView> &value, QueryOp op, const std::vector<QueryValue> &operands)
+    {
+        if (!value)
+            return false;
+
+        if (op == QueryOp::In || op == QueryOp::Eq || op == QueryOp::Ne)
+        {
+            bool equal = std::any_of(operands.begin(), operands.end(), [&](const QueryValue &operand)
+                                     { return compare(*value, operandFor(*value, operand)) == 0; });
+            return op == QueryOp::Ne ? !equal : equal;
+        }
+
+        if (std::holds_alternative<std::monostate>(*value))
+            return false;
+        std::optional<int> order = compare(*value, operandFor(*value, operands.front()));
+        if (!order)
+            return false;
+        switch (op)
+        {
+        case QueryOp::Lt:
+            return *order < 0;
+        case QueryOp::Lte:
+            return *order <= 0;
+        case QueryOp::Gt:
+            return *order > 0;
+        case QueryOp::Gte:
+            return *order >= 0;
+        default:
+            return false;
+        }
+    }
+
+    // Orders two sort keys; empty or missing values go last either way.
+    int compareKeys(const std::optional<ScalarView> &a, const std::optional<ScalarView> &b, bool descending)
+    {
+        const bool aEmpty = !a || std::holds_alternative<std::monostate>(*a);
+        const bool bEmpty = !b || std::holds_alternative<std::monostate>(*b);
+        if (aEmpty || bEmpty)
+            return threeWay(aEmpty, bEmpty);
+
+        std::optional<int> order = compare(*a, *b);
+        int result = order ? *order : threeWay(a->index(), b->index());
+        return descending ? -result : result;
+    }
+
+    void checkPath(const EntitySchema &schema, const Path &path, const std::string &text)
+    {
+        if (path.pseudo != PseudoField::None)
+            return;
+
+        const FieldSchema *field = schema.getField(path.field);
+        for (const auto &member : path.members)
+        {
+            auto *object = dynamic_cast<const ObjectFieldSchema *>(field);
+            field = object ? object->getField(member) : nullptr;
+        }
+        if (!field)
+            throw std::runtime_error("Unknown field '" + text + "' in schema '" + schema.getName() + "'");
+    }
+
+    bool descendsFrom(const Entity &entity, const std::string &ancestorId, const EntityManager &manager)
+    {
+        const Entity *current = &entity;
+        // Bounded by the store size in case of a parent cycle.
+        for (std::size_t steps = 0; steps <= manager.getEntityCount(); ++steps)
+        {
+            const std::string &parentId = current->getParentId();
+            if (parentId.empty())
+                return false;
+            if (parentId == ancestorId)
+                return true;
+            current = manager.getEntityById(parentId);
+            if (!current)
+                return false;
+        }
+        return false;
+    }
+
+    void collectDescendants(const EntityManager &manager, const std::string &rootId, std::vector<Entity *> &out)
+    {
+        std::vector<const std::string *> pending = {&rootId};
+        while (!pending.empty())
+        {
+            const std::string *id = pending.back();
+            pending.pop_back();
+            if (const auto *children = manager.getChildren(*id))
+            {
+                for (Entity *child : *children)
+                {
+                    out.push_back(child);
+                    pending.push_back(&child->getId());
+                }
+            }
+        }
+    }
+
+    // The cell a field of this type holds when it equals `value`, so `eq` on
+    // an indexed field can read one bucket; nullopt where the types call for
+    // the comparison rules of a scan instead.
+    std::optional<FieldCell> cellFor(const FieldSchema &field, const QueryValue &value)
+    {
+        const std::string type = field.getTypeName();
+        FieldCell cell;
+        if (type == "integer")
+        {
+            if (auto *integer = std::get_if<std::int64_t>(&value))
+                cell.setInteger(*integer);
+            else
+                return std::nullopt;
+        }
+        else if (type == "float")
+        {
+            if (auto *number = std::get_if<double>(&value))
+                cell.setFloat(toFloatPrecision(*number));
+            else if (auto *integer = std::get_if<std::int64_t>(&value))
+                cell.setFloat(toFloatPrecision(static_cast<double>(*integer)));
+            else
+                return std::nullopt;
+        }
+        else if (type == "boolean")
+        {
+            if (auto *flag = std::get_if<bool>(&value))
+                cell.setBoolean(*flag);
+            else
+                return std::nullopt;
+        }
+        else if (type == "string" || type == "enum" || type == "reference")
+        {
+            if (auto *text = std::get_if<std::string>(&value))
+                cell.setString(*text);
+            else
+                return std::nullopt;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+        return cell;
+    }
+
+    // Narrows `bound` (the lower one for gt/gte, else the upper one) to
+    // `op value`, converted to the type of the ordered index over `field`.
+    // Returns false if the value is not a number.
+    bool tighten(std::optional<FieldIndex::Bound> &lower, std::optional<FieldIndex::Bound> &upper,
+                 const FieldSchema &field, QueryOp op, const QueryValue &value)
+    {
+        const bool isLower = op == QueryOp::Gt || op == QueryOp::Gte;
+        bool inclusive = op == QueryOp::Gte || op == QueryOp::Lte;
+        const auto *integer = std::get_if<std::int64_t>(&value);
+        const auto *number = std::get_if<double>(&value);
+        if ((!integer && !number) || (number && std::isnan(*number)))
+            return false;
+
+        FieldIndex::OrderedKey key;
+        if (field.getTypeName() == "float")
+        {
+            key = toFloatPrecision(integer ? static_cast<double>(*integer) : *number);
+        }
+        else if (integer)
+        {
+            key = *integer;
+        }
+        else
+        {
+            // The nearest integer inside the range, included; past the ends
+            // of int64 the range is either everything or nothing.
+            const double edge = isLower ? (inclusive ? std::ceil(*number) : std::floor(*number) + 1)
+                                        : (inclusive ? std::floor(*number) : std::ceil(*number) - 1);
+            constexpr double limit = 9223372036854775808.0; // 2^63
+            if (edge >= limit)
+            {
+                key = std::numeric_limits<std::int64_t>::max();
+                inclusive = !isLower;
+            }
+            else if (edge < -limit)
+            {
+                key = std::numeric_limits<std::int64_t>::min();
+                inclusive = isLower;
+            }
+            else
+            {
+                key = static_cast<std::int64_t>(edge);
+                inclusive = true;
+            }
+        }
+
+        auto &bound = isLower ? lower : upper;
+        const bool tighter = !bound || (isLower ? bound->key < key : key < bound->key) ||
+                             (key == bound->key && !inclusive);
+        if (tighter)
+            bound = FieldIndex::Bound{key, inclusive};
+        return true;
+    }
+
+    // Feeds `consider` from the field indexes of `schema` instead of all its
+    // entities, when the query allows it:
+    //  - eq on an indexed field reads that value's entities;
+    //  - range predicates on a field with an ordered index read that range;
+    //  - ordering by such a field with a limit walks it in order and stops
+    //    once `limit` matches are found and the last one's ties are complete.
+    // Returns false, with `results` left empty, if the schema has to be
+    // scanned after all.
+    template <typename Consider>
+    bool scanIndexes(const EntityManager &manager, const EntitySchema &schema, const EntityQueryConfig &config,
+                     const std::vector<Path> &wherePaths, const std::vector<Path> &orderPaths,
+                     std::vector<Entity *> &results, Consider &&consider)
+    {
+        auto indexAt = [&](const Path &path) -> const FieldIndex *
+        {
+            if (path.pseudo != PseudoField::None || !path.members.empty())
+                return nullptr;
+            return manager.getFieldIndex(schema, schema.getFieldId(path.field));
+        };
+
+        const FieldIndex *rangeIndex = nullptr;
+        std::optional<FieldIndex::Bound> lower;
+        std::optional<FieldIndex::Bound> upper;
+        for (std::size_t i = 0; i < wherePaths.size(); ++i)
+        {
+            const QueryPredicate &predicate = config.where[i];
+            const FieldIndex *index = indexAt(wherePaths[i]);
+            if (!index)
+                continue;
+            const FieldSchema &field = *schema.getField(index->getFieldId());
+
+            if (predicate.op == QueryOp::Eq)
+            {
+                if (auto cell = cellFor(field, predicate.values.front()))
+                {
+                    for (Entity *entity : index->find(*cell))
+                        consider(entity);
+                    return true;
+                }
+            }
+            else if (predicate.op != QueryOp::Ne && predicate.op != QueryOp::In && index->isOrdered() &&
+                     (!rangeIndex || rangeIndex == index) &&
+                     tighten(lower, upper, field, predicate.op, predicate.values.front()))
+            {
+                rangeIndex = index;
+            }
+        }
+
+        const FieldIndex *orderIndex = config.limit && !orderPaths.empty() ? indexAt(orderPaths.front()) : nullptr;
+        if (orderIndex && (!orderIndex->isOrdered() || (rangeIndex && rangeIndex != orderIndex)))
+            orderIndex = nullptr;
+        if (!rangeIndex && !orderIndex)
+            return false;
+
+        const FieldIndex &index = rangeIndex ? *rangeIndex : *orderIndex;
+        const bool descending = orderIndex && config.orderBy.front().descending;
+        std::optional<FieldIndex::OrderedKey> lastKey;
+        const bool exhausted = index.scan(lower ? &*lower : nullptr, upper ? &*upper : nullptr, descending,
+                                          [&](Entity *entity, const FieldIndex::OrderedKey &key)
+                                          {
+                                              if (orderIndex && results.size() >= config.limit && key != *lastKey)
+                                                  return false;
+                                              if (consider(entity))
+                                                  lastKey = key;
+                                              return true;
+                                          });
+
+        // Entities without a value sort after all indexed ones; unless a
+        // range excludes them, too few matches means they are needed.
+        if (!rangeIndex && exhausted && results.size() < config.limit)
+        {
+            results.clear();
+            return false;
+        }
+        return true;
+    }
+
+    QueryValue queryValue(const json &value)
+    {
+        switch (value.type())
+        {
+        case json::value_t::null:
+            return std::monostate{};
+        case json::value_t::boolean:
+            return value.get<bool>();
+        case json::value_t::number_integer:
+            return value.get<std::int64_t>();
+        case json::value_t::number_unsigned:
+            if (value.get<std::uint64_t>() <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+                return value.get<std::int64_t>();
+            return value.get<double>();
+        case json::value_t::number_float:
+            return value.get<double>();
+        case json::value_t::string:
+            return value.get<std::string>();
+        default:
+            throw std::runtime_error("Query values must be strings, numbers, booleans or null");
+        }
+    }
+
+    QueryOp queryOp(const std::string &name)
+    {
+        static const std::unordered_map<std::string, QueryOp> ops = {
+            {"eq", QueryOp::Eq}, {"ne", QueryOp::Ne}, {"lt", QueryOp::Lt}, {"lte", QueryOp::Lte}, {"gt", QueryOp::Gt}, {"gte", QueryOp::Gte}, {"in", QueryOp::In}};
+        auto it = ops.find(name);
+        if (it == ops.end())
+            throw std::runtime_error("Unknown query operator: " + name);
+        return it->second;
+    }
+
+    [[noreturn]] void invalid(const std::string &key)
+    {
+        throw std::runtime_error("Missing or invalid '" + key + "'");
+    }
+}
+
+EntityQuery::EntityQuery(EntityQueryConfig config) : config_(std::move(config))
+{
+    for (const auto &predicate : config_.where)
+    {
+        if (predicate.values.empty() || (predicate.op != QueryOp::In && predicate.values.size() != 1))
+            throw std::runtime_error("Predicate on '" + predicate.path + "' needs exactly one value" +
+                                     (predicate.op == QueryOp::In ? "" : " (or use 'in')"));
+    }
+}
+
+EntityQuery EntityQuery::fromJson(const json &spec)
+{
+    if (!spec.is_object())
+        throw std::runtime_error("Query must be a JSON object");
+
+    EntityQueryConfig config;
+    auto text = [&](const char *key, std::string &out)
+    {
+        auto it = spec.find(key);
+        if (it == spec.end() || it->is_null())
+            return;
+        if (!it->is_string())
+            invalid(key);
+        out = it->get<std::string>();
+    };
+    text("schema", config.schema);
+    text("parent", config.parentId);
+    text("ancestor", config.ancestorId);
+
+    if (auto it = spec.find("where"); it != spec.end() && !it->is_null())
+    {
+        if (!it->is_array())
+            invalid("where");
+        for (const json &item : *it)
+        {
+            if (!item.is_object() || !item.contains("field") || !item["field"].is_string() || !item.contains("value"))
+                throw std::runtime_error("Invalid query predicate: " + item.dump());
+
+            QueryPredicate predicate;
+            predicate.path = item["field"].get<std::string>();
+            if (auto op = item.find("op"); op != item.end())
+            {
+                if (!op->is_string())
+                    throw std::runtime_error("Invalid query predicate: " + item.dump());
+                predicate.op = queryOp(op->get<std::string>());
+            }
+
+            const json &value = item["value"];
+            if (predicate.op == QueryOp::In)
+            {
+                if (!value.is_array())
+                    throw std::runtime_error("'in' on '" + predicate.path + "' needs an array value");
+                for (const json &candidate : value)
+                    predicate.values.push_back(queryValue(candidate));
+            }
+            else
+            {
+                predicate.values.push_back(queryValue(value));
+            }
+            config.where.push_back(std::move(predicate));
+        }
+    }
+
+    if (auto it = spec.find("orderBy"); it != spec.end() && !it->is_null())
+    {
+        const json orders = it->is_array() ? *it : json::array({*it});
+        for (const json &item : orders)
+        {
+            if (item.is_string())
+            {
+                config.orderBy.push_back({item.get<std::string>(), false});
+            }
+            else if (item.is_object() && item.contains("field") && item["field"].is_string())
+            {
+                auto descending = item.find("descending");
+                if (descending != item.end() && !descending->is_boolean())
+                    invalid("descending");
+                config.orderBy.push_back({item["field"].get<std::string>(), descending != item.end() && descending->get<bool>()});
+            }
+            else
+            {
+                invalid("orderBy");
+            }
+        }
+    }
+
+    if (auto it = spec.find("limit"); it != spec.end() && !it->is_null())
+    {
+        if (!it->is_number_integer() || it->get<std::int64_t>() < 0)
+            invalid("limit");
+        config.limit = it->get<std::size_t>();
+    }
+
+    if (auto it = spec.find("includeDeleted"); it != spec.end() && !it->is_null())
+    {
+        if (!it->is_boolean())
+            invalid("includeDeleted");
+        config.includeDeleted = it->get<bool>();
+    }
+
+    return EntityQuery(std::move(config));
+}
+
+std::vector<Entity *> EntityQuery::execute(const EntityManager &manager) const
+{
+    std::vector<Path> wherePaths;
+    std::vector<Path> orderPaths;
+    for (const auto &predicate : config_.where)
+        wherePaths.push_back(parsePath(predicate.path));
+    for (const auto &order : config_.orderBy)
+        orderPaths.push_back(parsePath(order.path));
+
+    const EntitySchema *schema = nullptr;
+    if (!config_.schema.empty())
+    {
+        schema = SchemaManager::instance().getEntitySchema(config_.schema);
+        if (!schema)
+            throw std::runtime_error("Schema not found: " + config_.schema);
+        for (std::size_t i = 0; i < wherePaths.size(); ++i)
+            checkPath(*schema, wherePaths[i], config_.where[i].path);
+        for (std::size_t i = 0; i < orderPaths.size(); ++i)
+            checkPath(*schema, orderPaths[i], config_.orderBy[i].path);
+    }
+
+    // Top-level FieldIds of the where paths, then the order paths, per schema.
+    std::unordered_map<const EntitySchema *, std::vector<FieldId>> fieldIdsBySchema;
+    auto fieldIds = [&](const EntitySchema &entitySchema) -> const std::vector<FieldId> &
+    {
+        auto [it, inserted] = fieldIdsBySchema.try_emplace(&entitySchema);
+        if (inserted)
+        {
+            for (const auto *paths : {&wherePaths, &orderPaths})
+            {
+                for (const Path &path : *paths)
+                    it->second.push_back(path.pseudo == PseudoField::None ? entitySchema.getFieldId(path.field) : InvalidFieldId);
+            }
+        }
+        return it->second;
+    };
+
+    // Children of a parent outside the ancestor's subtree cannot match.
+    if (!config_.parentId.empty() && !config_.ancestorId.empty() && config_.parentId != config_.ancestorId)
+    {
+        const Entity *parent = manager.getEntityById(config_.parentId);
+        if (!parent || !descendsFrom(*parent, config_.ancestorId, manager))
+            return {};
+    }
+
+    std::vector<Entity *> results;
+    auto consider = [&](Entity *entity)
+    {
+        if (schema && &entity->getSchema() != schema)
+            return false;
+        if (entity->isDeleted() && !config_.includeDeleted)
+            return false;
+
+        const auto &ids = fieldIds(entity->getSchema());
+        for (std::size_t i = 0; i < wherePaths.size(); ++i)
+        {
+            if (!matches(valueAt(*entity, wherePaths[i], ids[i]), config_.where[i].op, config_.where[i].values))
+                return false;
+        }
+        results.push_back(entity);
+        return true;
+    };
+
+    if (!config_.parentId.empty())
+    {
+        if (const auto *children = manager.getChildren(config_.parentId))
+        {
+            for (Entity *child : *children)
+                consider(child);
+        }
+    }
+    else if (!config_.ancestorId.empty())
+    {
+        std::vector<Entity *> descendants;
+        collectDescendants(manager, config_.ancestorId, descendants);
+        for (Entity *descendant : descendants)
+            consider(descendant);
+    }
+    else if (schema && !config_.includeDeleted)
+    {
+        if (!scanIndexes(manager, *schema, config_, wherePaths, orderPaths, results, consider))
+        {
+            if (const auto *members = manager.getEntitiesBySchema(config_.schema))
+            {
+                for (Entity *member : *members)
+                    consider(member);
+            }
+        }
+    }
+    else
+    {
+        for (Entity *entity : manager.getAllEntities())
+            consider(entity);
+    }
+
+    // Sort keys are read once per match, not once per comparison.
+    const std::size_t keyCount = orderPaths.size();
+    std::vector<std::optional<ScalarView>> keys(results.size() * keyCount);
+    for (std::size_t r = 0; r < results.size(); ++r)
+    {
+        const auto &ids = fieldIds(results[r]->getSchema());
+        for (std::size_t k = 0; k < keyCount; ++k)
+            keys[r * keyCount + k] = valueAt(*results[r], orderPaths[k], ids[wherePaths.size() + k]);
+    }
+
+    std::vector<std::size_t> order(results.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto before = [&](std::size_t a, std::size_t b)
+    {
+        for (std::size_t k = 0; k < keyCount; ++k)
+        {
+            if (int c = compareKeys(keys[a * keyCount + k], keys[b * keyCount + k], config_.orderBy[k].descending))
+                return c < 0;
+        }
+        return results[a]->getId() < results[b]->getId();
+    };
+
+    const std::size_t count = config_.limit ? std::min(config_.limit, results.size()) : results.size();
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), before);
+
+    std::vector<Entity *> sorted;
+    sorted.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        sorted.push_back(results[order[i]]);
+    return sorted;
+}
+
+void EntityQuery::writeField(const Entity &entity, const std::string &pathText, JsonWriter &writer)
+{
+    const Path path = parsePath(pathText);
+    if (path.pseudo != PseudoField::None)
+    {
+        auto value = valueAt(entity, path, InvalidFieldId);
+        if (auto *text = std::get_if<std::string_view>(&*value))
+            writer.value(*text);
+        else
+            writer.null();
+        return;
+    }
+
+    const FieldId fieldId = entity.getSchema().getFieldId(path.field);
+    if (fieldId == InvalidFieldId)
+    {
+        writer.null();
+    }
+    else if (path.members.empty())
+    {
+        entity.writeFieldJson(fieldId, writer);
+    }
+    else if (const FieldValue *node = memberNode(entity, path, fieldId))
+    {
+        node->writeJson(writer);
+    }
+    else
+    {
+        writer.null();
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "EntityManager.h"
+
+class JsonWriter;
+
+// A constant to compare field values with; std::monostate stands for "no
+// value" (an empty field).
+using QueryValue = std::variant<std::monostate, std::int64_t, double, bool, std::string>;
+
+enum class QueryOp
+{
+    Eq,
+    Ne,
+    Lt,
+    Lte,
+    Gt,
+    Gte,
+    In
+};
+
+// Paths name a top-level field, a member of an object field with dots
+// ("address.city"), or one of _id, _parentid, _schema and _state.
+struct QueryPredicate
+{
+    std::string path;
+    QueryOp op = QueryOp::Eq;
+    std::vector<QueryValue> values; // one value, or the candidates of In
+};
+
+struct QueryOrder
+{
+    std::string path;
+    bool descending = false;
+};
+
+struct EntityQueryConfig
+{
+    std::string schema;              // only entities of this schema; empty for all
+    std::vector<QueryPredicate> where; // all must hold
+    std::string parentId;            // only direct children of this entity
+    std::string ancestorId;          // only descendants of this entity
+    std::vector<QueryOrder> orderBy; // ties, and queries without order, sort by id
+    std::size_t limit = 0;           // 0 for no limit
+    bool includeDeleted = false;
+};
+
+// Filters the entity store by schema, field predicates and position in the
+// hierarchy, then sorts and truncates the matches.
+//
+// Numbers compare across integer and float fields, strings (also enums and
+// references) lexicographically, booleans false < true. A value of another
+// type never matches eq and always matches ne, but a path the entity lacks
+// matches nothing. Ordering predicates never match empty fields, and empty
+// fields sort last. Parent and ancestor
+// constraints walk the children index, and schema filters read the schema
+// index instead of scanning the whole store; deleted entities are not in the
+// children index, so they never match parent or ancestor constraints.
+// Within a schema, eq on an indexed field reads one value of its index,
+// range predicates on a field with an ordered index read that range, and a
+// limited query ordered first by such a field walks the index in order and
+// stops once the limit is filled.
+class EntityQuery : public IEntityQuery
+{
+public:
+    explicit EntityQuery(EntityQueryConfig config);
+
+    // Builds a query from the JSON form used by the router's "query"
+    // command:
+    //   {"schema": "Animal",
+    //    "where": [{"field": "age", "op": "gte", "value": 3},
+    //              {"field": "kind", "op": "in", "value": ["cow", "sheep"]}],
+    //    "parent": "farm1" | "ancestor": "farm1",
+    //    "orderBy": ["name", {"field": "age", "descending": true}],
+    //    "limit": 10, "includeDeleted": false}
+    // Every key is optional; "op" defaults to "eq". Throws on malformed specs.
+    static EntityQuery fromJson(const nlohmann::json &spec);
+
+    // Throws if the query names a schema and a path that schema lacks.
+    std::vector<Entity *> execute(const EntityManager &manager) const override;
+
+    // Writes the value at `path` (see QueryPredicate), or null if the entity
+    // has no such field.
+    static void writeField(const Entity &entity, const std::string &path, JsonWriter &writer);
+
+private:
+    EntityQueryConfig config_;
+};
@@ -0,0 +1,329 @@
+#include <catch2/catch_test_macros.hpp>
+#include "SchemaManager.h"
+#include "EntityManager.h"
+#include "EntityQuery.h"
+#include "Entity.h"
+#include <nlohmann/json.hpp>
+#include <string>
+
+using json = nlohmann::json;
+
+namespace
+{
+  std::vector<std::string> ids(const std::vector<Entity *> &entities)
+  {
+    std::vector<std::string> out;
+    for (const Entity *entity : entities)
+      out.push_back(entity->getId());
+    return out;
+  }
+
+  std::vector<std::string> run(const EntityManager &manager, const char *spec)
+  {
+    return ids(manager.query(EntityQuery::fromJson(json::parse(spec))));
+  }
+}
+
+TEST_CASE("EntityQuery filters, orders and limits entities")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["farm.yaml"] = R"(
+entity_name: Farm
+children:
+  barns:
+    entity: Barn
+fields:
+  name:
+    type: string
+)";
+  schemas["barn.yaml"] = R"(
+entity_name: Barn
+children:
+  animals:
+    entity: Animal
+fields:
+  name:
+    type: string
+)";
+  schemas["animal.yaml"] = R"(
+entity_name: Animal
+fields:
+  name:
+    type: string
+  age:
+    type: integer
+    index: true
+  weight:
+    type: float
+    index: ordered
+  vaccinated:
+    type: boolean
+  kind:
+    type: enum
+    values: [cow, sheep, goat]
+    index: true
+  tag:
+    type: object
+    fields:
+      color:
+        type: string
+)";
+
+  std::unordered_map<std::string, std::string> data;
+  data["farm.yaml"] = R"(
+farm1:
+  _schema: Farm
+  name: Green Acres
+farm2:
+  _schema: Farm
+  name: Red Hill
+north:
+  _schema: Barn
+  _parentid: farm1
+  name: North barn
+south:
+  _schema: Barn
+  _parentid: farm2
+  name: South barn
+)";
+  data["animals.yaml"] = R"(
+daisy:
+  _schema: Animal
+  _parentid: north
+  name: Daisy
+  age: 4
+  weight: 512.5
+  vaccinated: true
+  kind: cow
+  tag:
+    color: red
+dolly:
+  _schema: Animal
+  _parentid: north
+  name: Dolly
+  age: 2
+  weight: 61.0
+  vaccinated: false
+  kind: sheep
+  tag:
+    color: blue
+gruff:
+  _schema: Animal
+  _parentid: south
+  name: Gruff
+  age: 7
+  kind: goat
+shaun:
+  _schema: Animal
+  _parentid: south
+  name: Shaun
+  age: 1
+  weight: 40.25
+  kind: sheep
+)";
+
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle(data);
+
+  // Without orderBy, results come sorted by id.
+  REQUIRE(run(mgr, R"({"schema":"Animal"})") == std::vector<std::string>{"daisy", "dolly", "gruff", "shaun"});
+  REQUIRE(run(mgr, R"({"schema":"Farm"})") == std::vector<std::string>{"farm1", "farm2"});
+
+  // Comparisons across integers and floats, booleans, enums and object members.
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"age","op":"gte","value":4}]})") == std::vector<std::string>{"daisy", "gruff"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"weight","op":"lt","value":100}]})") == std::vector<std::string>{"dolly", "shaun"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"age","op":"lt","value":2.5}]})") == std::vector<std::string>{"dolly", "shaun"});
+  REQUIRE(run(mgr, R"({"where":[{"field":"vaccinated","value":true}]})") == std::vector<std::string>{"daisy"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","op":"in","value":["cow","goat"]}]})") == std::vector<std::string>{"daisy", "gruff"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","op":"ne","value":"sheep"}]})") == std::vector<std::string>{"daisy", "gruff"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"tag.color","value":"blue"}]})") == std::vector<std::string>{"dolly"});
+
+  // eq on an indexed field reads its index, with the same comparison rules.
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","value":"sheep"}]})") == std::vector<std::string>{"dolly", "shaun"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"age","value":4.0},{"field":"kind","value":"cow"}]})") == std::vector<std::string>{"daisy"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"age","value":4.5}]})").empty());
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","value":"horse"}]})").empty());
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","value":1}]})").empty());
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"weight","value":null}]})") == std::vector<std::string>{"gruff"});
+  REQUIRE(run(mgr, R"({"where":[{"field":"_parentid","value":null}]})") == std::vector<std::string>{"farm1", "farm2"});
+
+  // Hierarchy constraints.
+  REQUIRE(run(mgr, R"({"parent":"north"})") == std::vector<std::string>{"daisy", "dolly"});
+  REQUIRE(run(mgr, R"({"ancestor":"farm2"})") == std::vector<std::string>{"gruff", "shaun", "south"});
+  REQUIRE(run(mgr, R"({"ancestor":"farm2","schema":"Animal","where":[{"field":"age","op":"gt","value":3}]})") == std::vector<std::string>{"gruff"});
+  REQUIRE(run(mgr, R"({"parent":"north","ancestor":"farm2"})").empty());
+
+  // Ordering: empty values last either way, ties by id, then the limit.
+  REQUIRE(run(mgr, R"({"schema":"Animal","orderBy":[{"field":"weight","descending":true}]})") == std::vector<std::string>{"daisy", "dolly", "shaun", "gruff"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","orderBy":["weight"],"limit":2})") == std::vector<std::string>{"shaun", "dolly"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","orderBy":["kind"]})") == std::vector<std::string>{"daisy", "gruff", "dolly", "shaun"});
+
+  // Deleted entities only with includeDeleted.
+  REQUIRE(mgr.removeEntity("dolly"));
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","value":"sheep"}]})") == std::vector<std::string>{"shaun"});
+  REQUIRE(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","value":"sheep"}],"includeDeleted":true})") == std::vector<std::string>{"dolly", "shaun"});
+
+  // Malformed queries.
+  REQUIRE_THROWS(run(mgr, R"({"schema":"Plant"})"));
+  REQUIRE_THROWS(run(mgr, R"({"schema":"Animal","where":[{"field":"colour","value":"red"}]})"));
+  REQUIRE_THROWS(run(mgr, R"({"schema":"Animal","where":[{"field":"age","op":"between","value":1}]})"));
+  REQUIRE_THROWS(run(mgr, R"({"schema":"Animal","where":[{"field":"kind","op":"in","value":"cow"}]})"));
+  REQUIRE_THROWS(run(mgr, R"({"where":[{"field":"tag","value":{"color":"red"}}]})"));
+  REQUIRE_THROWS(run(mgr, R"({"limit":-1})"));
+}
+
+TEST_CASE("EntityQuery compares float fields at their stored precision")
+{
+  // `price`, `hashPrice` and `orderedPrice` hold the same values, read by a
+  // scan, from a hash index and from an ordered index.
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["item.yaml"] = R"(
+entity_name: Item
+fields:
+  price:
+    type: float
+  hashPrice:
+    type: float
+    index: true
+  orderedPrice:
+    type: float
+    index: ordered
+  size:
+    type: object
+    fields:
+      width:
+        type: float
+)";
+  std::string items;
+  const std::vector<std::pair<std::string, std::string>> prices = {{"a", "0.1"}, {"b", "0.2"}, {"c", "0.3"}, {"d", "16777217"}};
+  for (const auto &[id, price] : prices)
+  {
+    items += id + ":\n  _schema: Item\n";
+    for (const char *field : {"price", "hashPrice", "orderedPrice"})
+      items += std::string("  ") + field + ": " + price + "\n";
+  }
+  items += "  size:\n    width: 0.2\n";
+
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"items.yaml", items}});
+
+  // The stored values are floats; the constants are the doubles nearest the
+  // same decimals, and still match them.
+  const std::vector<std::pair<std::string, std::vector<std::string>>> cases = {
+      {R"({"field":"$","value":0.1})", {"a"}},
+      {R"({"field":"$","op":"in","value":[0.3,0.1]})", {"a", "c"}},
+      {R"({"field":"$","op":"ne","value":0.1})", {"b", "c", "d"}},
+      {R"({"field":"$","op":"lte","value":0.1})", {"a"}},
+      {R"({"field":"$","op":"gt","value":0.1})", {"b", "c", "d"}},
+      {R"({"field":"$","op":"gte","value":0.3})", {"c", "d"}},
+      {R"({"field":"$","op":"lt","value":0.3})", {"a", "b"}},
+      {R"({"field":"$","value":16777217})", {"d"}},
+      {R"({"field":"$","op":"lt","value":1e300})", {"a", "b", "c", "d"}},
+      {R"({"field":"$","op":"gt","value":-1e300})", {"a", "b", "c", "d"}},
+  };
+  for (const char *field : {"price", "hashPrice", "orderedPrice"})
+  {
+    for (const auto &[predicate, expected] : cases)
+    {
+      json spec = {{"schema", "Item"}, {"where", json::array({json::parse(predicate)})}};
+      spec["where"][0]["field"] = field;
+      INFO(spec.dump());
+      REQUIRE(run(mgr, spec.dump().c_str()) == expected);
+    }
+  }
+  REQUIRE(run(mgr, R"({"schema":"Item","where":[{"field":"size.width","value":0.2}]})") == std::vector<std::string>{"d"});
+
+  mgr.clear();
+}
+
+TEST_CASE("EntityQuery reads ranges and top-k from ordered indexes")
+{
+  // `score` and `level` are indexed; `plainScore` and `plainLevel` hold the
+  // same values without an index, so each query is checked against a scan.
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["reading.yaml"] = R"(
+entity_name: Reading
+fields:
+  score:
+    type: integer
+    index: ordered
+  plainScore:
+    type: integer
+  level:
+    type: float
+    index: ordered
+  plainLevel:
+    type: float
+  group:
+    type: integer
+)";
+
+  std::string readings;
+  for (int i = 0; i < 60; ++i)
+  {
+    readings += "r" + std::to_string(i) + ":\n  _schema: Reading\n  group: " + std::to_string(i % 3) + "\n";
+    if (i % 7 != 0)
+    {
+      const std::string score = std::to_string((i * 37) % 23 - 5);
+      readings += "  score: " + score + "\n  plainScore: " + score + "\n";
+    }
+    if (i % 5 != 0)
+    {
+      const std::string level = std::to_string(((i * 13) % 17) * 0.5 - 3);
+      readings += "  level: " + level + "\n  plainLevel: " + level + "\n";
+    }
+  }
+
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  EntityManager &mgr = EntityManager::instance();
+  mgr.parseDataBundle({{"readings.yaml", readings}});
+  REQUIRE(mgr.removeEntity("r8"));
+
+  const std::vector<std::string> specs = {
+      R"({"where":[{"field":"$score","op":"gte","value":3}]})",
+      R"({"where":[{"field":"$score","op":"gt","value":3},{"field":"$score","op":"lte","value":10}]})",
+      R"({"where":[{"field":"$score","op":"gt","value":2.5},{"field":"$score","op":"lt","value":7.5}]})",
+      R"({"where":[{"field":"$score","op":"lt","value":-0.5}]})",
+      R"({"where":[{"field":"$score","op":"gte","value":1e30}]})",
+      R"({"where":[{"field":"$score","op":"lte","value":1e30},{"field":"group","value":1}]})",
+      R"({"where":[{"field":"$score","op":"gt","value":"high"}]})",
+      R"({"where":[{"field":"$score","op":"lt","value":4},{"field":"$score","op":"gt","value":4}]})",
+      R"({"where":[{"field":"$level","op":"gte","value":1}]})",
+      R"({"where":[{"field":"$level","op":"gt","value":-1},{"field":"$level","op":"lt","value":2.5}]})",
+      R"({"orderBy":["$score"],"limit":5})",
+      R"({"orderBy":[{"field":"$score","descending":true}],"limit":7})",
+      R"({"orderBy":["$score","group"],"limit":4})",
+      R"({"orderBy":["$level"],"limit":3,"where":[{"field":"group","value":2}]})",
+      R"({"orderBy":["$level"],"limit":50})",
+      R"({"orderBy":[{"field":"$level","descending":true}],"limit":3,"where":[{"field":"$level","op":"lt","value":2}]})",
+      R"({"orderBy":["$score"],"limit":6,"where":[{"field":"$level","op":"gte","value":0}]})",
+  };
+
+  auto withFields = [](std::string spec, const std::string &prefix)
+  {
+    for (const char *field : {"score", "level"})
+    {
+      const std::string placeholder = std::string("$") + field;
+      std::string name = prefix.empty() ? field : prefix + char(field[0] - 'a' + 'A') + (field + 1);
+      for (auto pos = spec.find(placeholder); pos != std::string::npos; pos = spec.find(placeholder))
+        spec.replace(pos, placeholder.size(), name);
+    }
+    json parsed = json::parse(spec);
+    parsed["schema"] = "Reading";
+    return parsed.dump();
+  };
+
+  for (const std::string &spec : specs)
+  {
+    INFO(spec);
+    const std::vector<std::string> indexed = run(mgr, withFields(spec, "").c_str());
+    REQUIRE(indexed == run(mgr, withFields(spec, "plain").c_str()));
+  }
+
+  REQUIRE(run(mgr, withFields(R"({"where":[{"field":"$score","op":"gte","value":1e30}]})", "").c_str()).empty());
+  REQUIRE(run(mgr, withFields(R"({"orderBy":["$level"],"limit":50})", "").c_str()).size() == 50);
+
+  mgr.clear();
+}
@@ -1,4 +1,5 @@
 #include "EntitySchema.h"
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
 EntitySchema::EntitySchema(std::string name)
@@ -11,7 +12,31 @@ const std::string &EntitySchema::getName() const
 
 void EntitySchema::addField(std::unique_ptr<FieldSchema> field)
 {
-    fields_[field->getName()] = std::move(field);
+    const std::string name = field->getName();
+    auto idIt = fieldIds_.find(name);
+    if (idIt != fieldIds_.end())
+    {
+        // Redefinition keeps the original slot so existing ids stay valid.
+        const FieldId id = idIt->second;
+        fieldSlots_[id] = field.get();
+        indexedFields_.erase(std::remove(indexedFields_.begin(), indexedFields_.end(), id), indexedFields_.end());
+        if (field->isIndexed())
+            indexedFields_.insert(std::lower_bound(indexedFields_.begin(), indexedFields_.end(), id), id);
+        referenceFields_.erase(std::remove(referenceFields_.begin(), referenceFields_.end(), id), referenceFields_.end());
+        if (field->holdsReferences())
+            referenceFields_.insert(std::lower_bound(referenceFields_.begin(), referenceFields_.end(), id), id);
+    }
+    else
+    {
+        const FieldId id = static_cast<FieldId>(fieldSlots_.size());
+        fieldIds_.emplace(name, id);
+        fieldSlots_.push_back(field.get());
+        if (field->isIndexed())
+            indexedFields_.push_back(id);
+        if (field->holdsReferences())
+            referenceFields_.push_back(id);
+    }
+    fields_[name] = std::move(field);
 }
 
 const FieldSchema *EntitySchema::getField(const std::string &fieldName) const
@@ -20,6 +45,17 @@ const FieldSchema *EntitySchema::getField(const std::string &fieldName) const
     return it != fields_.end() ? it->second.get() : nullptr;
 }
 
+const FieldSchema *EntitySchema::getField(FieldId fieldId) const
+{
+    return fieldId < fieldSlots_.size() ? fieldSlots_[fieldId] : nullptr;
+}
+
+FieldId EntitySchema::getFieldId(const std::string &fieldName) const
+{
+    auto it = fieldIds_.find(fieldName);
+    return it != fieldIds_.end() ? it->second : InvalidFieldId;
+}
+
 void EntitySchema::addChildSchema(const std::string &relationTag, EntitySchema *child)
 {
     if (!child)
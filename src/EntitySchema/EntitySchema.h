@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -7,6 +9,12 @@
 #include "FieldSchema.h"
 #include "Command.h"
 
+// Dense index of a top-level field, assigned in declaration order when the
+// field is added to its EntitySchema. Entities keep their values in a slot
+// array indexed by FieldId.
+using FieldId = std::uint32_t;
+inline constexpr FieldId InvalidFieldId = std::numeric_limits<FieldId>::max();
+
 class EntitySchema
 {
 public:
@@ -14,6 +22,14 @@ public:
     const std::string &getName() const;
     void addField(std::unique_ptr<FieldSchema> field);
     const FieldSchema *getField(const std::string &fieldName) const;
+    const FieldSchema *getField(FieldId fieldId) const;
+    FieldId getFieldId(const std::string &fieldName) const;
+    std::size_t getFieldCount() const { return fieldSlots_.size(); }
+    // Top-level fields declared with a secondary index, in FieldId order.
+    const std::vector<FieldId> &getIndexedFields() const { return indexedFields_; }
+    // Top-level fields that can hold references (FieldSchema::holdsReferences),
+    // in FieldId order.
+    const std::vector<FieldId> &getReferenceFields() const { return referenceFields_; }
     void addChildSchema(const std::string &relationTag, EntitySchema *child);
     std::vector<std::string> getChildrenTags() const;
     EntitySchema *getChildSchema(const std::string &relationTag) const;
@@ -27,6 +43,10 @@ public:
 private:
     std::string name_;
     std::unordered_map<std::string, std::unique_ptr<FieldSchema>> fields_;
+    std::unordered_map<std::string, FieldId> fieldIds_;
+    std::vector<const FieldSchema *> fieldSlots_;
+    std::vector<FieldId> indexedFields_;
+    std::vector<FieldId> referenceFields_;
     std::unordered_map<std::string, std::unique_ptr<Command>> commands_;
     std::unordered_map<std::string, EntitySchema *> children_;
 };
@@ -12,7 +12,9 @@ class ArrayFieldSchema : public FieldSchema
 public:
     explicit ArrayFieldSchema(ArrayFieldSchemaConfig &&config);
     std::string getTypeName() const override { return "array"; }
+    bool isPrimitive() const override { return false; }
     const FieldSchema &getElementSchema() const { return *elementSchema_; }
+    bool holdsReferences() const override { return elementSchema_->holdsReferences(); }
     std::string toJson() const override;
 
 private:
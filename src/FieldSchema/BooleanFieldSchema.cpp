@@ -31,6 +31,10 @@ std::string BooleanFieldSchema::toJson() const
     nlohmann::json j;
     j["type"] = getTypeName();
     j["required"] = isRequired();
+    if (isIndexed())
+        j["index"] = fieldIndexName(getIndexKind());
+    if (isUnique())
+        j["unique"] = true;
     if (alias_)
     {
         j["alias"] = *alias_;
@@ -35,6 +35,10 @@ std::string EnumFieldSchema::toJson() const
     nlohmann::json j;
     j["type"] = getTypeName();
     j["required"] = isRequired();
+    if (isIndexed())
+        j["index"] = fieldIndexName(getIndexKind());
+    if (isUnique())
+        j["unique"] = true;
     if (alias_)
     {
         j["alias"] = *alias_;
@@ -13,12 +13,38 @@ public:
     virtual void apply(const std::optional<std::string> &value) const = 0;
 };
 
+// Secondary index the entity store keeps on a top-level primitive field:
+// `index: true` (hash, for equality) or `index: ordered` (integer and float
+// fields, for ranges and sorting) in the schema YAML.
+enum class FieldIndexKind
+{
+    None,
+    Hash,
+    Ordered
+};
+
+inline const char *fieldIndexName(FieldIndexKind kind)
+{
+    switch (kind)
+    {
+    case FieldIndexKind::Hash:
+        return "hash";
+    case FieldIndexKind::Ordered:
+        return "ordered";
+    case FieldIndexKind::None:
+        break;
+    }
+    return "none";
+}
+
 // Base configuration struct for all fields
 struct FieldSchemaConfig
 {
     std::string name;
     bool required = false;
     std::optional<std::string> alias;
+    FieldIndexKind index = FieldIndexKind::None;
+    bool unique = false; // implies a hash index
 
     virtual ~FieldSchemaConfig() = default;
 };
@@ -31,6 +57,8 @@ public:
         : name_(config.name),
           required_(config.required),
           alias_(config.alias),
+          index_(config.unique && config.index == FieldIndexKind::None ? FieldIndexKind::Hash : config.index),
+          unique_(config.unique),
           config_(std::move(config))
     {
     }
@@ -46,7 +74,15 @@ public:
     const std::string &getName() const { return name_; }
     bool isRequired() const { return required_; }
     const std::optional<std::string> &getAlias() const { return alias_; }
+    FieldIndexKind getIndexKind() const { return index_; }
+    bool isIndexed() const { return index_ != FieldIndexKind::None; }
+    bool isUnique() const { return unique_; }
     virtual std::string getTypeName() const = 0;
+    // Primitive values are stored inline in entity slots; objects and arrays are nodes.
+    virtual bool isPrimitive() const { return true; }
+    // Whether values can hold entity references: a reference field, or an
+    // object or array with one inside.
+    virtual bool holdsReferences() const { return false; }
     const FieldSchemaConfig &getConfig() const { return config_; }
 
     // Add a rule to this field
@@ -69,6 +105,8 @@ protected:
     std::string name_;
     bool required_;
     std::optional<std::string> alias_;
+    FieldIndexKind index_;
+    bool unique_;
     FieldSchemaConfig config_;
     std::vector<std::unique_ptr<FieldRuleSchema>> rules_;
 };
@@ -63,6 +63,10 @@ std::string FloatFieldSchema::toJson() const
     if (maxValue_)
         j["max"] = *maxValue_;
     j["required"] = isRequired();
+    if (isIndexed())
+        j["index"] = fieldIndexName(getIndexKind());
+    if (isUnique())
+        j["unique"] = true;
     if (getAlias())
         j["alias"] = *getAlias();
     return j.dump();
@@ -70,6 +70,10 @@ std::string IntegerFieldSchema::toJson() const
     if (maxValue_)
         j["max"] = *maxValue_;
     j["required"] = isRequired();
+    if (isIndexed())
+        j["index"] = fieldIndexName(getIndexKind());
+    if (isUnique())
+        j["unique"] = true;
     if (getAlias())
         j["alias"] = *getAlias();
     return j.dump();
@@ -22,6 +22,16 @@ const FieldSchema *ObjectFieldSchema::getField(const std::string &name) const
     return nullptr;
 }
 
+bool ObjectFieldSchema::holdsReferences() const
+{
+    for (const auto &pair : fields_)
+    {
+        if (pair.second->holdsReferences())
+            return true;
+    }
+    return false;
+}
+
 std::vector<std::string> ObjectFieldSchema::getFieldNames() const
 {
     std::vector<std::string> names;
@@ -14,6 +14,8 @@ public:
     explicit ObjectFieldSchema(ObjectFieldSchemaConfig config);
 
     std::string getTypeName() const override { return "object"; }
+    bool isPrimitive() const override { return false; }
+    bool holdsReferences() const override;
 
     void addField(std::unique_ptr<FieldSchema> field);
 
@@ -13,6 +13,10 @@ std::string ReferenceFieldSchema::toJson() const
   j["type"] = "reference";
   j["target"] = targetEntityName_;
   j["required"] = isRequired();
+  if (isIndexed())
+    j["index"] = fieldIndexName(getIndexKind());
+  if (isUnique())
+    j["unique"] = true;
   if (getAlias())
     j["alias"] = *getAlias();
   return j.dump();
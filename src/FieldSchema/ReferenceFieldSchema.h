@@ -12,6 +12,7 @@ public:
     explicit ReferenceFieldSchema(ReferenceFieldSchemaConfig config);
     std::string getTypeName() const override { return "reference"; }
     const std::string &getTargetEntityName() const { return targetEntityName_; }
+    bool holdsReferences() const override { return true; }
     std::string toJson() const override;
 
 private:
@@ -11,6 +11,10 @@ std::string StringFieldSchema::toJson() const
     nlohmann::json j;
     j["type"] = "string";
     j["required"] = isRequired();
+    if (isIndexed())
+        j["index"] = fieldIndexName(getIndexKind());
+    if (isUnique())
+        j["unique"] = true;
     if (getAlias())
         j["alias"] = *getAlias();
     return j.dump();
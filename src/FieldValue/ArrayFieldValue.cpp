@@ -6,31 +6,52 @@
 using json = nlohmann::json;
 
 ArrayFieldValue::ArrayFieldValue(const ArrayFieldSchema &schema)
-    : FieldValue(schema) {}
+    : FieldValue(schema), elements_(FieldArena::current()) {}
 
 void ArrayFieldValue::setValueFromString(const std::string &val)
 {
-    elements_.clear();
-
+    json parsed;
     try
     {
-        json parsed = json::parse(val);
+        parsed = json::parse(val);
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error(std::string("Failed to set ArrayFieldValue from string: ") + e.what());
+    }
+    setValueFromJson(parsed);
+}
+
+void ArrayFieldValue::setValueFromJson(const json &value)
+{
+    // A vector keeps the allocator it was built with, so a loaded array
+    // rewritten after the load is rebuilt on the current resource rather
+    // than growing its arena.
+    if (elements_.get_allocator().resource() != FieldArena::current())
+    {
+        std::destroy_at(&elements_);
+        std::construct_at(&elements_, FieldArena::current());
+    }
+    else
+    {
+        elements_.clear();
+    }
 
-        if (!parsed.is_array())
+    try
+    {
+        if (!value.is_array())
         {
-            throw std::runtime_error("ArrayFieldValue expected a JSON array but got: " + val);
+            throw std::runtime_error("ArrayFieldValue expected a JSON array but got: " + value.dump());
         }
 
         const FieldSchema &elementSchema = getArraySchema().getElementSchema();
 
-        for (const auto &item : parsed)
+        for (const auto &item : value)
         {
-            std::string itemStr = item.dump();
-
             std::unique_ptr<FieldValue> elementValue =
                 FieldValueFactory::instance().create(elementSchema.getTypeName(), elementSchema);
 
-            elementValue->setValueFromString(itemStr);
+            elementValue->setValueFromJson(item);
 
             addElement(std::move(elementValue));
         }
@@ -39,7 +60,7 @@ void ArrayFieldValue::setValueFromString(const std::string &val)
     }
     catch (const std::exception &e)
     {
-        throw std::runtime_error(std::string("Failed to set ArrayFieldValue from string: ") + e.what());
+        throw std::runtime_error(std::string("Failed to set ArrayFieldValue from JSON: ") + e.what());
     }
 }
 
@@ -80,12 +101,10 @@ void ArrayFieldValue::addElement(std::unique_ptr<FieldValue> value)
     }
 }
 
-std::string ArrayFieldValue::toJson() const
+void ArrayFieldValue::writeJson(JsonWriter &writer) const
 {
-    nlohmann::json j = nlohmann::json::array();
+    writer.beginArray();
     for (const auto &element : elements_)
-    {
-        j.push_back(nlohmann::json::parse(element->toJson()));
-    }
-    return j.dump();
-}
\ No newline at end of file
+        element->writeJson(writer);
+    writer.endArray();
+}
@@ -2,6 +2,7 @@
 #include "FieldValue.h"
 #include "ArrayFieldSchema.h"
 #include <vector>
+#include <memory_resource>
 #include <memory>
 
 class ArrayFieldValue : public FieldValue
@@ -10,12 +11,13 @@ public:
     explicit ArrayFieldValue(const ArrayFieldSchema &schema);
 
     void setValueFromString(const std::string &val) override;
+    void setValueFromJson(const nlohmann::json &value) override;
     std::string toString() const override;
     void validate() const override;
     bool isEmpty() const override;
     void addElement(std::unique_ptr<FieldValue> value);
-    const std::vector<std::unique_ptr<FieldValue>> &getElements() const { return elements_; }
-    std::string toJson() const override;
+    const std::pmr::vector<std::unique_ptr<FieldValue>> &getElements() const { return elements_; }
+    void writeJson(JsonWriter &writer) const override;
 
 private:
     const ArrayFieldSchema &getArraySchema() const
@@ -23,5 +25,5 @@ private:
         return static_cast<const ArrayFieldSchema &>(schema_);
     }
 
-    std::vector<std::unique_ptr<FieldValue>> elements_;
+    std::pmr::vector<std::unique_ptr<FieldValue>> elements_;
 };
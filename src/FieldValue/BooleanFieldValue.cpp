@@ -1,10 +1,12 @@
 #include "BooleanFieldValue.h"
 #include <algorithm>
 #include <string>
-#include <nlohmann/json.hpp>
 
 BooleanFieldValue::BooleanFieldValue(const FieldSchema &schema)
-    : FieldValue(schema) {}
+    : PrimitiveFieldValue(schema) {}
+
+BooleanFieldValue::BooleanFieldValue(const FieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell) {}
 
 void BooleanFieldValue::setValueFromString(const std::string &val)
 {
@@ -13,11 +15,11 @@ void BooleanFieldValue::setValueFromString(const std::string &val)
 
     if (lowerVal == "true" || lowerVal == "1")
     {
-        value_ = true;
+        getCell().setBoolean(true);
     }
     else if (lowerVal == "false" || lowerVal == "0")
     {
-        value_ = false;
+        getCell().setBoolean(false);
     }
     else
     {
@@ -29,27 +31,17 @@ void BooleanFieldValue::setValueFromString(const std::string &val)
 
 std::string BooleanFieldValue::toString() const
 {
-    return value_ ? "true" : "false";
+    return !getCell().isEmpty() && getCell().getBoolean() ? "true" : "false";
 }
 void BooleanFieldValue::validate() const
 {
-    if (!value_)
+    if (getCell().isEmpty())
         return;
 
-    schema_.validate(std::optional<std::string>(value_ ? "true" : "false"));
+    schema_.validate(std::optional<std::string>(getCell().getBoolean() ? "true" : "false"));
 }
 
 bool BooleanFieldValue::isEmpty() const
 {
-    return !value_.has_value();
-}
-
-std::string BooleanFieldValue::toJson() const
-{
-    nlohmann::json j;
-    if (value_.has_value())
-        j = *value_;
-    else
-        j = nullptr;
-    return j.dump();
+    return getCell().isEmpty();
 }
@@ -1,43 +1,38 @@
 #include "EnumFieldValue.h"
-#include <nlohmann/json.hpp>
 
 EnumFieldValue::EnumFieldValue(const FieldSchema &schema)
-    : FieldValue(schema) {}
+    : PrimitiveFieldValue(schema) {}
+
+EnumFieldValue::EnumFieldValue(const FieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell) {}
 
 void EnumFieldValue::setValueFromString(const std::string &val)
 {
-    std::string processed = val;
-
-    if (processed.size() >= 2 && processed.front() == '"' && processed.back() == '"')
+    if (val.size() >= 2 && val.front() == '"' && val.back() == '"')
+    {
+        getCell().setString(std::string_view(val).substr(1, val.size() - 2));
+    }
+    else
     {
-        processed = processed.substr(1, processed.size() - 2);
+        getCell().setString(val);
     }
 
-    value_ = processed;
     validate();
 }
 
 std::string EnumFieldValue::toString() const
 {
-    return value_.value_or("");
+    return getCell().isEmpty() ? "" : std::string(getCell().getString());
 }
 
 void EnumFieldValue::validate() const
 {
-    return schema_.validate(value_);
+    if (getCell().isEmpty())
+        return schema_.validate(std::nullopt);
+    return schema_.validate(std::string(getCell().getString()));
 }
 
 bool EnumFieldValue::isEmpty() const
 {
-    return !value_.has_value();
+    return getCell().isEmpty();
 }
-
-std::string EnumFieldValue::toJson() const
-{
-    nlohmann::json j;
-    if (value_.has_value())
-        j = *value_;
-    else
-        j = nullptr;
-    return j.dump();
-}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "FieldArena.h"
+
+namespace
+{
+    constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+
+    thread_local std::pmr::memory_resource *currentResource = nullptr;
+}
+
+std::pmr::memory_resource *FieldArena::current()
+{
+    return currentResource ? currentResource : std::pmr::new_delete_resource();
+}
+
+void *FieldArena::allocate(std::size_t size)
+{
+    std::pmr::memory_resource *resource = current();
+    auto *block = static_cast<std::byte *>(resource->allocate(size + kHeaderSize, alignof(std::max_align_t)));
+    *reinterpret_cast<std::pmr::memory_resource **>(block) = resource;
+    return block + kHeaderSize;
+}
+
+void FieldArena::deallocate(void *ptr, std::size_t size) noexcept
+{
+    if (!ptr)
+        return;
+
+    auto *block = static_cast<std::byte *>(ptr) - kHeaderSize;
+    auto *resource = *reinterpret_cast<std::pmr::memory_resource **>(block);
+    resource->deallocate(block, size + kHeaderSize, alignof(std::max_align_t));
+}
+
+std::pmr::memory_resource *FieldArena::resourceOf(const void *ptr)
+{
+    const auto *block = static_cast<const std::byte *>(ptr) - kHeaderSize;
+    return *reinterpret_cast<std::pmr::memory_resource *const *>(block);
+}
+
+FieldArena::Scope::Scope(std::pmr::memory_resource *resource)
+    : previous_(currentResource)
+{
+    currentResource = resource;
+}
+
+FieldArena::Scope::~Scope()
+{
+    currentResource = previous_;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+// Allocation source for entities and their field trees. Bulk loaders install
+// a monotonic arena with FieldArena::Scope; everything constructed inside the
+// scope (Entity and FieldValue nodes, slot vectors, cell strings, object and
+// array containers) is carved from it and freed in one shot when the owner
+// drops the arena. Outside a scope allocations go to the global heap.
+class FieldArena
+{
+public:
+    static std::pmr::memory_resource *current();
+
+    // Class-level operator new/delete backends. Each block is prefixed with
+    // the resource it came from so objects can outlive the active scope.
+    static void *allocate(std::size_t size);
+    static void deallocate(void *ptr, std::size_t size) noexcept;
+    // The resource a block from allocate() came from.
+    static std::pmr::memory_resource *resourceOf(const void *ptr);
+
+    class Scope
+    {
+    public:
+        explicit Scope(std::pmr::memory_resource *resource);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        std::pmr::memory_resource *previous_;
+    };
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <variant>
+#include "FieldArena.h"
+
+// Inline storage for a primitive field value (integer, float, boolean, or the
+// string payload of string/enum/reference fields). Entities keep one cell per
+// primitive field directly in their slot array, so flat schemas need no
+// per-field heap node. String payloads are allocated from the arena that is
+// current when the string is stored, or borrowed from storage that outlives
+// the cell (a mapped snapshot) until the cell is next written. A loaded
+// string written after the load moves to the current resource, since the
+// arena it came from never frees what it gives up.
+class FieldCell
+{
+public:
+    enum class Kind : std::uint8_t
+    {
+        Empty,
+        Integer,
+        Float,
+        Boolean,
+        String
+    };
+
+    Kind getKind() const
+    {
+        return value_.index() == BorrowedIndex ? Kind::String : static_cast<Kind>(value_.index());
+    }
+    bool isEmpty() const { return value_.index() == 0; }
+    void clear() { value_ = std::monostate{}; }
+
+    void setInteger(std::int64_t value) { value_ = value; }
+    void setFloat(double value) { value_ = value; }
+    void setBoolean(bool value) { value_ = value; }
+    void setString(std::string_view value)
+    {
+        auto *text = std::get_if<std::pmr::string>(&value_);
+        if (text && text->get_allocator().resource() == FieldArena::current())
+        {
+            text->assign(value);
+        }
+        else
+        {
+            value_.emplace<std::pmr::string>(value, FieldArena::current());
+        }
+    }
+
+    // Points the cell at bytes it does not own; the caller keeps them alive.
+    void borrowString(std::string_view value) { value_.emplace<std::string_view>(value); }
+
+    std::int64_t getInteger() const { return std::get<std::int64_t>(value_); }
+    double getFloat() const { return std::get<double>(value_); }
+    bool getBoolean() const { return std::get<bool>(value_); }
+    std::string_view getString() const
+    {
+        if (auto *borrowed = std::get_if<std::string_view>(&value_))
+            return *borrowed;
+        return std::get<std::pmr::string>(value_);
+    }
+
+    bool operator==(const FieldCell &other) const
+    {
+        if (getKind() == Kind::String && other.getKind() == Kind::String)
+            return getString() == other.getString();
+        return value_ == other.value_;
+    }
+    bool operator!=(const FieldCell &other) const { return !(*this == other); }
+
+private:
+    static constexpr std::size_t BorrowedIndex = 5;
+
+    std::variant<std::monostate, std::int64_t, double, bool, std::pmr::string, std::string_view> value_;
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include <string>
 #include <optional>
+#include <nlohmann/json.hpp>
 #include "FieldSchema.h"
+#include "FieldArena.h"
+#include "JsonWriter.h"
 
 class FieldValue
 {
@@ -11,13 +14,34 @@ public:
     FieldValue(const FieldValue &) = delete;
     FieldValue &operator=(const FieldValue &) = delete;
 
+    static void *operator new(std::size_t size) { return FieldArena::allocate(size); }
+    static void operator delete(void *ptr, std::size_t size) { FieldArena::deallocate(ptr, size); }
+
     const FieldSchema &getSchema() const { return schema_; }
 
     virtual void setValueFromString(const std::string &val) = 0;
+    // Sets the value from an already parsed JSON value. Strings are passed
+    // through unquoted, other scalars as their JSON text; objects and arrays
+    // override this to assign their members without re-serializing them.
+    virtual void setValueFromJson(const nlohmann::json &value)
+    {
+        if (value.is_string())
+            setValueFromString(value.get_ref<const std::string &>());
+        else
+            setValueFromString(value.dump());
+    }
     virtual std::string toString() const = 0;
     virtual void validate() const = 0;
     virtual bool isEmpty() const = 0;
-    virtual std::string toJson() const = 0;
+    virtual void writeJson(JsonWriter &writer) const = 0;
+
+    std::string toJson() const
+    {
+        std::string out;
+        JsonWriter writer(out);
+        writeJson(writer);
+        return out;
+    }
 
 protected:
     const FieldSchema &schema_;
@@ -1,15 +1,18 @@
 #include "FloatFieldValue.h"
 #include <string>
-#include <nlohmann/json.hpp>
 
 FloatFieldValue::FloatFieldValue(const FieldSchema &schema)
-    : FieldValue(schema) {}
+    : PrimitiveFieldValue(schema) {}
+
+FloatFieldValue::FloatFieldValue(const FieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell) {}
 
 void FloatFieldValue::setValueFromString(const std::string &val)
 {
     try
     {
-        value_ = std::stof(val);
+        // Parsed at float precision, as before the value moved into a cell.
+        getCell().setFloat(std::stof(val));
     }
     catch (...)
     {
@@ -21,27 +24,17 @@ void FloatFieldValue::setValueFromString(const std::string &val)
 
 std::string FloatFieldValue::toString() const
 {
-    return value_ ? std::to_string(*value_) : "";
+    return getCell().isEmpty() ? "" : std::to_string(getCell().getFloat());
 }
 
 void FloatFieldValue::validate() const
 {
-    if (!value_)
+    if (getCell().isEmpty())
         return;
-    return schema_.validate(std::optional<std::string>(std::to_string(*value_)));
+    return schema_.validate(std::optional<std::string>(std::to_string(getCell().getFloat())));
 }
 
 bool FloatFieldValue::isEmpty() const
 {
-    return !value_.has_value();
-}
-
-std::string FloatFieldValue::toJson() const
-{
-    nlohmann::json j;
-    if (value_.has_value())
-        j = *value_;
-    else
-        j = nullptr;
-    return j.dump();
+    return getCell().isEmpty();
 }
@@ -1,18 +1,14 @@
 #pragma once
-#include "FieldValue.h"
-#include <optional>
+#include "PrimitiveFieldValue.h"
 
-class FloatFieldValue : public FieldValue
+class FloatFieldValue : public PrimitiveFieldValue
 {
 public:
     explicit FloatFieldValue(const FieldSchema &schema);
+    FloatFieldValue(const FieldSchema &schema, FieldCell &cell);
 
     void setValueFromString(const std::string &val) override;
     std::string toString() const override;
     void validate() const override;
     bool isEmpty() const override;
-    std::string toJson() const override;
-
-private:
-    std::optional<float> value_;
 };
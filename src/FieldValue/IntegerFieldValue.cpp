@@ -1,15 +1,17 @@
 #include "IntegerFieldValue.h"
 #include <string>
-#include <nlohmann/json.hpp>
 
 IntegerFieldValue::IntegerFieldValue(const FieldSchema &schema)
-    : FieldValue(schema) {}
+    : PrimitiveFieldValue(schema) {}
+
+IntegerFieldValue::IntegerFieldValue(const FieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell) {}
 
 void IntegerFieldValue::setValueFromString(const std::string &val)
 {
     try
     {
-        value_ = std::stoi(val);
+        getCell().setInteger(std::stoll(val));
     }
     catch (...)
     {
@@ -21,27 +23,17 @@ void IntegerFieldValue::setValueFromString(const std::string &val)
 
 std::string IntegerFieldValue::toString() const
 {
-    return value_ ? std::to_string(*value_) : "";
+    return getCell().isEmpty() ? "" : std::to_string(getCell().getInteger());
 }
 
 void IntegerFieldValue::validate() const
 {
-    if (!value_)
+    if (getCell().isEmpty())
         return;
-    return schema_.validate(std::optional<std::string>(std::to_string(*value_)));
+    return schema_.validate(std::optional<std::string>(std::to_string(getCell().getInteger())));
 }
 
 bool IntegerFieldValue::isEmpty() const
 {
-    return !value_.has_value();
-}
-
-std::string IntegerFieldValue::toJson() const
-{
-    nlohmann::json j;
-    if (value_.has_value())
-        j = *value_;
-    else
-        j = nullptr;
-    return j.dump();
+    return getCell().isEmpty();
 }
@@ -1,18 +1,14 @@
 #pragma once
-#include "FieldValue.h"
-#include <optional>
+#include "PrimitiveFieldValue.h"
 
-class IntegerFieldValue : public FieldValue
+class IntegerFieldValue : public PrimitiveFieldValue
 {
 public:
     explicit IntegerFieldValue(const FieldSchema &schema);
+    IntegerFieldValue(const FieldSchema &schema, FieldCell &cell);
 
     void setValueFromString(const std::string &val) override;
     std::string toString() const override;
     void validate() const override;
     bool isEmpty() const override;
-    std::string toJson() const override;
-
-private:
-    std::optional<int> value_;
 };
@@ -0,0 +1,158 @@
+#include "JsonWriter.h"
+#include <charconv>
+#include <cmath>
+
+void JsonWriter::beginObject() { open('{'); }
+void JsonWriter::endObject() { close('}'); }
+void JsonWriter::beginArray() { open('['); }
+void JsonWriter::endArray() { close(']'); }
+
+void JsonWriter::key(std::string_view name)
+{
+    beforeValue();
+    writeString(name);
+    out_ += indent_ >= 0 ? ": " : ":";
+    afterKey_ = true;
+}
+
+void JsonWriter::value(std::string_view text)
+{
+    beforeValue();
+    writeString(text);
+}
+
+void JsonWriter::value(std::int64_t number)
+{
+    beforeValue();
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    out_.append(buffer, result.ptr);
+}
+
+void JsonWriter::value(double number) { writeFloat(number); }
+void JsonWriter::value(float number) { writeFloat(number); }
+
+template <typename Float>
+void JsonWriter::writeFloat(Float number)
+{
+    if (!std::isfinite(number))
+    {
+        null();
+        return;
+    }
+
+    beforeValue();
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    std::string_view digits(buffer, static_cast<std::size_t>(result.ptr - buffer));
+    out_ += digits;
+    // Keep floats recognisable as floats, as nlohmann does ("2.0", not "2").
+    if (digits.find_first_of(".e") == std::string_view::npos)
+        out_ += ".0";
+}
+
+void JsonWriter::value(bool flag)
+{
+    beforeValue();
+    out_ += flag ? "true" : "false";
+}
+
+void JsonWriter::null()
+{
+    beforeValue();
+    out_ += "null";
+}
+
+void JsonWriter::raw(std::string_view json)
+{
+    beforeValue();
+    out_ += json;
+}
+
+void JsonWriter::beforeValue()
+{
+    if (afterKey_)
+    {
+        afterKey_ = false;
+        return;
+    }
+    if (hasMembers_.empty())
+        return;
+
+    if (hasMembers_.back())
+        out_ += ',';
+    hasMembers_.back() = true;
+    newline(hasMembers_.size());
+}
+
+void JsonWriter::open(char bracket)
+{
+    beforeValue();
+    out_ += bracket;
+    hasMembers_.push_back(false);
+}
+
+void JsonWriter::close(char bracket)
+{
+    const bool hadMembers = hasMembers_.back();
+    hasMembers_.pop_back();
+    if (hadMembers)
+        newline(hasMembers_.size());
+    out_ += bracket;
+}
+
+void JsonWriter::newline(std::size_t depth)
+{
+    if (indent_ < 0)
+        return;
+    out_ += '\n';
+    out_.append(depth * static_cast<std::size_t>(indent_), ' ');
+}
+
+void JsonWriter::writeString(std::string_view text)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out_ += '"';
+    std::size_t plain = 0; // start of the current run of unescaped bytes
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out_.append(text.data() + plain, i - plain);
+        plain = i + 1;
+        switch (c)
+        {
+        case '"':
+            out_ += "\\\"";
+            break;
+        case '\\':
+            out_ += "\\\\";
+            break;
+        case '\b':
+            out_ += "\\b";
+            break;
+        case '\f':
+            out_ += "\\f";
+            break;
+        case '\n':
+            out_ += "\\n";
+            break;
+        case '\r':
+            out_ += "\\r";
+            break;
+        case '\t':
+            out_ += "\\t";
+            break;
+        default:
+            out_ += "\\u00";
+            out_ += hex[c >> 4];
+            out_ += hex[c & 0xF];
+            break;
+        }
+    }
+    out_.append(text.data() + plain, text.size() - plain);
+    out_ += '"';
+}
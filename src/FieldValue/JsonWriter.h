@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Appends JSON to a string in a single forward pass. Callers emit keys and
+// values in order; the writer inserts separators and, with `indent` >= 0,
+// the same line breaks and indentation as nlohmann::json::dump(indent).
+// It does not check that keys are unique or that containers are balanced.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string &out, int indent = -1) : out_(out), indent_(indent) {}
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void key(std::string_view name);
+
+    void value(std::string_view text);
+    void value(const char *text) { value(std::string_view(text)); }
+    void value(const std::string &text) { value(std::string_view(text)); }
+    void value(std::int64_t number);
+    // Shortest text that reads back as the same double (or float); non-finite
+    // numbers are written as null.
+    void value(double number);
+    void value(float number);
+    void value(bool flag);
+    void null();
+
+    // Writes an already serialized JSON value as is.
+    void raw(std::string_view json);
+
+    std::string &str() { return out_; }
+
+private:
+    void beforeValue();
+    void open(char bracket);
+    void close(char bracket);
+    void newline(std::size_t depth);
+    void writeString(std::string_view text);
+    template <typename Float>
+    void writeFloat(Float number);
+
+    std::string &out_;
+    int indent_;
+    std::vector<bool> hasMembers_; // one entry per open container
+    bool afterKey_ = false;
+};
@@ -2,12 +2,14 @@
 #include "ObjectFieldSchema.h"
 #include "FieldValueFactory.h"
 #include "FieldSchema.h"
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 ObjectFieldValue::ObjectFieldValue(const FieldSchema &schema)
-    : FieldValue(schema)
+    : FieldValue(schema), fieldValues_(FieldArena::current())
 {
     const auto &objSchema = static_cast<const ObjectFieldSchema &>(schema);
     for (const auto &[fieldName, fieldSchemaPtr] : objSchema.getFields())
@@ -19,21 +21,32 @@ ObjectFieldValue::ObjectFieldValue(const FieldSchema &schema)
 
 void ObjectFieldValue::setValueFromString(const std::string &val)
 {
+    nlohmann::json parsed;
     try
     {
-        nlohmann::json parsed = nlohmann::json::parse(val);
+        parsed = nlohmann::json::parse(val);
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error(std::string("Failed to set ObjectFieldValue from string: ") + e.what());
+    }
+    setValueFromJson(parsed);
+}
 
-        if (!parsed.is_object())
+void ObjectFieldValue::setValueFromJson(const nlohmann::json &value)
+{
+    try
+    {
+        if (!value.is_object())
         {
-            throw std::runtime_error("ObjectFieldValue expected a JSON object but got: " + val);
+            throw std::runtime_error("ObjectFieldValue expected a JSON object but got: " + value.dump());
         }
 
         const auto &objSchema = static_cast<const ObjectFieldSchema &>(getSchema());
 
-        for (auto it = parsed.begin(); it != parsed.end(); ++it)
+        for (auto it = value.begin(); it != value.end(); ++it)
         {
             const std::string &fieldName = it.key();
-            const nlohmann::json &fieldJson = it.value();
 
             const FieldSchema *fieldSchema = objSchema.getField(fieldName);
             if (!fieldSchema)
@@ -44,7 +57,7 @@ void ObjectFieldValue::setValueFromString(const std::string &val)
             std::unique_ptr<FieldValue> fieldValue =
                 FieldValueFactory::instance().create(fieldSchema->getTypeName(), *fieldSchema);
 
-            fieldValue->setValueFromString(fieldJson.dump());
+            fieldValue->setValueFromJson(it.value());
 
             setFieldValue(fieldName, std::move(fieldValue));
         }
@@ -53,7 +66,7 @@ void ObjectFieldValue::setValueFromString(const std::string &val)
     }
     catch (const std::exception &e)
     {
-        throw std::runtime_error(std::string("Failed to set ObjectFieldValue from string: ") + e.what());
+        throw std::runtime_error(std::string("Failed to set ObjectFieldValue from JSON: ") + e.what());
     }
 }
 
@@ -135,12 +148,21 @@ bool ObjectFieldValue::isEmpty() const
     return true;
 }
 
-std::string ObjectFieldValue::toJson() const
+void ObjectFieldValue::writeJson(JsonWriter &writer) const
 {
-    nlohmann::json j = nlohmann::json::object();
-    for (const auto &[fieldName, fieldValue] : fieldValues_)
+    // Members in name order, so output does not depend on hash order.
+    std::vector<const std::pair<const std::string, std::unique_ptr<FieldValue>> *> members;
+    members.reserve(fieldValues_.size());
+    for (const auto &pair : fieldValues_)
+        members.push_back(&pair);
+    std::sort(members.begin(), members.end(), [](const auto *a, const auto *b)
+              { return a->first < b->first; });
+
+    writer.beginObject();
+    for (const auto *member : members)
     {
-        j[fieldName] = nlohmann::json::parse(fieldValue->toJson());
+        writer.key(member->first);
+        member->second->writeJson(writer);
     }
-    return j.dump();
+    writer.endObject();
 }
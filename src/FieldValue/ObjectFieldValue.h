@@ -2,6 +2,7 @@
 
 #include "FieldValue.h"
 #include <unordered_map>
+#include <memory_resource>
 #include <memory>
 #include <string>
 
@@ -11,6 +12,7 @@ public:
     explicit ObjectFieldValue(const FieldSchema &schema);
 
     void setValueFromString(const std::string &val) override;
+    void setValueFromJson(const nlohmann::json &value) override;
     std::string toString() const override;
     void validate() const override;
     bool isEmpty() const override;
@@ -18,8 +20,8 @@ public:
     void setFieldValue(const std::string &fieldName, std::unique_ptr<FieldValue> value);
     FieldValue *getFieldValue(const std::string &fieldName) const;
     bool hasFieldValue(const std::string &fieldName) const;
-    std::string toJson() const override;
+    void writeJson(JsonWriter &writer) const override;
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<FieldValue>> fieldValues_;
+    std::pmr::unordered_map<std::string, std::unique_ptr<FieldValue>> fieldValues_;
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include "FieldValue.h"
+#include "FieldCell.h"
+
+// Base for scalar field values. The value lives in a FieldCell that is either
+// owned (array elements, object members) or bound to a cell stored elsewhere,
+// typically an Entity slot, so the per-type parsing and validation can run
+// over inline storage without allocating a node per field.
+class PrimitiveFieldValue : public FieldValue
+{
+public:
+    FieldCell &getCell() { return *cell_; }
+    const FieldCell &getCell() const { return *cell_; }
+
+    void setValueFromJson(const nlohmann::json &value) override
+    {
+        if (!value.is_null())
+            return FieldValue::setValueFromJson(value);
+
+        cell_->clear();
+        validate();
+    }
+
+    void writeJson(JsonWriter &writer) const override
+    {
+        switch (cell_->getKind())
+        {
+        case FieldCell::Kind::Empty:
+            writer.null();
+            break;
+        case FieldCell::Kind::Integer:
+            writer.value(cell_->getInteger());
+            break;
+        case FieldCell::Kind::Float:
+            // Float fields hold 32-bit values; print them at that precision.
+            writer.value(static_cast<float>(cell_->getFloat()));
+            break;
+        case FieldCell::Kind::Boolean:
+            writer.value(cell_->getBoolean());
+            break;
+        case FieldCell::Kind::String:
+            writer.value(cell_->getString());
+            break;
+        }
+    }
+
+protected:
+    explicit PrimitiveFieldValue(const FieldSchema &schema)
+        : FieldValue(schema), cell_(&ownCell_) {}
+
+    PrimitiveFieldValue(const FieldSchema &schema, FieldCell &cell)
+        : FieldValue(schema), cell_(&cell) {}
+
+private:
+    FieldCell ownCell_;
+    FieldCell *cell_;
+};
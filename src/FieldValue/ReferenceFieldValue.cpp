@@ -1,84 +1,117 @@
 #include "ReferenceFieldValue.h"
 #include "EntityManager.h"
-#include <nlohmann/json.hpp>
 
 ReferenceFieldValue::ReferenceFieldValue(const ReferenceFieldSchema &schema)
-    : FieldValue(schema), schema_(schema)
+    : PrimitiveFieldValue(schema), schema_(schema)
 {
 }
 
-void ReferenceFieldValue::setValueFromString(const std::string &value)
+ReferenceFieldValue::ReferenceFieldValue(const ReferenceFieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell), schema_(schema)
 {
-    auto entity = EntityManager::instance().getEntityById(value);
+}
+
+namespace
+{
+    thread_local std::vector<PendingReference> *deferredReferences = nullptr;
+}
+
+ReferenceFieldValue::DeferredResolution::DeferredResolution(std::vector<PendingReference> &pending)
+    : previous_(deferredReferences)
+{
+    deferredReferences = &pending;
+}
+
+ReferenceFieldValue::DeferredResolution::~DeferredResolution()
+{
+    deferredReferences = previous_;
+}
+
+std::optional<std::string> ReferenceFieldValue::findTargetProblem(const ReferenceFieldSchema &schema, const std::string &id)
+{
+    auto entity = EntityManager::instance().getEntityById(id);
     if (!entity)
     {
-        throw std::runtime_error("Referenced entity with ID '" + value + "' does not exist");
+        return "Referenced entity with ID '" + id + "' does not exist";
     }
 
-    if (!schema_.getTargetEntityName().empty() &&
-        entity->getSchema().getName() != schema_.getTargetEntityName())
+    if (!schema.getTargetEntityName().empty() &&
+        entity->getSchema().getName() != schema.getTargetEntityName())
     {
-        throw std::runtime_error(
-            "Referenced entity type mismatch, expected '" + schema_.getTargetEntityName() + "'");
+        return "Referenced entity type mismatch, expected '" + schema.getTargetEntityName() + "'";
     }
+    return std::nullopt;
+}
 
-    referencedId_ = value;
+void ReferenceFieldValue::checkTarget(const ReferenceFieldSchema &schema, const std::string &id)
+{
+    if (auto problem = findTargetProblem(schema, id))
+    {
+        throw std::runtime_error(*problem);
+    }
+}
+
+std::optional<std::string> ReferenceFieldValue::resolve(const PendingReference &reference)
+{
+    if (reference.cell->isEmpty())
+    {
+        return std::nullopt;
+    }
+    return findTargetProblem(*reference.schema, std::string(reference.cell->getString()));
+}
+
+void ReferenceFieldValue::setValueFromString(const std::string &value)
+{
+    if (deferredReferences)
+    {
+        getCell().setString(value);
+        deferredReferences->push_back({&schema_, &getCell()});
+        return;
+    }
+
+    checkTarget(schema_, value);
+    getCell().setString(value);
 }
 
 void ReferenceFieldValue::validate() const
 {
-    if (schema_.isRequired() && !referencedId_.has_value())
+    if (schema_.isRequired() && getCell().isEmpty())
     {
         throw std::runtime_error("Reference is required but no ID set");
     }
 
-    if (referencedId_)
+    if (!getCell().isEmpty())
     {
-        auto entity = EntityManager::instance().getEntityById(*referencedId_);
-        if (!entity)
-        {
-            throw std::runtime_error("Referenced entity with ID '" + *referencedId_ + "' does not exist");
-        }
-
-        if (!schema_.getTargetEntityName().empty() &&
-            entity->getSchema().getName() != schema_.getTargetEntityName())
-        {
-            throw std::runtime_error(
-                "Referenced entity type mismatch, expected '" + schema_.getTargetEntityName() + "'");
-        }
+        checkTarget(schema_, std::string(getCell().getString()));
     }
 }
 
-const std::optional<std::string> &ReferenceFieldValue::getReferencedId() const
+std::optional<std::string> ReferenceFieldValue::getReferencedId() const
 {
-    return referencedId_;
+    if (getCell().isEmpty())
+        return std::nullopt;
+    return std::string(getCell().getString());
 }
 
 void ReferenceFieldValue::setReferencedId(const std::string &id)
 {
-    referencedId_ = id;
+    getCell().setString(id);
 }
 
 std::string ReferenceFieldValue::toString() const
 {
-    return referencedId_.value_or("");
+    return getCell().isEmpty() ? "" : std::string(getCell().getString());
 }
 
 bool ReferenceFieldValue::isEmpty() const
 {
-    return !referencedId_.has_value();
+    return getCell().isEmpty();
 }
 
-std::string ReferenceFieldValue::toJson() const
+void ReferenceFieldValue::writeJson(JsonWriter &writer) const
 {
-    nlohmann::json j;
-    if (referencedId_.has_value() && !referencedId_->empty())
-    {
-        j = *referencedId_;
-    }
+    if (getCell().isEmpty() || getCell().getString().empty())
+        writer.null();
     else
-    {
-        j = nullptr;
-    }
-    return j.dump();
+        writer.value(getCell().getString());
 }
@@ -1,26 +1,60 @@
 #pragma once
 
-#include "FieldValue.h"
+#include "PrimitiveFieldValue.h"
 #include "ReferenceFieldSchema.h"
 #include <string>
 #include <optional>
+#include <vector>
 
-class ReferenceFieldValue : public FieldValue
+class Entity;
+
+// A reference assigned during a bulk load whose target has not been checked
+// yet. `owner` is filled in by the loader and only used for error reporting.
+struct PendingReference
+{
+    const ReferenceFieldSchema *schema;
+    const FieldCell *cell;
+    const Entity *owner = nullptr;
+};
+
+class ReferenceFieldValue : public PrimitiveFieldValue
 {
 public:
     explicit ReferenceFieldValue(const ReferenceFieldSchema &schema);
+    ReferenceFieldValue(const ReferenceFieldSchema &schema, FieldCell &cell);
 
     void setValueFromString(const std::string &value) override;
     void validate() const override;
     bool isEmpty() const override;
 
-    const std::optional<std::string> &getReferencedId() const;
+    std::optional<std::string> getReferencedId() const;
     void setReferencedId(const std::string &id);
 
     std::string toString() const override;
-    std::string toJson() const override;
+    void writeJson(JsonWriter &writer) const override;
+
+    // While alive, assignments on this thread store the id without looking the
+    // target up and append it to `pending`, so files can be loaded in any order.
+    class DeferredResolution
+    {
+    public:
+        explicit DeferredResolution(std::vector<PendingReference> &pending);
+        ~DeferredResolution();
+        DeferredResolution(const DeferredResolution &) = delete;
+        DeferredResolution &operator=(const DeferredResolution &) = delete;
+
+    private:
+        std::vector<PendingReference> *previous_;
+    };
+
+    // Checks a deferred assignment against the loaded entities. Returns the
+    // problem instead of throwing so callers can report every failure at once.
+    // Safe to call concurrently as long as the store is not modified.
+    static std::optional<std::string> resolve(const PendingReference &reference);
 
 private:
+    static std::optional<std::string> findTargetProblem(const ReferenceFieldSchema &schema, const std::string &id);
+    static void checkTarget(const ReferenceFieldSchema &schema, const std::string &id);
+
     const ReferenceFieldSchema &schema_;
-    std::optional<std::string> referencedId_;
 };
@@ -1,47 +1,38 @@
 #include "StringFieldValue.h"
-#include <nlohmann/json.hpp>
 
 StringFieldValue::StringFieldValue(const FieldSchema &schema)
-    : FieldValue(schema) {}
+    : PrimitiveFieldValue(schema) {}
+
+StringFieldValue::StringFieldValue(const FieldSchema &schema, FieldCell &cell)
+    : PrimitiveFieldValue(schema, cell) {}
 
 void StringFieldValue::setValueFromString(const std::string &val)
 {
-    std::string processed = val;
-
-    if (processed.size() >= 2 && processed.front() == '"' && processed.back() == '"')
+    if (val.size() >= 2 && val.front() == '"' && val.back() == '"')
     {
-        processed = processed.substr(1, processed.size() - 2);
+        getCell().setString(std::string_view(val).substr(1, val.size() - 2));
+    }
+    else
+    {
+        getCell().setString(val);
     }
 
-    value_ = processed;
     validate();
 }
 
 std::string StringFieldValue::toString() const
 {
-    return value_.value_or("");
+    return getCell().isEmpty() ? "" : std::string(getCell().getString());
 }
 
 void StringFieldValue::validate() const
 {
-    return schema_.validate(value_);
+    if (getCell().isEmpty())
+        return schema_.validate(std::nullopt);
+    return schema_.validate(std::string(getCell().getString()));
 }
 
 bool StringFieldValue::isEmpty() const
 {
-    return !value_.has_value() || value_->empty();
-}
-
-std::string StringFieldValue::toJson() const
-{
-    nlohmann::json j;
-    if (value_.has_value())
-    {
-        j = value_.value();
-    }
-    else
-    {
-        j = nullptr;
-    }
-    return j.dump();
+    return getCell().isEmpty() || getCell().getString().empty();
 }
@@ -24,6 +24,22 @@ void FieldValueFactory::registerType(const std::string &typeName, CreatorFunc cr
     creators_[typeName] = std::move(creator);
 }
 
+void FieldValueFactory::registerBinder(const std::string &typeName, BinderFunc binder)
+{
+    binders_[typeName] = std::move(binder);
+}
+
+std::unique_ptr<FieldValue> FieldValueFactory::bind(const FieldSchema &schema, FieldCell &cell) const
+{
+    const std::string typeName = schema.getTypeName();
+    auto it = binders_.find(typeName);
+    if (it == binders_.end())
+    {
+        throw std::runtime_error("Field value type cannot be stored inline: " + typeName);
+    }
+    return it->second(schema, cell);
+}
+
 std::unique_ptr<FieldValue> FieldValueFactory::create(const std::string &typeName, const FieldSchema &schema) const
 {
     auto it = creators_.find(typeName);
@@ -5,7 +5,10 @@
 #include <unordered_map>
 #include <functional>
 #include <stdexcept>
+#include <type_traits>
 #include "FieldValue.h"
+#include "FieldCell.h"
+#include "PrimitiveFieldValue.h"
 #include "FieldSchema.h"
 #include "StringFieldValue.h"
 #include "IntegerFieldValue.h"
@@ -20,13 +23,62 @@ class FieldValueFactory
 {
 public:
     using CreatorFunc = std::function<std::unique_ptr<FieldValue>(const FieldSchema &)>;
+    using BinderFunc = std::function<std::unique_ptr<FieldValue>(const FieldSchema &, FieldCell &)>;
 
     static FieldValueFactory &instance();
 
     void registerType(const std::string &typeName, CreatorFunc creator);
+    void registerBinder(const std::string &typeName, BinderFunc binder);
 
     std::unique_ptr<FieldValue> create(const std::string &typeName, const FieldSchema &schema) const;
 
+    // Heap handle over a cell owned elsewhere (e.g. an Entity slot).
+    std::unique_ptr<FieldValue> bind(const FieldSchema &schema, FieldCell &cell) const;
+    bool canBind(const std::string &typeName) const { return binders_.count(typeName) != 0; }
+
+    // Runs `fn` with a temporary FieldValue bound to `cell`, constructed on the
+    // stack for the built-in primitive types so no node is allocated.
+    template <typename Fn>
+    static void withBoundValue(const FieldSchema &schema, FieldCell &cell, Fn &&fn)
+    {
+        const std::string type = schema.getTypeName();
+        if (type == "string")
+        {
+            StringFieldValue value(schema, cell);
+            fn(value);
+        }
+        else if (type == "integer")
+        {
+            IntegerFieldValue value(schema, cell);
+            fn(value);
+        }
+        else if (type == "float")
+        {
+            FloatFieldValue value(schema, cell);
+            fn(value);
+        }
+        else if (type == "boolean")
+        {
+            BooleanFieldValue value(schema, cell);
+            fn(value);
+        }
+        else if (type == "enum")
+        {
+            EnumFieldValue value(schema, cell);
+            fn(value);
+        }
+        else if (type == "reference")
+        {
+            ReferenceFieldValue value(static_cast<const ReferenceFieldSchema &>(schema), cell);
+            fn(value);
+        }
+        else
+        {
+            auto value = instance().bind(schema, cell);
+            fn(*value);
+        }
+    }
+
     template <typename FieldValueType, typename FieldSchemaType>
     void registerFieldValueType(const std::string &typeName)
     {
@@ -39,10 +91,23 @@ public:
                 throw std::runtime_error("Invalid schema type for " + typeName);
             }
             return std::make_unique<FieldValueType>(*derivedSchema); });
+
+        if constexpr (std::is_base_of_v<PrimitiveFieldValue, FieldValueType>)
+        {
+            registerBinder(typeName, [typeName](const FieldSchema &schema, FieldCell &cell)
+                           {
+                auto derivedSchema = dynamic_cast<const FieldSchemaType*>(&schema);
+                if (!derivedSchema)
+                {
+                    throw std::runtime_error("Invalid schema type for " + typeName);
+                }
+                return std::make_unique<FieldValueType>(*derivedSchema, cell); });
+        }
     }
 
 private:
     std::unordered_map<std::string, CreatorFunc> creators_;
+    std::unordered_map<std::string, BinderFunc> binders_;
 
     FieldValueFactory();
     FieldValueFactory(const FieldValueFactory &) = delete;
@@ -5,22 +5,44 @@
 #include <stdexcept>
 #include <unordered_set>
 #include <optional>
+#include <algorithm>
+#include "ThreadPool.h"
 // TO DO! Create a command factory
 #include "LuaCommand.h"
 #include "LuaManager.h"
 
-static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNode);
+static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNode, const std::string &name);
 static std::unique_ptr<FieldSchema> buildPrimitiveField(const std::string &type, const YAML::Node &fieldNode, const std::string &name);
 static std::unique_ptr<FieldSchema> buildObjectField(const YAML::Node &fieldNode, const std::string &name);
 static std::unique_ptr<FieldSchema> buildArrayField(const YAML::Node &fieldNode, const std::string &name);
 static void parseCommands(EntitySchema *entity, const YAML::Node &commandsNode);
 
+namespace
+{
+    thread_local SchemaManager *activeSchemas = nullptr;
+}
+
 SchemaManager &SchemaManager::instance()
+{
+    return activeSchemas ? *activeSchemas : defaultInstance();
+}
+
+SchemaManager &SchemaManager::defaultInstance()
 {
     static SchemaManager instance;
     return instance;
 }
 
+SchemaManager::Scope::Scope(SchemaManager &manager) : previous_(activeSchemas)
+{
+    activeSchemas = &manager;
+}
+
+SchemaManager::Scope::~Scope()
+{
+    activeSchemas = previous_;
+}
+
 SchemaManager::SchemaManager() = default;
 SchemaManager::~SchemaManager() = default;
 
@@ -70,6 +92,30 @@ EntitySchema *SchemaManager::getEntitySchema(const std::string &entityName) cons
     return it->second;
 }
 
+// `index: true` (or `hash`) asks for a hash index and `index: ordered` for an
+// ordered one; `unique: true` implies a hash index unless one is given.
+static FieldIndexKind parseIndexKind(const YAML::Node &indexNode, const std::string &name)
+{
+    if (!indexNode)
+        return FieldIndexKind::None;
+
+    bool flag = false;
+    if (YAML::convert<bool>::decode(indexNode, flag))
+        return flag ? FieldIndexKind::Hash : FieldIndexKind::None;
+    if (indexNode.IsScalar() && indexNode.Scalar() == "hash")
+        return FieldIndexKind::Hash;
+    if (indexNode.IsScalar() && indexNode.Scalar() == "ordered")
+        return FieldIndexKind::Ordered;
+    throw std::runtime_error("Invalid 'index' for field '" + name + "': expected true, false, hash or ordered");
+}
+
+// Indexes cover top-level fields only; `where` names the enclosing field.
+static void requireUnindexed(const FieldSchema &field, const std::string &where)
+{
+    if (field.isIndexed())
+        throw std::runtime_error("Field '" + field.getName() + "' in '" + where + "' cannot be indexed: only top-level fields can");
+}
+
 template <typename ConfigType>
 ConfigType buildConfig(const YAML::Node &fieldNode, const std::string &name)
 {
@@ -79,6 +125,8 @@ ConfigType buildConfig(const YAML::Node &fieldNode, const std::string &name)
     config.alias = fieldNode["alias"]
                        ? std::make_optional(fieldNode["alias"].as<std::string>())
                        : std::make_optional(name);
+    config.index = parseIndexKind(fieldNode["index"], name);
+    config.unique = fieldNode["unique"] ? fieldNode["unique"].as<bool>() : false;
 
     return std::move(config);
 }
@@ -188,15 +236,11 @@ static std::unique_ptr<FieldSchema> buildObjectField(const YAML::Node &fieldNode
 
     for (auto it = fieldNode["fields"].begin(); it != fieldNode["fields"].end(); ++it)
     {
-        std::string childName = it->first.as<std::string>();
         YAML::Node childNode = it->second;
+        std::string childName = childNode["name"] ? childNode["name"].as<std::string>() : it->first.as<std::string>();
 
-        if (!childNode["name"])
-        {
-            childNode["name"] = childName;
-        }
-
-        auto childSchema = buildFieldFromNode(childNode);
+        auto childSchema = buildFieldFromNode(childNode, childName);
+        requireUnindexed(*childSchema, name);
         objSchema->addField(std::move(childSchema));
     }
 
@@ -229,12 +273,15 @@ static std::unique_ptr<FieldSchema> buildArrayField(const YAML::Node &fieldNode,
         elementSchema = buildPrimitiveField(elemType, elemNode, name + "_elem");
     }
 
+    requireUnindexed(*elementSchema, name);
     config.elementSchema = std::move(elementSchema);
 
     return FieldSchemaFactory::instance().create("array", std::move(config));
 }
 
-static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNode)
+// The name is passed in rather than written back into the node, so compiling
+// never mutates the parsed documents and schemas can be built concurrently.
+static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNode, const std::string &name)
 {
     if (!fieldNode["type"])
     {
@@ -242,7 +289,6 @@ static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNo
     }
 
     std::string type = fieldNode["type"].as<std::string>();
-    std::string name = fieldNode["name"] ? fieldNode["name"].as<std::string>() : "";
 
     if (type == "object")
     {
@@ -256,147 +302,188 @@ static std::unique_ptr<FieldSchema> buildFieldFromNode(const YAML::Node &fieldNo
     return buildPrimitiveField(type, fieldNode, name);
 }
 
-void SchemaManager::parseSchemaBundle(const std::unordered_map<std::string, std::string> &schemaContent)
+namespace
 {
-    clear();
-    for (const auto &pair : schemaContent)
+    struct ParsedSchemaFile
     {
-        const std::string &fileName = pair.first;
-        const std::string &yamlContent = pair.second;
-
-        YAML::Node node = YAML::Load(yamlContent);
+        YAML::Node node;
+        std::string name;
+        bool isProfile = false;
+    };
+}
 
-        if (!node.IsMap())
-        {
-            throw std::runtime_error("Invalid schema format for file: " + fileName);
-        }
+// Parses and checks the top-level layout of one schema file. Runs on a pool
+// thread and touches no shared state.
+static void parseSchemaFile(const std::string &fileName, const std::string &yamlContent, ParsedSchemaFile &out)
+{
+    YAML::Node node = YAML::Load(yamlContent);
 
-        static const std::unordered_set<std::string> validKeys = {
-            "profile_name", "entity_name", "fields", "children", "commands"};
+    if (!node.IsMap())
+    {
+        throw std::runtime_error("Invalid schema format for file: " + fileName);
+    }
 
-        for (const auto &kv : node)
-        {
-            std::string key = kv.first.as<std::string>();
-            if (validKeys.find(key) == validKeys.end())
-            {
-                throw std::runtime_error(
-                    "Invalid key '" + key + "' in schema file '" + fileName + "'");
-            }
-        }
+    static const std::unordered_set<std::string> validKeys = {
+        "profile_name", "entity_name", "fields", "children", "commands"};
 
-        if (node["fields"] && !node["fields"].IsMap())
+    for (const auto &kv : node)
+    {
+        std::string key = kv.first.as<std::string>();
+        if (validKeys.find(key) == validKeys.end())
         {
             throw std::runtime_error(
-                "In file '" + fileName + "', 'fields' must be a YAML map.");
+                "Invalid key '" + key + "' in schema file '" + fileName + "'");
         }
+    }
 
-        if (node["children"] && !node["children"].IsMap())
-        {
-            throw std::runtime_error(
-                "In file '" + fileName + "', 'children' must be a YAML map.");
-        }
+    if (node["fields"] && !node["fields"].IsMap())
+    {
+        throw std::runtime_error(
+            "In file '" + fileName + "', 'fields' must be a YAML map.");
+    }
 
-        if (node["commands"] && !node["commands"].IsMap())
-        {
-            throw std::runtime_error(
-                "In file '" + fileName + "', 'commands' must be a YAML map.");
-        }
+    if (node["children"] && !node["children"].IsMap())
+    {
+        throw std::runtime_error(
+            "In file '" + fileName + "', 'children' must be a YAML map.");
+    }
 
-        std::string name;
-        bool isProfile = false;
-        if (node["profile_name"])
-        {
-            name = node["profile_name"].as<std::string>();
-            isProfile = true;
-        }
-        else if (node["entity_name"])
-        {
-            name = node["entity_name"].as<std::string>();
-        }
-        else
-        {
-            throw std::runtime_error("File '" + fileName + "' must define either profile_name or entity_name.");
-        }
+    if (node["commands"] && !node["commands"].IsMap())
+    {
+        throw std::runtime_error(
+            "In file '" + fileName + "', 'commands' must be a YAML map.");
+    }
 
-        if (entityLookup_.find(name) != entityLookup_.end())
-        {
-            throw std::runtime_error("Duplicate entity/profile name detected: " + name);
-        }
+    if (node["profile_name"])
+    {
+        out.name = node["profile_name"].as<std::string>();
+        out.isProfile = true;
+    }
+    else if (node["entity_name"])
+    {
+        out.name = node["entity_name"].as<std::string>();
+    }
+    else
+    {
+        throw std::runtime_error("File '" + fileName + "' must define either profile_name or entity_name.");
+    }
 
-        auto entity = std::make_unique<EntitySchema>(name);
-        EntitySchema *entityPtr = entity.get();
+    out.node = std::move(node);
+}
 
-        entities_.push_back(std::move(entity));
-        entityLookup_[name] = entityPtr;
+void SchemaManager::compileSchema(EntitySchema *entity, const YAML::Node &node) const
+{
+    const std::string &name = entity->getName();
 
-        if (isProfile)
+    if (node["fields"])
+    {
+        for (auto it = node["fields"].begin(); it != node["fields"].end(); ++it)
         {
-            profiles_[name] = entityPtr;
+            std::string fieldName = it->first.as<std::string>();
+            YAML::Node fieldNode = it->second;
+
+            if (!fieldNode["type"])
+                throw std::runtime_error("Field '" + fieldName + "' must define a 'type'.");
+
+            auto schema = buildFieldFromNode(fieldNode, fieldName);
+            if (schema->isIndexed() && !schema->isPrimitive())
+            {
+                throw std::runtime_error(
+                    "Field '" + fieldName + "' in schema '" + name +
+                    "' cannot be indexed: only primitive fields can");
+            }
+            if (schema->getIndexKind() == FieldIndexKind::Ordered &&
+                schema->getTypeName() != "integer" && schema->getTypeName() != "float")
+            {
+                throw std::runtime_error(
+                    "Field '" + fieldName + "' in schema '" + name +
+                    "' cannot have an ordered index: only integer and float fields can");
+            }
+            entity->addField(std::move(schema));
         }
     }
 
-    for (const auto &pair : schemaContent)
+    if (node["children"])
     {
-        const std::string &yamlContent = pair.second;
-        YAML::Node node = YAML::Load(yamlContent);
+        for (auto it = node["children"].begin(); it != node["children"].end(); ++it)
+        {
+            std::string relationTag = it->first.as<std::string>();
+            YAML::Node childNode = it->second;
 
-        std::string name = node["profile_name"]
-                               ? node["profile_name"].as<std::string>()
-                               : node["entity_name"].as<std::string>();
+            if (!childNode["entity"])
+            {
+                throw std::runtime_error(
+                    "Child relation '" + relationTag +
+                    "' in schema '" + name + "' must specify 'entity'.");
+            }
 
-        EntitySchema *entity = entityLookup_[name];
+            std::string childEntityName = childNode["entity"].as<std::string>();
 
-        if (node["fields"])
-        {
-            for (auto it = node["fields"].begin(); it != node["fields"].end(); ++it)
+            auto childIt = entityLookup_.find(childEntityName);
+            if (childIt == entityLookup_.end())
             {
-                std::string fieldName = it->first.as<std::string>();
-                YAML::Node fieldNode = it->second;
+                throw std::runtime_error(
+                    "Child entity '" + childEntityName +
+                    "' referenced by relation '" + relationTag +
+                    "' in schema '" + name + "' does not exist.");
+            }
 
-                if (!fieldNode["type"])
-                    throw std::runtime_error("Field '" + fieldName + "' must define a 'type'.");
+            entity->addChildSchema(relationTag, childIt->second);
+        }
+    }
 
-                fieldNode["name"] = fieldName;
+    if (node["commands"])
+    {
+        parseCommands(entity, node["commands"]);
+    }
+}
 
-                auto schema = buildFieldFromNode(fieldNode);
-                entity->addField(std::move(schema));
-            }
-        }
+void SchemaManager::parseSchemaBundle(const std::unordered_map<std::string, std::string> &schemaContent)
+{
+    clear();
 
-        if (node["children"])
+    // Files are handled in name order so that errors (e.g. which of two
+    // duplicates is reported) do not depend on map iteration or scheduling.
+    std::vector<const std::pair<const std::string, std::string> *> files;
+    files.reserve(schemaContent.size());
+    for (const auto &pair : schemaContent)
+        files.push_back(&pair);
+    std::sort(files.begin(), files.end(), [](const auto *a, const auto *b)
+              { return a->first < b->first; });
+
+    // Pass 1: parse every file once, in parallel, and keep the documents.
+    std::vector<ParsedSchemaFile> parsed(files.size());
+    ThreadPool::instance().parallelFor(files.size(), [&](std::size_t i)
+                                       { parseSchemaFile(files[i]->first, files[i]->second, parsed[i]); });
+
+    // Register every name before compiling, so children can refer to
+    // schemas defined in any file.
+    std::vector<EntitySchema *> compiled;
+    compiled.reserve(parsed.size());
+    for (const auto &file : parsed)
+    {
+        if (entityLookup_.find(file.name) != entityLookup_.end())
         {
-            for (auto it = node["children"].begin(); it != node["children"].end(); ++it)
-            {
-                std::string relationTag = it->first.as<std::string>();
-                YAML::Node childNode = it->second;
-
-                if (!childNode["entity"])
-                {
-                    throw std::runtime_error(
-                        "Child relation '" + relationTag +
-                        "' in schema '" + name + "' must specify 'entity'.");
-                }
-
-                std::string childEntityName = childNode["entity"].as<std::string>();
-
-                auto childIt = entityLookup_.find(childEntityName);
-                if (childIt == entityLookup_.end())
-                {
-                    throw std::runtime_error(
-                        "Child entity '" + childEntityName +
-                        "' referenced by relation '" + relationTag +
-                        "' in schema '" + name + "' does not exist.");
-                }
-
-                entity->addChildSchema(relationTag, childIt->second);
-            }
+            throw std::runtime_error("Duplicate entity/profile name detected: " + file.name);
         }
 
-        if (node["commands"])
+        auto entity = std::make_unique<EntitySchema>(file.name);
+        EntitySchema *entityPtr = entity.get();
+
+        entities_.push_back(std::move(entity));
+        entityLookup_[file.name] = entityPtr;
+        compiled.push_back(entityPtr);
+
+        if (file.isProfile)
         {
-            parseCommands(entity, node["commands"]);
+            profiles_[file.name] = entityPtr;
         }
     }
+
+    // Pass 2: the name table is frozen, so each schema only writes to itself
+    // and can be compiled from its retained document concurrently.
+    ThreadPool::instance().parallelFor(parsed.size(), [&](std::size_t i)
+                                       { compileSchema(compiled[i], parsed[i].node); });
 }
 
 void SchemaManager::setBasePath(const std::filesystem::path &basePath)
@@ -6,11 +6,35 @@
 #include <filesystem>
 
 class EntitySchema;
+namespace YAML
+{
+    class Node;
+}
 
 class SchemaManager
 {
 public:
+    SchemaManager();
+    ~SchemaManager();
+
+    // The schemas active on this thread (see Scope), else defaultInstance().
     static SchemaManager &instance();
+    // The process-wide schemas used by ToorCraftEngine::instance().
+    static SchemaManager &defaultInstance();
+
+    // Makes `manager` what instance() returns on this thread while alive.
+    class Scope
+    {
+    public:
+        explicit Scope(SchemaManager &manager);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        SchemaManager *previous_;
+    };
+
     void setBasePath(const std::filesystem::path &basePath);
     void parseSchemaBundle(const std::unordered_map<std::string, std::string> &schemaContent);
     EntitySchema *getProfileSchema(const std::string &profileName) const;
@@ -22,10 +46,9 @@ public:
     const std::vector<std::unique_ptr<EntitySchema>> &getAllEntities() const { return entities_; }
 
 private:
-    SchemaManager();
-    ~SchemaManager();
     SchemaManager(const SchemaManager &) = delete;
     SchemaManager &operator=(const SchemaManager &) = delete;
+    void compileSchema(EntitySchema *entity, const YAML::Node &node) const;
     std::vector<std::unique_ptr<EntitySchema>> entities_;
     std::unordered_map<std::string, EntitySchema *> profiles_;
     std::unordered_map<std::string, EntitySchema *> entityLookup_;
@@ -430,3 +430,90 @@ commands:
     REQUIRE_THROWS_AS(mgr.parseSchemaBundle(badSchemas), std::runtime_error);
   }
 }
+
+TEST_CASE("SchemaManager parses field indexes")
+{
+  SchemaManager &mgr = SchemaManager::instance();
+
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["device.yaml"] = R"(
+entity_name: Device
+fields:
+  serial:
+    type: string
+    unique: true
+  model:
+    type: enum
+    values: [a, b]
+    index: true
+  firmware:
+    type: integer
+    index: false
+  watts:
+    type: float
+    index: ordered
+  location:
+    type: object
+    fields:
+      room:
+        type: string
+)";
+  mgr.parseSchemaBundle(schemas);
+
+  const EntitySchema *device = mgr.getEntitySchema("Device");
+  REQUIRE(device->getIndexedFields() ==
+          std::vector<FieldId>{device->getFieldId("serial"), device->getFieldId("model"), device->getFieldId("watts")});
+  REQUIRE(device->getField("serial")->isUnique());
+  REQUIRE(device->getField("serial")->getIndexKind() == FieldIndexKind::Hash);
+  REQUIRE_FALSE(device->getField("model")->isUnique());
+  REQUIRE_FALSE(device->getField("firmware")->isIndexed());
+  REQUIRE(device->getField("serial")->toJson().find("\"unique\":true") != std::string::npos);
+  REQUIRE(device->getField("watts")->getIndexKind() == FieldIndexKind::Ordered);
+  REQUIRE(device->getField("watts")->toJson().find("\"index\":\"ordered\"") != std::string::npos);
+
+  std::unordered_map<std::string, std::string> objectIndex;
+  objectIndex["device.yaml"] = R"(
+entity_name: Device
+fields:
+  location:
+    type: object
+    index: true
+    fields:
+      room:
+        type: string
+)";
+  REQUIRE_THROWS_AS(mgr.parseSchemaBundle(objectIndex), std::runtime_error);
+
+  std::unordered_map<std::string, std::string> nestedIndex;
+  nestedIndex["device.yaml"] = R"(
+entity_name: Device
+fields:
+  location:
+    type: object
+    fields:
+      room:
+        type: string
+        unique: true
+)";
+  REQUIRE_THROWS_AS(mgr.parseSchemaBundle(nestedIndex), std::runtime_error);
+
+  std::unordered_map<std::string, std::string> badKind;
+  badKind["device.yaml"] = R"(
+entity_name: Device
+fields:
+  serial:
+    type: string
+    index: sorted
+)";
+  REQUIRE_THROWS_AS(mgr.parseSchemaBundle(badKind), std::runtime_error);
+
+  std::unordered_map<std::string, std::string> orderedString;
+  orderedString["device.yaml"] = R"(
+entity_name: Device
+fields:
+  serial:
+    type: string
+    index: ordered
+)";
+  REQUIRE_THROWS_AS(mgr.parseSchemaBundle(orderedString), std::runtime_error);
+}
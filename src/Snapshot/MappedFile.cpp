@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+#include <cstdint>
+#include <fstream>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define TOORCRAFT_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string &path)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifdef TOORCRAFT_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    file->size_ = static_cast<std::size_t>(info.st_size);
+    if (file->size_ > 0)
+    {
+        void *addr = ::mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        file->data_ = static_cast<const char *>(addr);
+        file->mapped_ = true;
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return nullptr;
+
+    file->size_ = static_cast<std::size_t>(in.tellg());
+    file->buffer_.reset(new std::uint64_t[(file->size_ + 7) / 8]);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(file->buffer_.get()), static_cast<std::streamsize>(file->size_)))
+        return nullptr;
+    file->data_ = reinterpret_cast<const char *>(file->buffer_.get());
+#endif
+
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef TOORCRAFT_HAS_MMAP
+    if (mapped_)
+        ::munmap(const_cast<char *>(data_), size_);
+#endif
+}
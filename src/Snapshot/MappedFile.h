@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only view of a whole file. Uses mmap where available so pages are
+// loaded on demand and shared with the page cache; Emscripten and Windows
+// builds read the file into an 8-byte aligned buffer instead.
+class MappedFile
+{
+public:
+    // Returns nullptr if the file cannot be opened.
+    static std::shared_ptr<const MappedFile> open(const std::string &path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    MappedFile() = default;
+
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    std::unique_ptr<std::uint64_t[]> buffer_;
+};
@@ -0,0 +1,617 @@
+#include "Snapshot.h"
+#include "MappedFile.h"
+#include "SchemaManager.h"
+#include "EntityManager.h"
+#include "EntitySchema.h"
+#include "Entity.h"
+#include "ArrayFieldSchema.h"
+#include "ObjectFieldSchema.h"
+#include "ArrayFieldValue.h"
+#include "ObjectFieldValue.h"
+#include "PrimitiveFieldValue.h"
+#include "ReferenceFieldValue.h"
+#include "FieldValueFactory.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr char Magic[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\r', '\n'};
+    constexpr std::uint32_t EndianMarker = 0x01020304;
+
+    // All records are plain 8-byte aligned structs read in place from the mapping.
+    struct StringRef
+    {
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endianMarker;
+        std::uint64_t sourceHash;
+        std::uint64_t fileSize;
+        std::uint64_t sourceCount, sourcesOffset;       // SourceRecord[]
+        std::uint64_t schemaCount, schemasOffset;       // SchemaRecord[]
+        std::uint64_t fieldNameCount, fieldNamesOffset; // StringRef[]
+        std::uint64_t entityCount, entitiesOffset;      // EntityRecord[]
+        std::uint64_t cellCount, cellsOffset;           // CellRecord[]
+        std::uint64_t stringsSize, stringsOffset;       // raw bytes
+    };
+
+    struct SourceRecord
+    {
+        StringRef fileName;
+        StringRef content;
+    };
+
+    // Slot layout the embedded sources compiled to when the snapshot was saved.
+    struct SchemaRecord
+    {
+        StringRef name;
+        std::uint64_t firstFieldName;
+        std::uint64_t fieldCount;
+    };
+
+    struct EntityRecord
+    {
+        StringRef id;
+        StringRef parentId;
+        std::uint64_t firstCell; // one cell per schema field, in FieldId order
+        std::uint32_t schemaIndex;
+        std::uint32_t state;
+    };
+
+    enum class CellKind : std::uint32_t
+    {
+        Empty,
+        Integer,
+        Float,
+        Boolean,
+        String,
+        Object, // payload[0] = first child cell, count = member count
+        Array,  // payload[0] = first child cell, count = element count
+        Text    // value of a custom field type, restored through setValueFromString
+    };
+
+    struct CellRecord
+    {
+        CellKind kind;
+        std::uint32_t count;
+        std::uint64_t payload[2];
+        StringRef name; // object members only
+    };
+
+    std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes)
+    {
+        for (unsigned char c : bytes)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    constexpr std::uint64_t FnvOffset = 14695981039346656037ULL;
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + 7) & ~std::uint64_t(7);
+    }
+
+    class SnapshotWriter
+    {
+    public:
+        StringRef addString(std::string_view text)
+        {
+            StringRef ref{strings_.size(), text.size()};
+            strings_.insert(strings_.end(), text.begin(), text.end());
+            return ref;
+        }
+
+        void addSource(const std::string &fileName, const std::string &content)
+        {
+            sources_.push_back({addString(fileName), addString(content)});
+        }
+
+        void addSchema(const EntitySchema &schema)
+        {
+            schemaIndex_[&schema] = static_cast<std::uint32_t>(schemas_.size());
+            schemas_.push_back({addString(schema.getName()), fieldNames_.size(), schema.getFieldCount()});
+            for (FieldId id = 0; id < schema.getFieldCount(); ++id)
+                fieldNames_.push_back(addString(schema.getField(id)->getName()));
+        }
+
+        void addEntity(Entity &entity)
+        {
+            const EntitySchema &schema = entity.getSchema();
+            auto schemaIt = schemaIndex_.find(&schema);
+            if (schemaIt == schemaIndex_.end())
+                throw std::runtime_error("Entity '" + entity.getId() + "' uses a schema that is not loaded");
+
+            const std::uint64_t firstCell = cells_.size();
+            cells_.resize(cells_.size() + schema.getFieldCount());
+            for (FieldId id = 0; id < schema.getFieldCount(); ++id)
+            {
+                if (const FieldCell *cell = std::as_const(entity).getFieldCell(id))
+                    encodeCell(*cell, firstCell + id);
+                else
+                    encodeValue(*entity.getFieldValue(id), firstCell + id);
+            }
+
+            entities_.push_back({addString(entity.getId()), addString(entity.getParentId()), firstCell,
+                                 schemaIt->second, static_cast<std::uint32_t>(entity.getState())});
+        }
+
+        void write(const std::string &path, std::uint64_t sourceHash) const
+        {
+            Header header{};
+            std::memcpy(header.magic, Magic, sizeof(Magic));
+            header.version = Snapshot::FormatVersion;
+            header.endianMarker = EndianMarker;
+            header.sourceHash = sourceHash;
+
+            std::uint64_t offset = alignUp(sizeof(Header));
+            auto place = [&](std::uint64_t &countField, std::uint64_t &offsetField, std::uint64_t count, std::size_t recordSize)
+            {
+                countField = count;
+                offsetField = offset;
+                offset = alignUp(offset + count * recordSize);
+            };
+            place(header.sourceCount, header.sourcesOffset, sources_.size(), sizeof(SourceRecord));
+            place(header.schemaCount, header.schemasOffset, schemas_.size(), sizeof(SchemaRecord));
+            place(header.fieldNameCount, header.fieldNamesOffset, fieldNames_.size(), sizeof(StringRef));
+            place(header.entityCount, header.entitiesOffset, entities_.size(), sizeof(EntityRecord));
+            place(header.cellCount, header.cellsOffset, cells_.size(), sizeof(CellRecord));
+            place(header.stringsSize, header.stringsOffset, strings_.size(), 1);
+            header.fileSize = offset;
+
+            const std::string tmpPath = path + ".tmp";
+            {
+                std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+                if (!out)
+                    throw std::runtime_error("Cannot write snapshot: " + tmpPath);
+
+                std::uint64_t written = 0;
+                auto emit = [&](std::uint64_t at, const void *data, std::size_t size)
+                {
+                    static const char zeros[8] = {};
+                    out.write(zeros, static_cast<std::streamsize>(at - written));
+                    out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                    written = at + size;
+                };
+                emit(0, &header, sizeof(header));
+                emit(header.sourcesOffset, sources_.data(), sources_.size() * sizeof(SourceRecord));
+                emit(header.schemasOffset, schemas_.data(), schemas_.size() * sizeof(SchemaRecord));
+                emit(header.fieldNamesOffset, fieldNames_.data(), fieldNames_.size() * sizeof(StringRef));
+                emit(header.entitiesOffset, entities_.data(), entities_.size() * sizeof(EntityRecord));
+                emit(header.cellsOffset, cells_.data(), cells_.size() * sizeof(CellRecord));
+                emit(header.stringsOffset, strings_.data(), strings_.size());
+                emit(header.fileSize, nullptr, 0);
+
+                if (!out)
+                    throw std::runtime_error("Failed writing snapshot: " + tmpPath);
+            }
+            std::filesystem::rename(tmpPath, path);
+        }
+
+    private:
+        void encodeCell(const FieldCell &cell, std::uint64_t index)
+        {
+            CellRecord record{};
+            switch (cell.getKind())
+            {
+            case FieldCell::Kind::Empty:
+                record.kind = CellKind::Empty;
+                break;
+            case FieldCell::Kind::Integer:
+            {
+                record.kind = CellKind::Integer;
+                std::int64_t value = cell.getInteger();
+                std::memcpy(&record.payload[0], &value, sizeof(value));
+                break;
+            }
+            case FieldCell::Kind::Float:
+            {
+                record.kind = CellKind::Float;
+                double value = cell.getFloat();
+                std::memcpy(&record.payload[0], &value, sizeof(value));
+                break;
+            }
+            case FieldCell::Kind::Boolean:
+                record.kind = CellKind::Boolean;
+                record.payload[0] = cell.getBoolean() ? 1 : 0;
+                break;
+            case FieldCell::Kind::String:
+            {
+                record.kind = CellKind::String;
+                StringRef ref = addString(cell.getString());
+                record.payload[0] = ref.offset;
+                record.payload[1] = ref.length;
+                break;
+            }
+            }
+            cells_[index] = record;
+        }
+
+        // Children are stored as a contiguous block after their parent, so the
+        // parent's slot is filled in by index once the block is reserved.
+        void encodeValue(const FieldValue &value, std::uint64_t index)
+        {
+            if (auto *object = dynamic_cast<const ObjectFieldValue *>(&value))
+            {
+                const auto &objSchema = static_cast<const ObjectFieldSchema &>(object->getSchema());
+                std::vector<const std::string *> members;
+                for (const auto &pair : objSchema.getFields())
+                {
+                    if (object->hasFieldValue(pair.first))
+                        members.push_back(&pair.first);
+                }
+
+                const std::uint64_t first = reserveBlock(index, CellKind::Object, members.size());
+                for (std::size_t i = 0; i < members.size(); ++i)
+                {
+                    encodeValue(*object->getFieldValue(*members[i]), first + i);
+                    cells_[first + i].name = addString(*members[i]);
+                }
+                return;
+            }
+
+            if (auto *array = dynamic_cast<const ArrayFieldValue *>(&value))
+            {
+                const auto &elements = array->getElements();
+                const std::uint64_t first = reserveBlock(index, CellKind::Array, elements.size());
+                for (std::size_t i = 0; i < elements.size(); ++i)
+                    encodeValue(*elements[i], first + i);
+                return;
+            }
+
+            if (auto *primitive = dynamic_cast<const PrimitiveFieldValue *>(&value))
+            {
+                encodeCell(primitive->getCell(), index);
+                return;
+            }
+
+            CellRecord record{};
+            record.kind = CellKind::Text;
+            StringRef ref = addString(value.toString());
+            record.payload[0] = ref.offset;
+            record.payload[1] = ref.length;
+            cells_[index] = record;
+        }
+
+        std::uint64_t reserveBlock(std::uint64_t index, CellKind kind, std::size_t count)
+        {
+            const std::uint64_t first = cells_.size();
+            cells_.resize(cells_.size() + count);
+            CellRecord record{};
+            record.kind = kind;
+            record.count = static_cast<std::uint32_t>(count);
+            record.payload[0] = first;
+            cells_[index] = record;
+            return first;
+        }
+
+        std::vector<SourceRecord> sources_;
+        std::vector<SchemaRecord> schemas_;
+        std::vector<StringRef> fieldNames_;
+        std::vector<EntityRecord> entities_;
+        std::vector<CellRecord> cells_;
+        std::vector<char> strings_;
+        std::unordered_map<const EntitySchema *, std::uint32_t> schemaIndex_;
+    };
+
+    class SnapshotReader
+    {
+    public:
+        explicit SnapshotReader(const MappedFile &file) : file_(file) {}
+
+        // Checks that the file is a snapshot this build can read; a corrupt
+        // section table is an error rather than a stale snapshot.
+        bool readHeader(std::uint64_t sourceHash)
+        {
+            if (file_.size() < sizeof(Header))
+                return false;
+            header_ = reinterpret_cast<const Header *>(file_.data());
+            if (std::memcmp(header_->magic, Magic, sizeof(Magic)) != 0 ||
+                header_->version != Snapshot::FormatVersion ||
+                header_->endianMarker != EndianMarker ||
+                header_->sourceHash != sourceHash)
+                return false;
+
+            if (header_->fileSize != file_.size())
+                throw std::runtime_error("Corrupt snapshot: size mismatch");
+            checkSection(header_->sourcesOffset, header_->sourceCount, sizeof(SourceRecord));
+            checkSection(header_->schemasOffset, header_->schemaCount, sizeof(SchemaRecord));
+            checkSection(header_->fieldNamesOffset, header_->fieldNameCount, sizeof(StringRef));
+            checkSection(header_->entitiesOffset, header_->entityCount, sizeof(EntityRecord));
+            checkSection(header_->cellsOffset, header_->cellCount, sizeof(CellRecord));
+            checkSection(header_->stringsOffset, header_->stringsSize, 1);
+            return true;
+        }
+
+        template <typename Record>
+        const Record *section(std::uint64_t offset) const
+        {
+            return reinterpret_cast<const Record *>(file_.data() + offset);
+        }
+
+        std::string_view string(const StringRef &ref) const
+        {
+            if (ref.offset > header_->stringsSize || ref.length > header_->stringsSize - ref.offset)
+                throw std::runtime_error("Corrupt snapshot: string out of range");
+            return std::string_view(file_.data() + header_->stringsOffset + ref.offset, ref.length);
+        }
+
+        const CellRecord &cell(std::uint64_t index) const
+        {
+            if (index >= header_->cellCount)
+                throw std::runtime_error("Corrupt snapshot: cell out of range");
+            return section<CellRecord>(header_->cellsOffset)[index];
+        }
+
+        const Header &header() const { return *header_; }
+
+        void restoreCell(FieldCell &cell, const CellRecord &record) const
+        {
+            switch (record.kind)
+            {
+            case CellKind::Empty:
+                cell.clear();
+                break;
+            case CellKind::Integer:
+            {
+                std::int64_t value;
+                std::memcpy(&value, &record.payload[0], sizeof(value));
+                cell.setInteger(value);
+                break;
+            }
+            case CellKind::Float:
+            {
+                double value;
+                std::memcpy(&value, &record.payload[0], sizeof(value));
+                cell.setFloat(value);
+                break;
+            }
+            case CellKind::Boolean:
+                cell.setBoolean(record.payload[0] != 0);
+                break;
+            case CellKind::String:
+                cell.borrowString(string({record.payload[0], record.payload[1]}));
+                break;
+            default:
+                throw std::runtime_error("Corrupt snapshot: composite cell stored for a primitive field");
+            }
+        }
+
+        void restoreValue(FieldValue &value, const CellRecord &record) const
+        {
+            switch (record.kind)
+            {
+            case CellKind::Object:
+            {
+                auto &object = dynamic_cast<ObjectFieldValue &>(value);
+                for (std::uint32_t i = 0; i < record.count; ++i)
+                {
+                    const CellRecord &child = cell(record.payload[0] + i);
+                    FieldValue *member = object.getFieldValue(std::string(string(child.name)));
+                    if (!member)
+                        throw std::runtime_error("Corrupt snapshot: unknown object member");
+                    restoreValue(*member, child);
+                }
+                break;
+            }
+            case CellKind::Array:
+            {
+                auto &array = dynamic_cast<ArrayFieldValue &>(value);
+                const auto &arrSchema = static_cast<const ArrayFieldSchema &>(array.getSchema());
+                const FieldSchema &elementSchema = arrSchema.getElementSchema();
+                for (std::uint32_t i = 0; i < record.count; ++i)
+                {
+                    auto element = FieldValueFactory::instance().create(elementSchema.getTypeName(), elementSchema);
+                    restoreValue(*element, cell(record.payload[0] + i));
+                    array.addElement(std::move(element));
+                }
+                break;
+            }
+            case CellKind::Text:
+                value.setValueFromString(std::string(string({record.payload[0], record.payload[1]})));
+                break;
+            default:
+                restoreCell(dynamic_cast<PrimitiveFieldValue &>(value).getCell(), record);
+                break;
+            }
+        }
+
+    private:
+        void checkSection(std::uint64_t offset, std::uint64_t count, std::size_t recordSize) const
+        {
+            if (offset % 8 != 0 || offset > file_.size() || count > (file_.size() - offset) / recordSize)
+                throw std::runtime_error("Corrupt snapshot: section out of range");
+        }
+
+        const MappedFile &file_;
+        const Header *header_ = nullptr;
+    };
+
+    // Roots in order, each followed by its subtree in child order, so that
+    // reopening rebuilds parents_ and the children lists in the same order.
+    // Entities not reachable that way (tombstones, orphans) follow by id.
+    std::vector<Entity *> saveOrder(const EntityManager &manager)
+    {
+        std::vector<Entity *> order;
+        order.reserve(manager.getEntityCount());
+        std::unordered_set<const Entity *> visited;
+        visited.reserve(manager.getEntityCount());
+
+        std::vector<Entity *> stack;
+        const auto &roots = manager.getParents();
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+            stack.push_back(*it);
+
+        while (!stack.empty())
+        {
+            Entity *entity = stack.back();
+            stack.pop_back();
+            if (!visited.insert(entity).second)
+                continue;
+            order.push_back(entity);
+
+            if (const auto *children = manager.getChildren(entity->getId()))
+            {
+                for (auto it = children->rbegin(); it != children->rend(); ++it)
+                    stack.push_back(*it);
+            }
+        }
+
+        std::vector<Entity *> rest;
+        for (Entity *entity : manager.getAllEntities())
+        {
+            if (!visited.count(entity))
+                rest.push_back(entity);
+        }
+        std::sort(rest.begin(), rest.end(), [](const Entity *a, const Entity *b)
+                  { return a->getId() < b->getId(); });
+        order.insert(order.end(), rest.begin(), rest.end());
+        return order;
+    }
+}
+
+std::uint64_t Snapshot::hashBundle(const std::unordered_map<std::string, std::string> &bundle)
+{
+    std::vector<const std::pair<const std::string, std::string> *> files;
+    files.reserve(bundle.size());
+    for (const auto &pair : bundle)
+        files.push_back(&pair);
+    std::sort(files.begin(), files.end(), [](const auto *a, const auto *b)
+              { return a->first < b->first; });
+
+    std::uint64_t hash = FnvOffset;
+    for (const auto *file : files)
+    {
+        // Lengths keep ("ab","c") and ("a","bc") apart.
+        hash = fnv1a(hash, std::to_string(file->first.size()) + ":" + file->first);
+        hash = fnv1a(hash, std::to_string(file->second.size()) + ":");
+        hash = fnv1a(hash, file->second);
+    }
+    return hash;
+}
+
+std::uint64_t Snapshot::combineHashes(std::uint64_t schemaHash, std::uint64_t dataHash)
+{
+    std::uint64_t hash = FnvOffset;
+    hash = fnv1a(hash, std::string_view(reinterpret_cast<const char *>(&schemaHash), sizeof(schemaHash)));
+    hash = fnv1a(hash, std::string_view(reinterpret_cast<const char *>(&dataHash), sizeof(dataHash)));
+    return hash;
+}
+
+void Snapshot::save(const std::string &path,
+                    const std::unordered_map<std::string, std::string> &schemaSources,
+                    std::uint64_t sourceHash)
+{
+    SnapshotWriter writer;
+
+    std::vector<const std::pair<const std::string, std::string> *> sources;
+    for (const auto &pair : schemaSources)
+        sources.push_back(&pair);
+    std::sort(sources.begin(), sources.end(), [](const auto *a, const auto *b)
+              { return a->first < b->first; });
+    for (const auto *source : sources)
+        writer.addSource(source->first, source->second);
+
+    for (const auto &schema : SchemaManager::instance().getAllEntities())
+        writer.addSchema(*schema);
+
+    const EntityManager &manager = EntityManager::instance();
+    for (Entity *entity : saveOrder(manager))
+        writer.addEntity(*entity);
+
+    writer.write(path, sourceHash);
+}
+
+bool Snapshot::isCurrent(const std::string &path, std::uint64_t sourceHash)
+{
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    return file && SnapshotReader(*file).readHeader(sourceHash);
+}
+
+bool Snapshot::open(const std::string &path, std::uint64_t sourceHash)
+{
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    if (!file)
+        return false;
+
+    SnapshotReader reader(*file);
+    if (!reader.readHeader(sourceHash))
+        return false;
+    const Header &header = reader.header();
+
+    EntityManager &manager = EntityManager::instance();
+    manager.clear();
+
+    // Cells are addressed by FieldId, so the loaded schemas must assign the
+    // same slots they had when the snapshot was written.
+    std::vector<const EntitySchema *> schemas;
+    const auto *schemaRecords = reader.section<SchemaRecord>(header.schemasOffset);
+    const auto *fieldNames = reader.section<StringRef>(header.fieldNamesOffset);
+    for (std::uint64_t i = 0; i < header.schemaCount; ++i)
+    {
+        const SchemaRecord &record = schemaRecords[i];
+        std::string name(reader.string(record.name));
+        const EntitySchema *schema = SchemaManager::instance().getEntitySchema(name);
+        bool matches = schema && schema->getFieldCount() == record.fieldCount &&
+                       record.firstFieldName + record.fieldCount <= header.fieldNameCount;
+        for (FieldId id = 0; matches && id < record.fieldCount; ++id)
+            matches = schema->getField(id)->getName() == reader.string(fieldNames[record.firstFieldName + id]);
+        if (!matches)
+            throw std::runtime_error("Snapshot schema layout does not match compiled schema '" + name + "'");
+        schemas.push_back(schema);
+    }
+
+    const auto *entityRecords = reader.section<EntityRecord>(header.entitiesOffset);
+    manager.reserve(header.entityCount);
+
+    // Entity objects and their slot vectors come from one arena sized for the
+    // whole store; string values stay in the mapping.
+    FieldArena::Scope arenaScope(manager.createArena(header.entityCount * 256 + header.cellCount * sizeof(FieldCell)));
+    std::vector<PendingReference> unchecked; // targets were valid when saved
+    ReferenceFieldValue::DeferredResolution deferred(unchecked);
+
+    for (std::uint64_t i = 0; i < header.entityCount; ++i)
+    {
+        const EntityRecord &record = entityRecords[i];
+        if (record.schemaIndex >= schemas.size())
+            throw std::runtime_error("Corrupt snapshot: schema index out of range");
+        if (record.state > static_cast<std::uint32_t>(EntityState::Deleted))
+            throw std::runtime_error("Corrupt snapshot: entity state out of range");
+        const EntitySchema &schema = *schemas[record.schemaIndex];
+
+        auto entity = std::make_unique<Entity>(schema);
+        entity->setId(std::string(reader.string(record.id)));
+        entity->setParentId(std::string(reader.string(record.parentId)));
+        entity->setState(static_cast<EntityState>(record.state));
+
+        for (FieldId id = 0; id < schema.getFieldCount(); ++id)
+        {
+            const CellRecord &cell = reader.cell(record.firstCell + id);
+            if (FieldCell *slot = entity->getFieldCell(id))
+                reader.restoreCell(*slot, cell);
+            else
+                reader.restoreValue(*entity->getFieldValue(id), cell);
+        }
+
+        manager.addEntity(std::move(entity));
+    }
+
+    manager.retainStorage(file);
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Versioned binary image of the compiled schemas and the entity store.
+//
+// The file embeds the schema sources together with the slot layout they
+// produced, and stores every entity as a fixed-size record plus one cell
+// record per field. Opening maps the file and
+// builds entities from one arena, with string values borrowed from the
+// mapping instead of copied, so no YAML is parsed and the only strings
+// allocated are the entity and parent ids.
+class Snapshot
+{
+public:
+    static constexpr std::uint32_t FormatVersion = 1;
+
+    // FNV-1a over the file names and contents of a bundle, in name order.
+    static std::uint64_t hashBundle(const std::unordered_map<std::string, std::string> &bundle);
+    static std::uint64_t combineHashes(std::uint64_t schemaHash, std::uint64_t dataHash);
+
+    // Writes the loaded schemas and entities (including their states). The
+    // file is written next to `path` and renamed into place when complete.
+    static void save(const std::string &path,
+                     const std::unordered_map<std::string, std::string> &schemaSources,
+                     std::uint64_t sourceHash);
+
+    // True if `path` is a snapshot of this format version built from the
+    // sources `sourceHash` describes.
+    static bool isCurrent(const std::string &path, std::uint64_t sourceHash);
+
+    // Replaces the loaded entities with the snapshot's contents. The schemas
+    // it was built from must already be loaded (they are covered by
+    // `sourceHash`); their slot layout is checked against the file. Returns
+    // false, without touching the store, if the snapshot is not current.
+    // Throws if the file is corrupt.
+    static bool open(const std::string &path, std::uint64_t sourceHash);
+};
@@ -0,0 +1,183 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include "Snapshot.h"
+#include "SchemaManager.h"
+#include "EntityManager.h"
+#include "EntitySchema.h"
+#include "FieldValue.h"
+#include "Entity.h"
+
+TEST_CASE("Snapshot round-trips schemas, entities and states")
+{
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["farm.yaml"] = R"(
+profile_name: Farm
+children:
+  animals:
+    entity: Animal
+fields:
+  name:
+    type: string
+  address:
+    type: object
+    fields:
+      city:
+        type: string
+      hectares:
+        type: float
+)";
+  schemas["animal.yaml"] = R"(
+entity_name: Animal
+fields:
+  name:
+    type: string
+  age:
+    type: integer
+  vaccinated:
+    type: boolean
+  kind:
+    type: enum
+    values: [cow, sheep]
+  friend:
+    type: reference
+    target: Animal
+  weights:
+    type: array
+    element:
+      type: object
+      fields:
+        day:
+          type: string
+        kg:
+          type: float
+)";
+
+  std::unordered_map<std::string, std::string> data;
+  data["farm.yaml"] = R"(
+farm1:
+  _schema: Farm
+  name: Green Acres
+  address:
+    city: Girona
+    hectares: 12.5
+)";
+  data["animals.yaml"] = R"(
+daisy:
+  _schema: Animal
+  _parentid: farm1
+  name: Daisy
+  age: 4
+  vaccinated: true
+  kind: cow
+  friend: dolly
+  weights:
+    - day: monday
+      kg: 510.5
+    - day: friday
+      kg: 512.25
+
+dolly:
+  _schema: Animal
+  _parentid: farm1
+  name: Dolly
+  age: 2
+  vaccinated: false
+  kind: sheep
+
+shaun:
+  _schema: Animal
+  _parentid: farm1
+  name: Shaun
+  age: 1
+  kind: sheep
+)";
+
+  SchemaManager::instance().parseSchemaBundle(schemas);
+  EntityManager &mgr = EntityManager::instance();
+  mgr.clear();
+  mgr.parseDataBundle(data);
+
+  mgr.setFieldValue("dolly", "name", "Dolly the Sheep");
+  mgr.getEntityById("dolly")->setState(EntityState::Modified);
+  REQUIRE(mgr.removeEntity("shaun"));
+
+  const std::uint64_t hash = Snapshot::combineHashes(Snapshot::hashBundle(schemas), Snapshot::hashBundle(data));
+  const std::string path = (std::filesystem::temp_directory_path() / "toorcraft_test.tcsnap").string();
+  Snapshot::save(path, schemas, hash);
+  mgr.clear();
+
+  SECTION("Opening restores values, hierarchy and states")
+  {
+    REQUIRE(Snapshot::open(path, hash));
+    REQUIRE(mgr.getEntityCount() == 4);
+
+    Entity *farm = mgr.getEntityById("farm1");
+    REQUIRE(farm != nullptr);
+    REQUIRE(farm->getFieldValue("name")->toString() == "Green Acres");
+    REQUIRE(farm->getFieldValue("address")->toString().find("Girona") != std::string::npos);
+    REQUIRE(mgr.getParents().size() == 1);
+
+    Entity *daisy = mgr.getEntityById("daisy");
+    REQUIRE(daisy != nullptr);
+    REQUIRE(daisy->getState() == EntityState::Unchanged);
+    REQUIRE(daisy->getFieldValue("age")->toString() == "4");
+    REQUIRE(daisy->getFieldValue("vaccinated")->toString() == "true");
+    REQUIRE(daisy->getFieldValue("kind")->toString() == "cow");
+    REQUIRE(daisy->getFieldValue("friend")->toString() == "dolly");
+    const std::string weights = daisy->getFieldValue("weights")->toString();
+    REQUIRE(weights.find("friday") != std::string::npos);
+    REQUIRE(weights.find("512.25") != std::string::npos);
+
+    Entity *dolly = mgr.getEntityById("dolly");
+    REQUIRE(dolly->getState() == EntityState::Modified);
+    REQUIRE(dolly->getFieldValue("name")->toString() == "Dolly the Sheep");
+
+    Entity *shaun = mgr.getEntityById("shaun");
+    REQUIRE(shaun != nullptr);
+    REQUIRE(shaun->getState() == EntityState::Deleted);
+
+    const auto *animals = mgr.getChildren("farm1");
+    REQUIRE(animals != nullptr);
+    REQUIRE(animals->size() == 2);
+    REQUIRE(animals->front()->getId() == "daisy");
+    REQUIRE(animals->back()->getId() == "dolly");
+
+    // Strings borrowed from the mapping become owned again when written.
+    mgr.setFieldValue("daisy", "name", "Daisy II");
+    REQUIRE(daisy->getFieldValue("name")->toString() == "Daisy II");
+  }
+
+  SECTION("A snapshot of other sources is not opened")
+  {
+    auto changed = data;
+    changed["farm.yaml"] += "\n";
+    const std::uint64_t stale = Snapshot::combineHashes(Snapshot::hashBundle(schemas), Snapshot::hashBundle(changed));
+    REQUIRE_FALSE(Snapshot::open(path, stale));
+    REQUIRE(mgr.getEntityCount() == 0);
+    REQUIRE_FALSE(Snapshot::open(path + ".missing", hash));
+  }
+
+  SECTION("A truncated snapshot is rejected as corrupt")
+  {
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    REQUIRE_THROWS(Snapshot::open(path, hash));
+  }
+
+  SECTION("An unknown entity state is rejected as corrupt")
+  {
+    // Header::entitiesOffset sits at byte 88, EntityRecord::state at byte 44.
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    std::uint64_t entitiesOffset = 0;
+    file.seekg(88);
+    file.read(reinterpret_cast<char *>(&entitiesOffset), sizeof(entitiesOffset));
+    const std::uint32_t state = 7;
+    file.seekp(static_cast<std::streamoff>(entitiesOffset + 44));
+    file.write(reinterpret_cast<const char *>(&state), sizeof(state));
+    file.close();
+    REQUIRE_THROWS_WITH(Snapshot::open(path, hash), "Corrupt snapshot: entity state out of range");
+  }
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,140 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool &ThreadPool::instance()
+{
+#ifdef __EMSCRIPTEN__
+    static ThreadPool pool(0);
+#else
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+#endif
+    return pool;
+}
+
+ThreadPool::ThreadPool(std::size_t workerCount)
+{
+    workers_.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back([this]
+                              { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    available_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    available_.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            available_.wait(lock, [this]
+                            { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &body)
+{
+    if (count == 0)
+        return;
+
+    if (workers_.empty() || count == 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+
+    // Helpers that are dequeued after the caller finished see no work left and
+    // return immediately, so the state must outlive this call.
+    struct State
+    {
+        const std::function<void(std::size_t)> *body;
+        std::size_t count;
+        std::atomic<std::size_t> next{0};
+        std::size_t finished = 0;
+        std::size_t errorIndex = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    state->body = &body;
+    state->count = count;
+
+    auto drain = [](State &s)
+    {
+        std::size_t completed = 0;
+        std::size_t i;
+        while ((i = s.next.fetch_add(1)) < s.count)
+        {
+            try
+            {
+                (*s.body)(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (!s.error || i < s.errorIndex)
+                {
+                    s.error = std::current_exception();
+                    s.errorIndex = i;
+                }
+            }
+            ++completed;
+        }
+        if (completed == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.finished += completed;
+        if (s.finished == s.count)
+            s.done.notify_all();
+    };
+
+    std::size_t helpers = std::min(workers_.size(), count - 1);
+    for (std::size_t h = 0; h < helpers; ++h)
+    {
+        post([state, drain]
+             { drain(*state); });
+    }
+
+    drain(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&]
+                     { return state->finished == state->count; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
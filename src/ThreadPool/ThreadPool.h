@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the loaders. parallelFor lets the
+// calling thread take part in the work, so it always makes progress even when
+// every worker is busy (or when called from inside another parallelFor).
+// Emscripten builds without pthreads run everything on the caller.
+class ThreadPool
+{
+public:
+    static ThreadPool &instance();
+
+    explicit ThreadPool(std::size_t workerCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t getWorkerCount() const { return workers_.size(); }
+
+    // Calls body(i) for every i in [0, count) and returns once all calls have
+    // finished. If any call throws, the exception of the lowest index is
+    // rethrown after the others have completed.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+
+private:
+    void post(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_ = false;
+};
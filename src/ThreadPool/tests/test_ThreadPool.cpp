@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+#include "ThreadPool.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("ThreadPool runs every index exactly once")
+{
+  ThreadPool pool(3);
+
+  std::vector<std::atomic<int>> hits(1000);
+  pool.parallelFor(hits.size(), [&](std::size_t i)
+                   { hits[i].fetch_add(1); });
+
+  for (const auto &hit : hits)
+  {
+    REQUIRE(hit.load() == 1);
+  }
+}
+
+TEST_CASE("ThreadPool supports nested parallelFor without deadlocking")
+{
+  ThreadPool pool(2);
+
+  std::atomic<int> total{0};
+  pool.parallelFor(8, [&](std::size_t)
+                   { pool.parallelFor(8, [&](std::size_t)
+                                      { total.fetch_add(1); }); });
+
+  REQUIRE(total.load() == 64);
+}
+
+TEST_CASE("ThreadPool rethrows the exception of the lowest failing index")
+{
+  ThreadPool pool(3);
+
+  std::atomic<int> ran{0};
+  try
+  {
+    pool.parallelFor(100, [&](std::size_t i)
+                     {
+      ran.fetch_add(1);
+      if (i == 10 || i == 70)
+        throw std::runtime_error("failed at " + std::to_string(i)); });
+    FAIL("parallelFor should have thrown");
+  }
+  catch (const std::runtime_error &ex)
+  {
+    REQUIRE(std::string(ex.what()) == "failed at 10");
+  }
+  REQUIRE(ran.load() == 100);
+}
+
+TEST_CASE("ThreadPool without workers runs on the caller")
+{
+  ThreadPool pool(0);
+  REQUIRE(pool.getWorkerCount() == 0);
+
+  std::vector<std::size_t> order;
+  pool.parallelFor(5, [&](std::size_t i)
+                   { order.push_back(i); });
+
+  REQUIRE(order == std::vector<std::size_t>{0, 1, 2, 3, 4});
+}
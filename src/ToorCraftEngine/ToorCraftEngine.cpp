@@ -2,76 +2,268 @@
 #include "SchemaManager.h"
 #include "EntityManager.h"
 #include "Entity.h"
+#include "Snapshot.h"
+#include <mutex>
+
+namespace
+{
+    struct CachedSchemas
+    {
+        std::unordered_map<std::string, std::string> sources;
+        std::weak_ptr<SchemaManager> schemas;
+    };
+
+    // Compiled schema sets by bundle hash, kept while any engine uses them.
+    std::mutex schemaCacheMutex;
+    std::unordered_multimap<std::uint64_t, CachedSchemas> schemaCache;
+
+    std::shared_ptr<SchemaManager> findCachedSchemas(const std::unordered_map<std::string, std::string> &sources,
+                                                     std::uint64_t hash)
+    {
+        auto range = schemaCache.equal_range(hash);
+        for (auto it = range.first; it != range.second;)
+        {
+            auto schemas = it->second.schemas.lock();
+            if (!schemas)
+            {
+                it = schemaCache.erase(it);
+                continue;
+            }
+            if (it->second.sources == sources)
+                return schemas;
+            ++it;
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<SchemaManager> acquireSchemas(const std::unordered_map<std::string, std::string> &sources,
+                                                  std::uint64_t hash)
+    {
+        {
+            std::lock_guard<std::mutex> lock(schemaCacheMutex);
+            if (auto schemas = findCachedSchemas(sources, hash))
+                return schemas;
+        }
+
+        // Compiled outside the lock so workspaces with different schemas
+        // load in parallel; if another engine compiled the same bundle
+        // meanwhile, its copy wins.
+        auto compiled = std::make_shared<SchemaManager>();
+        compiled->parseSchemaBundle(sources);
+
+        std::lock_guard<std::mutex> lock(schemaCacheMutex);
+        if (auto schemas = findCachedSchemas(sources, hash))
+            return schemas;
+        schemaCache.emplace(hash, CachedSchemas{sources, compiled});
+        return compiled;
+    }
+
+    template <typename Manager>
+    std::shared_ptr<Manager> unowned(Manager &manager)
+    {
+        return std::shared_ptr<Manager>(&manager, [](Manager *) {});
+    }
+}
 
 ToorCraftEngine &ToorCraftEngine::instance()
 {
-    static ToorCraftEngine inst;
+    static ToorCraftEngine inst(SchemaManager::defaultInstance(), EntityManager::defaultInstance(), LuaManager::defaultInstance());
     return inst;
 }
 
+ToorCraftEngine::ToorCraftEngine()
+    : schemas_(std::make_shared<SchemaManager>()),
+      entities_(std::make_shared<EntityManager>()),
+      lua_(std::make_shared<LuaManager>())
+{
+}
+
+ToorCraftEngine::ToorCraftEngine(SchemaManager &schemas, EntityManager &entities, LuaManager &lua)
+    : schemas_(unowned(schemas)),
+      entities_(unowned(entities)),
+      lua_(unowned(lua)),
+      sharesSchemas_(false)
+{
+}
+
+ToorCraftEngine::~ToorCraftEngine() = default;
+
+ToorCraftEngine::Scope::Scope(const ToorCraftEngine &engine)
+    : schemas_(*engine.schemas_), entities_(*engine.entities_), lua_(*engine.lua_)
+{
+}
+
+StoreLock &ToorCraftEngine::storeLock() const
+{
+    return entities_->lock();
+}
+
+void ToorCraftEngine::installSchemas(const std::unordered_map<std::string, std::string> &schemas, std::uint64_t schemaHash)
+{
+    if (sharesSchemas_)
+    {
+        entities_->clear();
+        schemas_ = acquireSchemas(schemas, schemaHash);
+    }
+    else
+    {
+        schemas_->parseSchemaBundle(schemas);
+    }
+    schemaSources_ = schemas;
+    schemaHash_ = schemaHash;
+    dataHash_ = 0;
+}
+
 void ToorCraftEngine::loadSchemas(const std::unordered_map<std::string, std::string> &schemas)
 {
-    SchemaManager::instance().parseSchemaBundle(schemas);
+    StoreLock::WriteGuard guard(storeLock());
+    installSchemas(schemas, Snapshot::hashBundle(schemas));
 }
 
 std::vector<std::string> ToorCraftEngine::getSchemaList() const
 {
-    return SchemaManager::instance().getEntitySchemaNames();
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return schemas_->getEntitySchemaNames();
 }
 
 void ToorCraftEngine::loadData(const std::unordered_map<std::string, std::string> &data)
 {
-    EntityManager::instance().parseDataBundle(data);
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    entities_->parseDataBundle(data);
+    dataHash_ = Snapshot::hashBundle(data);
 }
 
 Entity *ToorCraftEngine::queryEntity(const std::string &id) const
 {
-    return EntityManager::instance().getEntityById(id);
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->getEntityById(id);
 }
 
-void ToorCraftEngine::setField(const std::string &entityId,
-                               const std::string &fieldName,
-                               const std::string &value)
+namespace
 {
-    auto &manager = EntityManager::instance();
-
-    Entity *entity = manager.getEntityById(entityId);
-    if (!entity)
+    Entity *editableEntity(EntityManager &entities, const std::string &entityId)
     {
-        throw std::runtime_error("Entity not found: " + entityId);
+        Entity *entity = entities.getEntityById(entityId);
+        if (!entity)
+        {
+            throw std::runtime_error("Entity not found: " + entityId);
+        }
+
+        if (entity->getState() == EntityState::Deleted)
+        {
+            throw std::runtime_error("Cannot update field on a deleted entity: " + entityId);
+        }
+        return entity;
     }
 
-    if (entity->getState() == EntityState::Deleted)
+    void markModified(Entity *entity)
     {
-        throw std::runtime_error("Cannot update field on a deleted entity: " + entityId);
+        if (entity->getState() != EntityState::Added)
+        {
+            entity->setState(EntityState::Modified);
+        }
     }
 
-    manager.setFieldValue(entityId, fieldName, value);
-
-    if (entity->getState() != EntityState::Added)
+    std::unique_ptr<Entity> newEntity(const SchemaManager &schemas,
+                                      const std::string &schemaName,
+                                      const std::string &entityId,
+                                      const std::string &parentId)
     {
-        entity->setState(EntityState::Modified);
+        EntitySchema *schema = schemas.getEntitySchema(schemaName);
+        if (!schema)
+            throw std::runtime_error("Schema not found: " + schemaName);
+
+        auto entity = std::make_unique<Entity>(*schema);
+        entity->setId(entityId);
+
+        if (!parentId.empty())
+            entity->setParentId(parentId);
+        return entity;
     }
 }
 
+void ToorCraftEngine::setField(const std::string &entityId,
+                               const std::string &fieldName,
+                               const std::string &value)
+{
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    Entity *entity = editableEntity(*entities_, entityId);
+    entities_->setFieldValue(entityId, fieldName, value);
+    markModified(entity);
+}
+
+void ToorCraftEngine::setFieldJson(const std::string &entityId,
+                                   const std::string &fieldName,
+                                   const nlohmann::json &value)
+{
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    Entity *entity = editableEntity(*entities_, entityId);
+    entities_->setFieldJson(entityId, fieldName, value);
+    markModified(entity);
+}
+
 void ToorCraftEngine::validateEntity(const std::string &entityId)
 {
-    EntityManager::instance().validate(entityId);
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    entities_->validate(entityId);
 }
 
 std::vector<Entity *> ToorCraftEngine::getParents() const
 {
-    return EntityManager::instance().getParents();
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    const EntityList &parents = entities_->getParents();
+    return {parents.begin(), parents.end()};
+}
+
+std::vector<Entity *> ToorCraftEngine::query(const IEntityQuery &query) const
+{
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->query(query);
 }
 
-const std::vector<Entity *> *ToorCraftEngine::getChildren(const std::string &parentId) const
+const EntityList *ToorCraftEngine::getChildren(const std::string &parentId) const
 {
-    return EntityManager::instance().getChildren(parentId);
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->getChildren(parentId);
+}
+
+const std::vector<Entity *> *ToorCraftEngine::getEntitiesBySchema(const std::string &schemaName) const
+{
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->getEntitiesBySchema(schemaName);
+}
+
+std::vector<Entity *> ToorCraftEngine::findByField(const std::string &schemaName,
+                                                   const std::string &fieldName,
+                                                   const nlohmann::json &value) const
+{
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->findByField(schemaName, fieldName, value);
+}
+
+std::vector<EntityManager::Referrer> ToorCraftEngine::getReferrers(const std::string &targetId) const
+{
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    return entities_->getReferrers(targetId);
 }
 
 const EntitySchema *ToorCraftEngine::getSchema(const std::string &name) const
 {
-    EntitySchema *schema = SchemaManager::instance().getEntitySchema(name);
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    EntitySchema *schema = schemas_->getEntitySchema(name);
     if (!schema)
     {
         throw std::runtime_error("Schema '" + name + "' not found");
@@ -81,7 +273,9 @@ const EntitySchema *ToorCraftEngine::getSchema(const std::string &name) const
 
 std::string ToorCraftEngine::getParent(const std::string &entityId) const
 {
-    Entity *ent = EntityManager::instance().getEntityById(entityId);
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    Entity *ent = entities_->getEntityById(entityId);
     if (!ent)
         throw std::runtime_error("Entity not found: " + entityId);
 
@@ -93,21 +287,15 @@ void ToorCraftEngine::createEntity(const std::string &schemaName,
                                    const std::string &parentId,
                                    const std::unordered_map<std::string, std::string> &fieldData)
 {
-    EntitySchema *schema = SchemaManager::instance().getEntitySchema(schemaName);
-    if (!schema)
-        throw std::runtime_error("Schema not found: " + schemaName);
-
-    auto newEntity = std::make_unique<Entity>(*schema);
-    newEntity->setId(entityId);
-
-    if (!parentId.empty())
-        newEntity->setParentId(parentId);
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    auto entity = newEntity(*schemas_, schemaName, entityId, parentId);
 
     for (const auto &[fname, fval] : fieldData)
     {
         try
         {
-            newEntity->setFieldValue(fname, fval);
+            entity->setFieldValue(fname, fval);
         }
         catch (const std::exception &e)
         {
@@ -115,16 +303,45 @@ void ToorCraftEngine::createEntity(const std::string &schemaName,
         }
     }
 
-    Entity *rawPtr = newEntity.get();
-    newEntity->setState(EntityState::Added);
-    EntityManager::instance().addEntity(std::move(newEntity));
+    entity->setState(EntityState::Added);
+    entities_->addEntity(std::move(entity));
+}
+
+void ToorCraftEngine::createEntityJson(const std::string &schemaName,
+                                       const std::string &entityId,
+                                       const std::string &parentId,
+                                       const nlohmann::json &fieldData)
+{
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    if (!fieldData.is_object())
+        throw std::runtime_error("Entity fields must be a JSON object");
+
+    auto entity = newEntity(*schemas_, schemaName, entityId, parentId);
+
+    for (auto it = fieldData.begin(); it != fieldData.end(); ++it)
+    {
+        try
+        {
+            entity->setFieldJson(it.key(), it.value());
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error("Error setting field '" + it.key() + "': " + e.what());
+        }
+    }
+
+    entity->setState(EntityState::Added);
+    entities_->addEntity(std::move(entity));
 }
 
 void ToorCraftEngine::deleteEntity(const std::string &entityId)
 {
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
     try
     {
-        EntityManager &mgr = EntityManager::instance();
+        EntityManager &mgr = *entities_;
 
         Entity *entity = mgr.getEntityById(entityId);
         if (!entity)
@@ -142,3 +359,45 @@ void ToorCraftEngine::deleteEntity(const std::string &entityId)
         throw std::runtime_error(std::string("deleteEntity failed: ") + ex.what());
     }
 }
+
+std::vector<std::string> ToorCraftEngine::purgeDeleted()
+{
+    Scope scope(*this);
+    StoreLock::WriteGuard guard(storeLock());
+    std::vector<std::string> purged = entities_->takePurgedIds();
+    std::vector<std::string> now = entities_->purgeDeleted();
+    purged.insert(purged.end(), std::make_move_iterator(now.begin()), std::make_move_iterator(now.end()));
+    return purged;
+}
+
+void ToorCraftEngine::setAutoPurgeRatio(double ratio)
+{
+    StoreLock::WriteGuard guard(storeLock());
+    entities_->setAutoPurgeRatio(ratio);
+}
+
+void ToorCraftEngine::saveSnapshot(const std::string &path) const
+{
+    Scope scope(*this);
+    StoreLock::ReadGuard guard(storeLock());
+    Snapshot::save(path, schemaSources_, Snapshot::combineHashes(schemaHash_, dataHash_));
+}
+
+bool ToorCraftEngine::openSnapshot(const std::string &path,
+                                   const std::unordered_map<std::string, std::string> &schemas,
+                                   const std::unordered_map<std::string, std::string> &data)
+{
+    const std::uint64_t schemaHash = Snapshot::hashBundle(schemas);
+    const std::uint64_t dataHash = Snapshot::hashBundle(data);
+    const std::uint64_t sourceHash = Snapshot::combineHashes(schemaHash, dataHash);
+    if (!Snapshot::isCurrent(path, sourceHash))
+        return false;
+
+    StoreLock::WriteGuard guard(storeLock());
+    installSchemas(schemas, schemaHash);
+    Scope scope(*this); // after installSchemas, which may switch schema sets
+    if (!Snapshot::open(path, sourceHash))
+        return false;
+    dataHash_ = dataHash;
+    return true;
+}
@@ -1,16 +1,58 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <nlohmann/json.hpp>
+#include "EntityManager.h"
+#include "LuaManager.h"
+#include "SchemaManager.h"
+#include "StoreLock.h"
 
 class Entity;
 class EntitySchema;
 
+// One workspace: a schema set, an entity store and a Lua state.
+//
+// instance() is the process-wide engine built on the default managers (see
+// SchemaManager::instance() and friends). Engines constructed directly own
+// their store and Lua state, so several workspaces can load and serve in
+// parallel in one process; the schemas they load are compiled once per
+// distinct bundle and shared, read-only, by every engine that loads the same
+// YAML.
+//
+// Every member takes the store lock (see StoreLock), so the engine can be
+// called from several threads: queries run in parallel, changes one at a
+// time. Returned Entity pointers and child lists are only safe to read while
+// holding a StoreLock::ReadGuard on storeLock() across the call and the use.
 class ToorCraftEngine
 {
 public:
+    ToorCraftEngine();
+    ~ToorCraftEngine();
+
     static ToorCraftEngine &instance();
 
+    // Makes this engine's managers what SchemaManager::instance(),
+    // EntityManager::instance() and LuaManager::instance() return on this
+    // thread. Members do this themselves; callers need it to run code that
+    // reaches the store on its own, such as entity commands.
+    class Scope
+    {
+    public:
+        explicit Scope(const ToorCraftEngine &engine);
+
+    private:
+        SchemaManager::Scope schemas_;
+        EntityManager::Scope entities_;
+        LuaManager::Scope lua_;
+    };
+
+    StoreLock &storeLock() const;
+
+    // In an engine of its own this drops the loaded entities, which point
+    // into the schemas being replaced; instance() recompiles in place.
     void loadSchemas(const std::unordered_map<std::string, std::string> &schemas);
     std::vector<std::string> getSchemaList() const;
     const EntitySchema *getSchema(const std::string &name) const;
@@ -18,19 +60,62 @@ public:
     void loadData(const std::unordered_map<std::string, std::string> &data);
     Entity *queryEntity(const std::string &id) const;
     void setField(const std::string &entityId, const std::string &fieldName, const std::string &value);
+    // Structured variants: objects and arrays are assigned from the parsed
+    // value instead of a serialized string.
+    void setFieldJson(const std::string &entityId, const std::string &fieldName, const nlohmann::json &value);
     void validateEntity(const std::string &entityId);
 
     std::vector<Entity *> getParents() const;
-    const std::vector<Entity *> *getChildren(const std::string &parentId) const;
+    // Runs `query` (e.g. an EntityQuery) against this engine's store.
+    std::vector<Entity *> query(const IEntityQuery &query) const;
+    const EntityList *getChildren(const std::string &parentId) const;
+    const std::vector<Entity *> *getEntitiesBySchema(const std::string &schemaName) const;
+    // Lookup through the index of a field declared with `index` or `unique`.
+    std::vector<Entity *> findByField(const std::string &schemaName,
+                                      const std::string &fieldName,
+                                      const nlohmann::json &value) const;
+    // Live entities referencing `targetId`, from the store's reverse index.
+    std::vector<EntityManager::Referrer> getReferrers(const std::string &targetId) const;
     std::string getParent(const std::string &entityId) const;
     void createEntity(const std::string &schemaName,
                       const std::string &entityId,
                       const std::string &parentId,
                       const std::unordered_map<std::string, std::string> &fieldData);
+    void createEntityJson(const std::string &schemaName,
+                          const std::string &entityId,
+                          const std::string &parentId,
+                          const nlohmann::json &fieldData);
     void deleteEntity(const std::string &entityId);
+    // Frees deleted entities (see EntityManager::purgeDeleted). Returns the
+    // ids of every entity purged since the last call, including automatic
+    // purges, so none is missed by change tracking.
+    std::vector<std::string> purgeDeleted();
+    void setAutoPurgeRatio(double ratio);
+
+    // Writes the loaded state to a binary snapshot (see Snapshot.h).
+    void saveSnapshot(const std::string &path) const;
+    // Loads `schemas` and `data` from a snapshot written from exactly these
+    // sources. Returns false if the snapshot is missing or stale, in which
+    // case the caller loads the bundles normally.
+    bool openSnapshot(const std::string &path,
+                      const std::unordered_map<std::string, std::string> &schemas,
+                      const std::unordered_map<std::string, std::string> &data);
 
 private:
-    ToorCraftEngine() = default;
+    ToorCraftEngine(SchemaManager &schemas, EntityManager &entities, LuaManager &lua);
     ToorCraftEngine(const ToorCraftEngine &) = delete;
     ToorCraftEngine &operator=(const ToorCraftEngine &) = delete;
+
+    void installSchemas(const std::unordered_map<std::string, std::string> &schemas, std::uint64_t schemaHash);
+
+    // Entities point into the schemas, so schemas_ is declared first to be
+    // destroyed last.
+    std::shared_ptr<SchemaManager> schemas_;
+    std::shared_ptr<EntityManager> entities_;
+    std::shared_ptr<LuaManager> lua_;
+    bool sharesSchemas_ = true; // false for instance(), which compiles in place
+
+    std::unordered_map<std::string, std::string> schemaSources_;
+    std::uint64_t schemaHash_ = 0;
+    std::uint64_t dataHash_ = 0;
 };
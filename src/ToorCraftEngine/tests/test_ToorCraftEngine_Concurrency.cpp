@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+#include "ToorCraftEngine.h"
+#include "Entity.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ToorCraftEngine serves concurrent readers while a writer modifies the store")
+{
+  ToorCraftEngine &engine = ToorCraftEngine::instance();
+
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["counter.yaml"] = R"(
+entity_name: Counter
+fields:
+  left:
+    type: string
+  right:
+    type: string
+  count:
+    type: integer
+)";
+  engine.loadSchemas(schemas);
+
+  constexpr int entityCount = 64;
+  std::string yaml;
+  for (int i = 0; i < entityCount; ++i)
+  {
+    yaml += "c" + std::to_string(i) + ":\n  _schema: Counter\n  left: v0\n  right: v0\n  count: 0\n";
+  }
+  engine.loadData({{"counters.yaml", yaml}});
+
+  constexpr int writes = 2000;
+  std::atomic<bool> done{false};
+  std::atomic<long> reads{0};
+  std::atomic<int> tornReads{0};
+
+  // Each write changes two fields under one guard; readers must never see
+  // them differ.
+  std::thread writer([&]
+                     {
+    for (int i = 1; i <= writes; ++i)
+    {
+      const std::string id = "c" + std::to_string(i % entityCount);
+      const std::string value = "v" + std::to_string(i);
+      {
+        StoreLock::WriteGuard guard(engine.storeLock());
+        engine.setField(id, "left", value);
+        engine.setField(id, "right", value);
+      }
+      // Grow and shrink the child index while readers walk it.
+      const std::string extra = "extra" + std::to_string(i);
+      engine.createEntity("Counter", extra, id, {{"left", "x"}, {"right", "x"}});
+      engine.deleteEntity(extra);
+    }
+    done = true; });
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r)
+  {
+    readers.emplace_back([&, r]
+                         {
+      int i = r;
+      while (!done)
+      {
+        StoreLock::ReadGuard guard(engine.storeLock());
+        const std::string id = "c" + std::to_string(i++ % entityCount);
+        Entity *entity = engine.queryEntity(id);
+        if (!entity)
+        {
+          ++tornReads;
+          continue;
+        }
+        auto dict = entity->getDict();
+        if (dict["left"] != dict["right"])
+          ++tornReads;
+        if (auto *children = engine.getChildren(id))
+        {
+          for (Entity *child : *children)
+          {
+            if (child->getSchema().getName() != "Counter")
+              ++tornReads;
+          }
+        }
+        ++reads;
+      } });
+  }
+
+  writer.join();
+  for (auto &reader : readers)
+    reader.join();
+
+  REQUIRE(tornReads == 0);
+  REQUIRE(reads > 0);
+
+  for (int i = 0; i < entityCount; ++i)
+  {
+    auto dict = engine.queryEntity("c" + std::to_string(i))->getDict();
+    REQUIRE(dict["left"] == dict["right"]);
+  }
+}
+
+TEST_CASE("StoreLock guards nest on one thread")
+{
+  ToorCraftEngine &engine = ToorCraftEngine::instance();
+
+  {
+    StoreLock::WriteGuard outer(engine.storeLock());
+    StoreLock::WriteGuard inner(engine.storeLock());
+    StoreLock::ReadGuard read(engine.storeLock());
+    REQUIRE_NOTHROW(engine.getSchemaList());
+  }
+
+  {
+    StoreLock::ReadGuard read(engine.storeLock());
+    REQUIRE_THROWS_AS(StoreLock::WriteGuard(engine.storeLock()), std::runtime_error);
+  }
+
+  // Released again: another thread can write.
+  std::thread other([&]
+                    { StoreLock::WriteGuard guard(engine.storeLock()); });
+  other.join();
+}
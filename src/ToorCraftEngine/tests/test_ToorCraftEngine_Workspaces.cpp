@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+#include "ToorCraftEngine.h"
+#include "Entity.h"
+#include "FieldValue.h"
+#include <thread>
+#include <vector>
+
+namespace
+{
+  std::unordered_map<std::string, std::string> librarySchemas()
+  {
+    std::unordered_map<std::string, std::string> schemas;
+    schemas["book.yaml"] = R"(
+entity_name: Book
+fields:
+  title:
+    type: string
+  sequel:
+    type: reference
+    target: Book
+)";
+    return schemas;
+  }
+
+  std::unordered_map<std::string, std::string> libraryData(const std::string &prefix, int count)
+  {
+    std::string yaml;
+    for (int i = 0; i < count; ++i)
+    {
+      yaml += prefix + std::to_string(i) + ":\n  _schema: Book\n  title: " + prefix + " volume " + std::to_string(i) + "\n";
+      if (i > 0)
+        yaml += "  sequel: " + prefix + std::to_string(i - 1) + "\n";
+    }
+    return {{"books.yaml", yaml}};
+  }
+}
+
+TEST_CASE("ToorCraftEngine instances are independent workspaces")
+{
+  ToorCraftEngine first;
+  ToorCraftEngine second;
+
+  first.loadSchemas(librarySchemas());
+  second.loadSchemas(librarySchemas());
+  first.loadData(libraryData("a", 3));
+  second.loadData(libraryData("b", 2));
+
+  // Identical YAML compiles once.
+  REQUIRE(first.getSchema("Book") == second.getSchema("Book"));
+
+  REQUIRE(first.queryEntity("a2") != nullptr);
+  REQUIRE(first.queryEntity("b0") == nullptr);
+  REQUIRE(second.queryEntity("b1") != nullptr);
+  REQUIRE(second.queryEntity("a0") == nullptr);
+
+  // References resolve against the engine's own store.
+  REQUIRE_NOTHROW(first.setField("a0", "sequel", "a1"));
+  REQUIRE_THROWS(first.setField("a0", "sequel", "b1"));
+  REQUIRE_NOTHROW(second.createEntity("Book", "b2", "", {{"sequel", "b1"}}));
+  REQUIRE_THROWS(second.createEntity("Book", "b3", "", {{"sequel", "a1"}}));
+
+  first.deleteEntity("a1");
+  REQUIRE(first.queryEntity("a1")->isDeleted());
+  REQUIRE_FALSE(second.queryEntity("b1")->isDeleted());
+
+  // The process-wide engine is untouched.
+  REQUIRE(ToorCraftEngine::instance().queryEntity("a0") == nullptr);
+
+  // Different YAML gets its own schemas, and replacing them drops the data.
+  auto changed = librarySchemas();
+  changed["book.yaml"] += "  pages:\n    type: integer\n";
+  second.loadSchemas(changed);
+  REQUIRE(second.getSchema("Book") != first.getSchema("Book"));
+  REQUIRE(second.queryEntity("b0") == nullptr);
+  REQUIRE(first.queryEntity("a0")->getFieldValue("title")->toString() == "a volume 0");
+}
+
+TEST_CASE("ToorCraftEngine instances load in parallel")
+{
+  constexpr int workspaces = 4;
+  std::vector<std::unique_ptr<ToorCraftEngine>> engines;
+  for (int i = 0; i < workspaces; ++i)
+    engines.push_back(std::make_unique<ToorCraftEngine>());
+
+  std::vector<std::thread> loaders;
+  for (int i = 0; i < workspaces; ++i)
+  {
+    loaders.emplace_back([&, i]
+                         {
+      engines[i]->loadSchemas(librarySchemas());
+      engines[i]->loadData(libraryData("w" + std::to_string(i) + "_", 200)); });
+  }
+  for (auto &loader : loaders)
+    loader.join();
+
+  for (int i = 0; i < workspaces; ++i)
+  {
+    const std::string prefix = "w" + std::to_string(i) + "_";
+    REQUIRE(engines[i]->getParents().size() == 200);
+    REQUIRE(engines[i]->queryEntity(prefix + "199")->getFieldValue("sequel")->toString() == prefix + "198");
+    REQUIRE(engines[i]->getSchema("Book") == engines[0]->getSchema("Book"));
+  }
+}
@@ -1,16 +1,62 @@
 #include "ToorCraftJSON.h"
 #include "ToorCraftEngine.h"
 #include "Entity.h"
+#include "EntityQuery.h"
 #include "FieldValue.h"
+#include "JsonWriter.h"
+#include <functional>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-ToorCraftJSON::ToorCraftJSON() : engine_(ToorCraftEngine::instance()) {}
+namespace
+{
+    thread_local bool compactOutput = false;
+    thread_local bool errorProduced = false;
+}
+
+ToorCraftJSON::ToorCraftJSON(ToorCraftEngine &engine) : engine_(engine) {}
+
+ToorCraftJSON::CompactOutput::CompactOutput() : previous_(compactOutput)
+{
+    compactOutput = true;
+}
+
+ToorCraftJSON::CompactOutput::~CompactOutput()
+{
+    compactOutput = previous_;
+}
+
+int ToorCraftJSON::indent(int preferred)
+{
+    return compactOutput ? -1 : preferred;
+}
+
+ToorCraftJSON::ErrorCapture::ErrorCapture() : previous_(errorProduced)
+{
+    errorProduced = false;
+}
+
+ToorCraftJSON::ErrorCapture::~ErrorCapture()
+{
+    errorProduced = previous_ || errorProduced;
+}
+
+bool ToorCraftJSON::ErrorCapture::failed() const
+{
+    return errorProduced;
+}
+
+void ToorCraftJSON::setError(json &response, const std::string &message)
+{
+    response["status"] = "error";
+    response["message"] = message;
+    errorProduced = true;
+}
 
 ToorCraftJSON &ToorCraftJSON::instance()
 {
-    static ToorCraftJSON api;
+    static ToorCraftJSON api(ToorCraftEngine::instance());
     return api;
 }
 
@@ -24,8 +70,7 @@ std::string ToorCraftJSON::loadSchemas(const std::unordered_map<std::string, std
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
     }
     return result.dump();
 }
@@ -41,8 +86,7 @@ std::string ToorCraftJSON::getSchemaList()
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
     }
     return result.dump();
 }
@@ -57,8 +101,7 @@ std::string ToorCraftJSON::loadData(const std::unordered_map<std::string, std::s
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
     }
     return result.dump();
 }
@@ -68,6 +111,7 @@ std::string ToorCraftJSON::queryEntity(const std::string &id)
     json result;
     try
     {
+        StoreLock::ReadGuard guard(engine_.storeLock()); // held while the entity is serialized
         Entity *entity = engine_.queryEntity(id);
         if (!entity)
         {
@@ -75,15 +119,21 @@ std::string ToorCraftJSON::queryEntity(const std::string &id)
             return result.dump();
         }
 
-        result["status"] = "ok";
-        result["entity"] = json::parse(entity->getJson());
+        std::string out;
+        JsonWriter writer(out, indent(2));
+        writer.beginObject();
+        writer.key("entity");
+        entity->writeJson(writer);
+        writer.key("status");
+        writer.value("ok");
+        writer.endObject();
+        return out;
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
     }
-    return result.dump(2);
+    return result.dump(indent(2));
 }
 
 std::string ToorCraftJSON::setField(const std::string &entityId, const std::string &fieldName, const std::string &value)
@@ -96,8 +146,22 @@ std::string ToorCraftJSON::setField(const std::string &entityId, const std::stri
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
+    }
+    return result.dump();
+}
+
+std::string ToorCraftJSON::setFieldJson(const std::string &entityId, const std::string &fieldName, const json &value)
+{
+    json result;
+    try
+    {
+        engine_.setFieldJson(entityId, fieldName, value);
+        result["status"] = "ok";
+    }
+    catch (const std::exception &e)
+    {
+        setError(result, e.what());
     }
     return result.dump();
 }
@@ -112,8 +176,7 @@ std::string ToorCraftJSON::validateEntity(const std::string &entityId)
     }
     catch (const std::exception &e)
     {
-        result["status"] = "error";
-        result["message"] = e.what();
+        setError(result, e.what());
     }
     return result.dump();
 }
@@ -124,6 +187,7 @@ std::string ToorCraftJSON::getSchema(const std::string &schemaName)
 
     try
     {
+        StoreLock::ReadGuard guard(engine_.storeLock());
         const EntitySchema *schema = engine_.getSchema(schemaName);
         if (!schema)
         {
@@ -137,11 +201,10 @@ std::string ToorCraftJSON::getSchema(const std::string &schemaName)
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
     }
 
-    return response.dump(2);
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::getTree()
@@ -149,77 +212,46 @@ std::string ToorCraftJSON::getTree()
     json response;
     try
     {
-        auto parents = engine_.getParents();
+        StoreLock::ReadGuard guard(engine_.storeLock());
+        std::string out;
+        JsonWriter writer(out, indent(2));
 
-        json tree = json::array();
-        for (auto *parent : parents)
+        std::function<void(const Entity *)> writeNode = [&](const Entity *entity)
         {
-            json node;
-            node["id"] = parent->getId();
-            node["schema"] = parent->getSchema().getName();
-            switch (parent->getState())
+            writer.beginObject();
+            writer.key("id");
+            writer.value(entity->getId());
+            writer.key("schema");
+            writer.value(entity->getSchema().getName());
+            writer.key("state");
+            writer.value(entityStateName(entity->getState()));
+            writer.key("children");
+            writer.beginArray();
+            if (auto *kids = engine_.getChildren(entity->getId()))
             {
-            case EntityState::Added:
-                node["state"] = "Added";
-                break;
-            case EntityState::Modified:
-                node["state"] = "Modified";
-                break;
-            case EntityState::Deleted:
-                node["state"] = "Deleted";
-                break;
-            case EntityState::Unchanged:
-                node["state"] = "Unchanged";
-                break;
+                for (auto *child : *kids)
+                    writeNode(child);
             }
-
-            std::function<json(const Entity *)> collect;
-            collect = [&](const Entity *entity) -> json
-            {
-                json children = json::array();
-                auto *kids = engine_.getChildren(entity->getId());
-                if (kids)
-                {
-                    for (auto *child : *kids)
-                    {
-                        json childNode;
-                        childNode["id"] = child->getId();
-                        childNode["schema"] = child->getSchema().getName();
-                        childNode["children"] = collect(child);
-                        switch (child->getState())
-                        {
-                        case EntityState::Added:
-                            childNode["state"] = "Added";
-                            break;
-                        case EntityState::Modified:
-                            childNode["state"] = "Modified";
-                            break;
-                        case EntityState::Deleted:
-                            childNode["state"] = "Deleted";
-                            break;
-                        case EntityState::Unchanged:
-                            childNode["state"] = "Unchanged";
-                            break;
-                        }
-                        children.push_back(childNode);
-                    }
-                }
-                return children;
-            };
-
-            node["children"] = collect(parent);
-            tree.push_back(node);
-        }
-
-        response["status"] = "ok";
-        response["tree"] = tree;
+            writer.endArray();
+            writer.endObject();
+        };
+
+        writer.beginObject();
+        writer.key("status");
+        writer.value("ok");
+        writer.key("tree");
+        writer.beginArray();
+        for (auto *parent : engine_.getParents())
+            writeNode(parent);
+        writer.endArray();
+        writer.endObject();
+        return out;
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::getRoot()
@@ -227,6 +259,7 @@ std::string ToorCraftJSON::getRoot()
     json response;
     try
     {
+        StoreLock::ReadGuard guard(engine_.storeLock());
         auto parents = engine_.getParents();
         json rootArray = json::array();
 
@@ -241,10 +274,9 @@ std::string ToorCraftJSON::getRoot()
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::getChildren(const std::string &entityId)
@@ -252,6 +284,7 @@ std::string ToorCraftJSON::getChildren(const std::string &entityId)
     json response;
     try
     {
+        StoreLock::ReadGuard guard(engine_.storeLock());
         auto *children = engine_.getChildren(entityId);
 
         if (!children)
@@ -272,10 +305,157 @@ std::string ToorCraftJSON::getChildren(const std::string &entityId)
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
+}
+
+namespace
+{
+    // {"count": N, "ids": [...], "status": "ok"}, after any fields `head` writes.
+    template <typename Head>
+    std::string idListResponse(const std::vector<Entity *> *entities, Head &&head)
+    {
+        std::string out;
+        JsonWriter writer(out, ToorCraftJSON::indent(2));
+        writer.beginObject();
+        head(writer);
+        writer.key("count");
+        writer.value(static_cast<std::int64_t>(entities ? entities->size() : 0));
+        writer.key("ids");
+        writer.beginArray();
+        if (entities)
+        {
+            for (const Entity *entity : *entities)
+                writer.value(entity->getId());
+        }
+        writer.endArray();
+        writer.key("status");
+        writer.value("ok");
+        writer.endObject();
+        return out;
+    }
+}
+
+std::string ToorCraftJSON::getEntitiesBySchema(const std::string &schemaName)
+{
+    json response;
+    try
+    {
+        StoreLock::ReadGuard guard(engine_.storeLock());
+        engine_.getSchema(schemaName); // throws for unknown schemas
+        return idListResponse(engine_.getEntitiesBySchema(schemaName), [&](JsonWriter &writer)
+                              {
+            writer.key("schema");
+            writer.value(schemaName); });
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
+}
+
+std::string ToorCraftJSON::findByField(const std::string &schemaName, const std::string &fieldName, const nlohmann::json &value)
+{
+    json response;
+    try
+    {
+        StoreLock::ReadGuard guard(engine_.storeLock());
+        const auto matches = engine_.findByField(schemaName, fieldName, value);
+        return idListResponse(&matches, [](JsonWriter &) {});
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
+}
+
+std::string ToorCraftJSON::getReferrers(const std::string &entityId)
+{
+    json response;
+    try
+    {
+        StoreLock::ReadGuard guard(engine_.storeLock());
+        if (!engine_.queryEntity(entityId))
+            throw std::runtime_error("Entity not found: " + entityId);
+        const auto referrers = engine_.getReferrers(entityId);
+
+        std::string out;
+        JsonWriter writer(out, indent(2));
+        writer.beginObject();
+        writer.key("id");
+        writer.value(entityId);
+        writer.key("count");
+        writer.value(static_cast<std::int64_t>(referrers.size()));
+        writer.key("referrers");
+        writer.beginArray();
+        for (const auto &referrer : referrers)
+        {
+            writer.beginObject();
+            writer.key("id");
+            writer.value(referrer.entity->getId());
+            writer.key("field");
+            writer.value(referrer.entity->getSchema().getField(referrer.fieldId)->getName());
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.key("status");
+        writer.value("ok");
+        writer.endObject();
+        return out;
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
+}
+
+std::string ToorCraftJSON::query(const nlohmann::json &spec, const std::vector<std::string> &fields)
+{
+    json response;
+    try
+    {
+        StoreLock::ReadGuard guard(engine_.storeLock()); // held while the matches are serialized
+        auto matches = engine_.query(EntityQuery::fromJson(spec));
+
+        std::string out;
+        JsonWriter writer(out, indent(2));
+        writer.beginObject();
+        writer.key("count");
+        writer.value(static_cast<std::int64_t>(matches.size()));
+        writer.key(fields.empty() ? "ids" : "entities");
+        writer.beginArray();
+        for (const Entity *entity : matches)
+        {
+            if (fields.empty())
+            {
+                writer.value(entity->getId());
+                continue;
+            }
+            writer.beginObject();
+            writer.key("id");
+            writer.value(entity->getId());
+            for (const auto &path : fields)
+            {
+                writer.key(path);
+                EntityQuery::writeField(*entity, path, writer);
+            }
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.key("status");
+        writer.value("ok");
+        writer.endObject();
+        return out;
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::getParent(const std::string &entityId)
@@ -283,6 +463,7 @@ std::string ToorCraftJSON::getParent(const std::string &entityId)
     nlohmann::json response;
     try
     {
+        StoreLock::ReadGuard guard(engine_.storeLock());
         Entity *entity = engine_.queryEntity(entityId);
         if (!entity)
         {
@@ -311,10 +492,9 @@ std::string ToorCraftJSON::getParent(const std::string &entityId)
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::createEntity(const std::string &schemaName,
@@ -338,10 +518,35 @@ std::string ToorCraftJSON::createEntity(const std::string &schemaName,
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
+}
+
+std::string ToorCraftJSON::createEntityJson(const std::string &schemaName,
+                                            const std::string &id,
+                                            const std::string &parentId,
+                                            const json &fieldValues)
+{
+    nlohmann::json response;
+    try
+    {
+        // delegate the heavy lifting to engine_
+        engine_.createEntityJson(schemaName, id, parentId, fieldValues);
+
+        response["status"] = "ok";
+        response["created"] = {
+            {"id", id},
+            {"schema", schemaName},
+            {"parentId", parentId.empty()
+                             ? nlohmann::json(nullptr)
+                             : nlohmann::json(parentId)}};
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
 }
 
 std::string ToorCraftJSON::deleteEntity(const std::string &entityId)
@@ -354,8 +559,24 @@ std::string ToorCraftJSON::deleteEntity(const std::string &entityId)
     }
     catch (const std::exception &ex)
     {
-        response["status"] = "error";
-        response["message"] = ex.what();
+        setError(response, ex.what());
+    }
+    return response.dump(indent(2));
+}
+
+std::string ToorCraftJSON::purgeDeleted()
+{
+    nlohmann::json response;
+    try
+    {
+        const auto purged = engine_.purgeDeleted();
+        response["count"] = purged.size();
+        response["ids"] = purged;
+        response["status"] = "ok";
+    }
+    catch (const std::exception &ex)
+    {
+        setError(response, ex.what());
     }
-    return response.dump(2);
+    return response.dump(indent(2));
 }
@@ -1,14 +1,54 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
 
 class ToorCraftEngine;
 
 class ToorCraftJSON
 {
 public:
+    explicit ToorCraftJSON(ToorCraftEngine &engine);
+
+    // The API of ToorCraftEngine::instance().
     static ToorCraftJSON &instance();
 
+    // While alive, responses produced on this thread are rendered without
+    // indentation, e.g. for embedding in a batch response.
+    class CompactOutput
+    {
+    public:
+        CompactOutput();
+        ~CompactOutput();
+        CompactOutput(const CompactOutput &) = delete;
+        CompactOutput &operator=(const CompactOutput &) = delete;
+
+    private:
+        bool previous_;
+    };
+    // Indentation to render responses with: `preferred`, or -1 (compact)
+    // inside a CompactOutput scope.
+    static int indent(int preferred);
+
+    // Records whether a response with status "error" was produced on this
+    // thread while alive, so a caller can tell without reading the text.
+    class ErrorCapture
+    {
+    public:
+        ErrorCapture();
+        ~ErrorCapture();
+        ErrorCapture(const ErrorCapture &) = delete;
+        ErrorCapture &operator=(const ErrorCapture &) = delete;
+
+        bool failed() const;
+
+    private:
+        bool previous_;
+    };
+    // Fills in an error response: status "error" and `message`.
+    static void setError(nlohmann::json &response, const std::string &message);
+
     std::string loadSchemas(const std::unordered_map<std::string, std::string> &schemas);
     std::string getSchemaList();
     std::string getSchema(const std::string &schemaName);
@@ -16,21 +56,38 @@ public:
     std::string loadData(const std::unordered_map<std::string, std::string> &data);
     std::string queryEntity(const std::string &id);
     std::string setField(const std::string &entityId, const std::string &fieldName, const std::string &value);
+    std::string setFieldJson(const std::string &entityId, const std::string &fieldName, const nlohmann::json &value);
     std::string validateEntity(const std::string &entityId);
 
     std::string getTree();
     std::string getRoot();
     std::string getChildren(const std::string &entityId);
+    // Ids of the live entities of a schema, in no particular order.
+    std::string getEntitiesBySchema(const std::string &schemaName);
+    // Ids of the entities whose indexed field equals `value`.
+    std::string findByField(const std::string &schemaName, const std::string &fieldName, const nlohmann::json &value);
+    // The live entities referencing `entityId`, with the field holding each
+    // reference.
+    std::string getReferrers(const std::string &entityId);
+    // Runs an EntityQuery given in its JSON form (see EntityQuery::fromJson).
+    // Lists the matching ids, or with `fields` one object per match holding
+    // its id and the value at each path.
+    std::string query(const nlohmann::json &spec, const std::vector<std::string> &fields = {});
 
     std::string getParent(const std::string &entityId);
     std::string createEntity(const std::string &schemaName,
                              const std::string &id,
                              const std::string &parentId,
                              const std::unordered_map<std::string, std::string> &fieldValues);
+    std::string createEntityJson(const std::string &schemaName,
+                                 const std::string &id,
+                                 const std::string &parentId,
+                                 const nlohmann::json &fieldValues);
     std::string deleteEntity(const std::string &entityId);
+    // Frees deleted entities and lists the ids purged since the last call.
+    std::string purgeDeleted();
 
 private:
-    ToorCraftJSON();
     ToorCraftJSON(const ToorCraftJSON &) = delete;
     ToorCraftJSON &operator=(const ToorCraftJSON &) = delete;
 
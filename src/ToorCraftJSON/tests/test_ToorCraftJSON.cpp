@@ -350,6 +350,7 @@ fields:
   // ✅ DeviceB still exists, sibling cleared
   auto devBQuery = json::parse(api.queryEntity("deviceB"));
   REQUIRE(devBQuery["entity"]["state"] == "Added");
+  REQUIRE(devBQuery["entity"]["sibling"].is_null());
 
   // ✅ Delete Home (cascade)
   REQUIRE(json::parse(api.deleteEntity("homeRef"))["status"] == "ok");
@@ -360,3 +361,53 @@ fields:
   auto devBAfterCascade = json::parse(api.queryEntity("deviceB"));
   REQUIRE(devBAfterCascade["entity"]["state"] == "Deleted");
 }
+
+TEST_CASE("ToorCraftJSON serializes typed, escaped and nested values")
+{
+  ToorCraftJSON &api = ToorCraftJSON::instance();
+
+  std::unordered_map<std::string, std::string> schemas;
+  schemas["sensor.yaml"] = R"(
+entity_name: Sensor
+fields:
+  label: { type: string }
+  count: { type: integer }
+  scale: { type: float }
+  active: { type: boolean }
+  note: { type: string }
+  config:
+    type: object
+    fields:
+      unit: { type: string }
+      limits:
+        type: array
+        element: { type: float }
+)";
+
+  std::unordered_map<std::string, std::string> data;
+  data["sensors.yaml"] = R"(
+sensor1:
+  _schema: Sensor
+  label: "say \"hi\"\tback\\slash\nnext \u0001 café"
+  count: -9007199254740993
+  scale: 2
+  active: false
+  config:
+    unit: C
+    limits: [0.1, 1e30, -4.5]
+)";
+
+  REQUIRE(json::parse(api.loadSchemas(schemas))["status"] == "ok");
+  REQUIRE(json::parse(api.loadData(data))["status"] == "ok");
+
+  auto entity = json::parse(api.queryEntity("sensor1"))["entity"];
+  REQUIRE(entity["label"] == "say \"hi\"\tback\\slash\nnext \x01 caf\xC3\xA9");
+  REQUIRE(entity["count"] == -9007199254740993LL);
+  REQUIRE(entity["scale"].is_number_float());
+  REQUIRE(entity["scale"] == 2.0);
+  REQUIRE(entity["active"] == false);
+  REQUIRE(entity["note"].is_null());
+  REQUIRE(entity["parentId"].is_null());
+  REQUIRE(entity["config"]["unit"] == "C");
+  REQUIRE(entity["config"]["limits"] == json::array({0.1, 1e30, -4.5}));
+}
@@ -1,150 +1,319 @@
 #include "ToorCraftRouter.h"
 #include "ToorCraftJSON.h"
+#include "JsonWriter.h"
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
 ToorCraftRouter &ToorCraftRouter::instance()
 {
-    static ToorCraftRouter inst;
+    static ToorCraftRouter inst(ToorCraftJSON::instance());
     return inst;
 }
 
-std::string ToorCraftRouter::handleRequest(const std::string &jsonRequest)
+ToorCraftRouter::ToorCraftRouter(ToorCraftJSON &api) : api_(api)
+{
+    registerBuiltins();
+}
+
+void ToorCraftRouter::registerCommand(const std::string &name, std::vector<ArgSpec> args, Handler handler, bool readOnly)
 {
-    auto &api = ToorCraftJSON::instance();
-    json response;
+    commands_[name] = Command{std::move(args), std::move(handler), readOnly};
+}
+
+bool ToorCraftRouter::isReadOnly(const json &request) const
+{
+    auto commandIt = request.find("command");
+    if (!request.is_object() || commandIt == request.end() || !commandIt->is_string())
+        return true;
+
+    if (*commandIt == "batch")
+    {
+        auto requestsIt = request.find("requests");
+        if (requestsIt == request.end() || !requestsIt->is_array())
+            return true;
+        for (const json &subRequest : *requestsIt)
+        {
+            // Nested batches are rejected without running anything.
+            if (subRequest.is_object() && subRequest.contains("command") && subRequest["command"] == "batch")
+                continue;
+            if (!isReadOnly(subRequest))
+                return false;
+        }
+        return true;
+    }
+
+    auto it = commands_.find(commandIt->get_ref<const std::string &>());
+    return it == commands_.end() || it->second.readOnly;
+}
 
+std::string ToorCraftRouter::handleRequest(const std::string &jsonRequest)
+{
+    json request;
     try
     {
-        json request = json::parse(jsonRequest);
+        request = json::parse(jsonRequest);
+    }
+    catch (const std::exception &e)
+    {
+        json response;
+        ToorCraftJSON::setError(response, e.what());
+        return response.dump(ToorCraftJSON::indent(2));
+    }
+    return handleParsedRequest(request);
+}
 
-        if (!request.contains("command") || !request["command"].is_string())
+std::string ToorCraftRouter::handleParsedRequest(const json &request)
+{
+    try
+    {
+        auto commandIt = request.find("command");
+        if (!request.is_object() || commandIt == request.end() || !commandIt->is_string())
         {
             throw std::runtime_error("Missing or invalid 'command'");
         }
 
-        std::string command = request["command"];
-
-        if (command == "loadSchemas")
+        const std::string &command = commandIt->get_ref<const std::string &>();
+        auto it = commands_.find(command);
+        if (it == commands_.end())
         {
-            if (!request.contains("schemas") || !request["schemas"].is_object())
-                throw std::runtime_error("Missing or invalid 'schemas'");
+            throw std::runtime_error("Unknown command: " + command);
+        }
 
-            std::unordered_map<std::string, std::string> schemas;
-            for (auto &el : request["schemas"].items())
-                schemas[el.key()] = el.value().get<std::string>();
+        checkArgs(it->second.args, request);
+        return it->second.handler(request);
+    }
+    catch (const std::exception &e)
+    {
+        json response;
+        ToorCraftJSON::setError(response, e.what());
+        return response.dump(ToorCraftJSON::indent(2));
+    }
+}
 
-            return api.loadSchemas(schemas);
-        }
-        else if (command == "getSchemaList")
+void ToorCraftRouter::checkArgs(const std::vector<ArgSpec> &args, const json &request)
+{
+    for (const ArgSpec &arg : args)
+    {
+        auto it = request.find(arg.name);
+        // Optional arguments may also be given as null.
+        if (it == request.end() || (!arg.required && it->is_null()))
         {
-            return api.getSchemaList();
+            if (arg.required)
+                throw std::runtime_error("Missing or invalid '" + arg.name + "'");
+            continue;
         }
-        else if (command == "getSchema")
-        {
-            if (!request.contains("schema") || !request["schema"].is_string())
-                throw std::runtime_error("Missing or invalid 'schemaName'");
 
-            return api.getSchema(request["schema"].get<std::string>());
-        }
-        else if (command == "loadData")
+        bool valid = true;
+        switch (arg.type)
         {
-            if (!request.contains("data") || !request["data"].is_object())
-                throw std::runtime_error("Missing or invalid 'data'");
+        case ArgType::String:
+            valid = it->is_string();
+            break;
+        case ArgType::Boolean:
+            valid = it->is_boolean();
+            break;
+        case ArgType::Object:
+            valid = it->is_object();
+            break;
+        case ArgType::Array:
+            valid = it->is_array();
+            break;
+        case ArgType::Number:
+            valid = it->is_number();
+            break;
+        case ArgType::Any:
+            break;
+        }
+        if (!valid)
+            throw std::runtime_error("Missing or invalid '" + arg.name + "'");
+    }
+}
 
-            std::unordered_map<std::string, std::string> data;
-            for (auto &el : request["data"].items())
-                data[el.key()] = el.value().get<std::string>();
+void ToorCraftRouter::registerBuiltins()
+{
+    ToorCraftJSON &api = api_;
+    auto text = [](const json &request, const char *name) -> const std::string &
+    {
+        return request[name].get_ref<const std::string &>();
+    };
+    auto files = [](const json &bundle)
+    {
+        std::unordered_map<std::string, std::string> contents;
+        for (auto &el : bundle.items())
+            contents[el.key()] = el.value().get<std::string>();
+        return contents;
+    };
 
-            return api.loadData(data);
-        }
-        else if (command == "queryEntity")
-        {
-            if (!request.contains("id") || !request["id"].is_string())
-                throw std::runtime_error("Missing or invalid 'id'");
+    registerCommand("batch", {{"requests", ArgType::Array}, {"stopOnError", ArgType::Boolean, false}},
+                    [this](const json &request)
+                    { return handleBatch(request); });
 
-            return api.queryEntity(request["id"].get<std::string>());
-        }
-        else if (command == "setField")
-        {
-            for (auto key : {"id", "field", "value"})
-            {
-                if (!request.contains(key) || !request[key].is_string())
-                    throw std::runtime_error(std::string("Missing or invalid '") + key + "'");
-            }
-
-            return api.setField(
-                request["id"].get<std::string>(),
-                request["field"].get<std::string>(),
-                request["value"].get<std::string>());
-        }
-        else if (command == "validateEntity")
-        {
-            if (!request.contains("id") || !request["id"].is_string())
-                throw std::runtime_error("Missing or invalid 'entityId'");
+    registerCommand("loadSchemas", {{"schemas", ArgType::Object}},
+                    [&api, files](const json &request)
+                    { return api.loadSchemas(files(request["schemas"])); });
 
-            return api.validateEntity(request["id"].get<std::string>());
-        }
-        else if (command == "getTree")
-        {
-            return api.getTree();
-        }
-        else if (command == "getRoot")
-        {
-            return api.getRoot();
-        }
-        else if (command == "getChildren")
-        {
-            if (!request.contains("parentId") || !request["parentId"].is_string())
-                throw std::runtime_error("Missing or invalid 'parentId'");
+    registerCommand("getSchemaList", {},
+                    [&api](const json &)
+                    { return api.getSchemaList(); },
+                    true);
 
-            return api.getChildren(request["parentId"].get<std::string>());
-        }
-        else if (command == "createEntity")
-        {
-            if (!request.contains("schema") || !request["schema"].is_string())
-                throw std::runtime_error("Missing or invalid 'schemaName'");
-            if (!request.contains("id") || !request["id"].is_string())
-                throw std::runtime_error("Missing or invalid 'entityId'");
-            if (!request.contains("payload") || !request["payload"].is_object())
-                throw std::runtime_error("Missing or invalid 'payload'");
-
-            std::string schemaName = request["schema"].get<std::string>();
-            std::string entityId = request["id"].get<std::string>();
-            std::string parentId = request.contains("parentId") && request["parentId"].is_string()
-                                       ? request["parentId"].get<std::string>()
-                                       : "";
-
-            std::unordered_map<std::string, std::string> payload;
-            for (auto &el : request["payload"].items())
-                payload[el.key()] = el.value().dump(); // 🔑 Serialize objects/arrays as strings
-
-            return api.createEntity(schemaName, entityId, parentId, payload);
-        }
-        else if (command == "getParent")
-        {
-            if (!request.contains("id") || !request["id"].is_string())
-                throw std::runtime_error("Missing or invalid 'entityId'");
+    registerCommand("getSchema", {{"schema", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.getSchema(text(request, "schema")); },
+                    true);
 
-            return api.getParent(request["id"].get<std::string>());
-        }
-        else if (command == "deleteEntity")
-        {
-            if (!request.contains("id") || !request["id"].is_string())
-                throw std::runtime_error("Missing or invalid 'id'");
+    registerCommand("loadData", {{"data", ArgType::Object}},
+                    [&api, files](const json &request)
+                    { return api.loadData(files(request["data"])); });
 
-            return api.deleteEntity(request["id"].get<std::string>());
-        }
+    registerCommand("queryEntity", {{"id", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.queryEntity(text(request, "id")); },
+                    true);
+
+    // A string value is parsed by the field, as before values could be any
+    // JSON, so objects and arrays may still be sent JSON-encoded.
+    registerCommand("setField", {{"id", ArgType::String}, {"field", ArgType::String}, {"value", ArgType::Any}},
+                    [&api, text](const json &request)
+                    {
+                        const json &value = request["value"];
+                        if (value.is_string())
+                            return api.setField(text(request, "id"), text(request, "field"), value.get_ref<const std::string &>());
+                        return api.setFieldJson(text(request, "id"), text(request, "field"), value);
+                    });
+
+    registerCommand("validateEntity", {{"id", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.validateEntity(text(request, "id")); },
+                    true);
+
+    registerCommand("getTree", {},
+                    [&api](const json &)
+                    { return api.getTree(); },
+                    true);
+
+    registerCommand("getRoot", {},
+                    [&api](const json &)
+                    { return api.getRoot(); },
+                    true);
+
+    registerCommand("getChildren", {{"parentId", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.getChildren(text(request, "parentId")); },
+                    true);
+
+    registerCommand("getEntitiesBySchema", {{"schema", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.getEntitiesBySchema(text(request, "schema")); },
+                    true);
+
+    registerCommand("findByField", {{"schema", ArgType::String}, {"field", ArgType::String}, {"value", ArgType::Any}},
+                    [&api, text](const json &request)
+                    { return api.findByField(text(request, "schema"), text(request, "field"), request["value"]); },
+                    true);
+
+    registerCommand("getReferrers", {{"id", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.getReferrers(text(request, "id")); },
+                    true);
+
+    registerCommand("query",
+                    {{"schema", ArgType::String, false},
+                     {"where", ArgType::Array, false},
+                     {"parent", ArgType::String, false},
+                     {"ancestor", ArgType::String, false},
+                     {"orderBy", ArgType::Any, false},
+                     {"limit", ArgType::Number, false},
+                     {"includeDeleted", ArgType::Boolean, false},
+                     {"fields", ArgType::Array, false}},
+                    [&api](const json &request)
+                    {
+                        std::vector<std::string> fields;
+                        if (auto it = request.find("fields"); it != request.end() && it->is_array())
+                        {
+                            for (const auto &field : *it)
+                            {
+                                if (!field.is_string())
+                                    throw std::runtime_error("Missing or invalid 'fields'");
+                                fields.push_back(field.get<std::string>());
+                            }
+                        }
+                        return api.query(request, fields);
+                    },
+                    true);
+
+    registerCommand("createEntity",
+                    {{"schema", ArgType::String}, {"id", ArgType::String}, {"payload", ArgType::Object}, {"parentId", ArgType::Any, false}},
+                    [&api, text](const json &request)
+                    {
+                        auto parentIt = request.find("parentId");
+                        const std::string parentId = parentIt != request.end() && parentIt->is_string()
+                                                         ? parentIt->get<std::string>()
+                                                         : "";
+                        return api.createEntityJson(text(request, "schema"), text(request, "id"), parentId, request["payload"]);
+                    });
+
+    registerCommand("getParent", {{"id", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.getParent(text(request, "id")); },
+                    true);
+
+    registerCommand("deleteEntity", {{"id", ArgType::String}},
+                    [&api, text](const json &request)
+                    { return api.deleteEntity(text(request, "id")); });
+
+    registerCommand("purgeDeleted", {},
+                    [&api](const json &)
+                    { return api.purgeDeleted(); });
+}
+
+std::string ToorCraftRouter::handleBatch(const json &request)
+{
+    auto stopIt = request.find("stopOnError");
+    const bool stopOnError = stopIt != request.end() && stopIt->is_boolean() && stopIt->get<bool>();
+
+    // Sub-responses are spliced in as they are, so they are rendered compact
+    // rather than parsed back and re-serialized.
+    ToorCraftJSON::CompactOutput compact;
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("responses");
+    writer.beginArray();
+
+    const json &requests = request["requests"];
+    std::size_t failedIndex = requests.size();
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        const json &subRequest = requests[i];
+        ToorCraftJSON::ErrorCapture capture;
+        std::string subResponse;
+        bool failed = true;
+        if (subRequest.is_object() && subRequest.contains("command") && subRequest["command"] == "batch")
+            subResponse = R"({"message":"Nested batch commands are not supported","status":"error"})";
         else
         {
-            throw std::runtime_error("Unknown command: " + command);
+            subResponse = handleParsedRequest(subRequest);
+            failed = capture.failed();
+        }
+        writer.raw(subResponse);
+
+        if (stopOnError && failed)
+        {
+            failedIndex = i;
+            break;
         }
     }
-    catch (const std::exception &e)
+
+    writer.endArray();
+    if (failedIndex < requests.size())
     {
-        response["status"] = "error";
-        response["message"] = e.what();
-        return response.dump(2);
+        writer.key("failedIndex");
+        writer.value(static_cast<std::int64_t>(failedIndex));
     }
+    writer.key("status");
+    writer.value(failedIndex < requests.size() ? "error" : "ok");
+    writer.endObject();
+    return out;
 }
@@ -1,15 +1,80 @@
 #pragma once
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class ToorCraftJSON;
 
 class ToorCraftRouter
 {
 public:
+    enum class ArgType
+    {
+        String,
+        Boolean,
+        Object,
+        Array,
+        Number,
+        Any
+    };
+
+    struct ArgSpec
+    {
+        std::string name;
+        ArgType type;
+        bool required = true;
+    };
+
+    // Called with the whole request once its arguments have been checked.
+    // Failures are reported by throwing, or with ToorCraftJSON::setError,
+    // which is how batch's stopOnError tells them apart.
+    using Handler = std::function<std::string(const nlohmann::json &request)>;
+
+    // Routes to `api`, which must outlive the router.
+    explicit ToorCraftRouter(ToorCraftJSON &api);
+
+    // The router of ToorCraftJSON::instance().
     static ToorCraftRouter &instance();
 
+    // Parses one JSON request and returns the JSON response. Besides the
+    // single commands, {"command": "batch", "requests": [...]} runs each
+    // sub-request in order and answers with one compact response whose
+    // "responses" array holds the sub-responses; with "stopOnError": true it
+    // stops after the first one that fails.
     std::string handleRequest(const std::string &jsonRequest);
+    // Same as handleRequest for a request that is already parsed.
+    std::string handleParsedRequest(const nlohmann::json &request);
+
+    // True if `request` only reads engine state, so callers may run it
+    // concurrently with other read-only requests. Unknown commands and
+    // malformed requests count as read-only, since they only produce an
+    // error; a batch is read-only if all of its sub-requests are.
+    bool isReadOnly(const nlohmann::json &request) const;
+
+    // Adds or replaces a command. Before `handler` runs, required arguments
+    // must be present and every present argument must have its declared
+    // type (optional ones may be null). `readOnly` commands must not modify
+    // the engine (see isReadOnly). Commands are looked up by hash; the
+    // table is not locked, so register commands before serving requests.
+    void registerCommand(const std::string &name, std::vector<ArgSpec> args, Handler handler, bool readOnly = false);
 
 private:
-    ToorCraftRouter() = default;
+    struct Command
+    {
+        std::vector<ArgSpec> args;
+        Handler handler;
+        bool readOnly = false;
+    };
+
     ToorCraftRouter(const ToorCraftRouter &) = delete;
     ToorCraftRouter &operator=(const ToorCraftRouter &) = delete;
+
+    void registerBuiltins();
+    static void checkArgs(const std::vector<ArgSpec> &args, const nlohmann::json &request);
+    std::string handleBatch(const nlohmann::json &request);
+
+    ToorCraftJSON &api_;
+    std::unordered_map<std::string, Command> commands_;
 };
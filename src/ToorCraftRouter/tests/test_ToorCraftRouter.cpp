@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include <nlohmann/json.hpp>
 #include "ToorCraftRouter.h"
+#include <algorithm>
 
 using json = nlohmann::json;
 
@@ -197,6 +198,16 @@ fields:
   auto parentResp = json::parse(router.handleRequest(parentReq.dump()));
   REQUIRE(parentResp["status"] == "ok");
   REQUIRE(parentResp["parent"]["id"] == "homeZ");
+
+  // 5️⃣ createEntity with a taken id fails and keeps the existing entity
+  auto duplicate = json::parse(router.handleRequest(
+      R"({"command":"createEntity","schema":"Device","id":"deviceZ","parentId":"homeZ","payload":{"name":"Impostor"}})"));
+  REQUIRE(duplicate["status"] == "error");
+  REQUIRE(duplicate["message"] == "Entity already exists: deviceZ");
+  deviceQuery = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"deviceZ"})"));
+  REQUIRE(deviceQuery["entity"]["name"] == "Thermo Deluxe");
+  auto children = json::parse(router.handleRequest(R"({"command":"getChildren","parentId":"homeZ"})"));
+  REQUIRE(children["children"].size() == 1);
 }
 
 TEST_CASE("ToorCraftRouter handles deep cascade deletion and reference cleanup")
@@ -267,3 +278,347 @@ fields:
   auto devBQuery = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"deviceB"})"));
   REQUIRE(devBQuery["entity"]["state"] == "Deleted");
 }
+
+TEST_CASE("ToorCraftRouter assigns structured payloads from JSON")
+{
+  auto &router = ToorCraftRouter::instance();
+
+  json schemaReq = {
+      {"command", "loadSchemas"},
+      {"schemas", {{"station.yaml", R"(
+entity_name: Station
+fields:
+  name:
+    type: string
+  elevation:
+    type: integer
+  active:
+    type: boolean
+  twin:
+    type: reference
+    target: Station
+  location:
+    type: object
+    fields:
+      city:
+        type: string
+      lat:
+        type: float
+  readings:
+    type: array
+    element:
+      type: object
+      fields:
+        label:
+          type: string
+        value:
+          type: float
+)"}}}};
+  REQUIRE(json::parse(router.handleRequest(schemaReq.dump()))["status"] == "ok");
+
+  json createA = {
+      {"command", "createEntity"},
+      {"schema", "Station"},
+      {"id", "stationA"},
+      {"payload", {{"name", "North \"Peak\""}, {"elevation", 2450}, {"active", true}}}};
+  REQUIRE(json::parse(router.handleRequest(createA.dump()))["status"] == "ok");
+
+  json createB = {
+      {"command", "createEntity"},
+      {"schema", "Station"},
+      {"id", "stationB"},
+      {"payload",
+       {{"name", "South"},
+        {"twin", "stationA"},
+        {"location", {{"city", "Girona"}, {"lat", 41.5}}},
+        {"readings", json::array({{{"label", "a, \"b\""}, {"value", 1.25}}, {{"label", "c"}, {"value", -3}}})}}}};
+  REQUIRE(json::parse(router.handleRequest(createB.dump()))["status"] == "ok");
+
+  auto stationA = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"stationA"})"))["entity"];
+  REQUIRE(stationA["name"] == "North \"Peak\"");
+  REQUIRE(stationA["elevation"] == 2450);
+  REQUIRE(stationA["active"] == true);
+
+  auto stationB = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"stationB"})"))["entity"];
+  REQUIRE(stationB["twin"] == "stationA");
+  REQUIRE(stationB["location"]["city"] == "Girona");
+  REQUIRE(stationB["location"]["lat"] == 41.5);
+  REQUIRE(stationB["readings"].size() == 2);
+  REQUIRE(stationB["readings"][0]["label"] == "a, \"b\"");
+  REQUIRE(stationB["readings"][1]["value"] == -3.0);
+
+  // setField accepts any JSON value; null clears a primitive.
+  json setLocation = {{"command", "setField"}, {"id", "stationA"}, {"field", "location"}, {"value", {{"city", "Vic"}}}};
+  REQUIRE(json::parse(router.handleRequest(setLocation.dump()))["status"] == "ok");
+  json clearName = {{"command", "setField"}, {"id", "stationB"}, {"field", "name"}, {"value", nullptr}};
+  REQUIRE(json::parse(router.handleRequest(clearName.dump()))["status"] == "ok");
+
+  stationA = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"stationA"})"))["entity"];
+  REQUIRE(stationA["location"]["city"] == "Vic");
+  REQUIRE(stationA["state"] == "Added");
+  stationB = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"stationB"})"))["entity"];
+  REQUIRE(stationB["name"].is_null());
+
+  // Objects and arrays sent as JSON-encoded strings are still accepted.
+  json setEncoded = {{"command", "setField"}, {"id", "stationB"}, {"field", "location"}, {"value", R"({"city":"Olot","lat":42.2})"}};
+  REQUIRE(json::parse(router.handleRequest(setEncoded.dump()))["status"] == "ok");
+  json setEncodedArray = {{"command", "setField"}, {"id", "stationB"}, {"field", "readings"}, {"value", R"([{"label":"d","value":7}])"}};
+  REQUIRE(json::parse(router.handleRequest(setEncodedArray.dump()))["status"] == "ok");
+  stationB = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"stationB"})"))["entity"];
+  REQUIRE(stationB["location"]["city"] == "Olot");
+  REQUIRE(stationB["readings"] == json::parse(R"([{"label":"d","value":7.0}])"));
+
+  // Shape mismatches are reported per field.
+  json badArray = {{"command", "setField"}, {"id", "stationA"}, {"field", "readings"}, {"value", {{"label", "x"}}}};
+  auto badResp = json::parse(router.handleRequest(badArray.dump()));
+  REQUIRE(badResp["status"] == "error");
+  REQUIRE(badResp["message"].get<std::string>().find("expected a JSON array") != std::string::npos);
+}
+
+TEST_CASE("ToorCraftRouter runs batch requests in order")
+{
+  auto &router = ToorCraftRouter::instance();
+
+  json schemaReq = {
+      {"command", "loadSchemas"},
+      {"schemas", {{"lamp.yaml", R"(
+entity_name: Lamp
+fields:
+  name:
+    type: string
+  watts:
+    type: integer
+)"}}}};
+  REQUIRE(json::parse(router.handleRequest(schemaReq.dump()))["status"] == "ok");
+
+  json batch = {
+      {"command", "batch"},
+      {"requests", json::array({
+                       {{"command", "createEntity"}, {"schema", "Lamp"}, {"id", "lamp1"}, {"payload", {{"name", "Desk"}}}},
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "watts"}, {"value", 40}},
+                       {{"command", "setField"}, {"id", "ghost"}, {"field", "watts"}, {"value", 1}},
+                       {{"command", "queryEntity"}, {"id", "lamp1"}},
+                       {{"command", "batch"}, {"requests", json::array()}},
+                       "not an object",
+                   })}};
+
+  const std::string raw = router.handleRequest(batch.dump());
+  REQUIRE(raw.find('\n') == std::string::npos); // compact, including sub-responses
+
+  auto resp = json::parse(raw);
+  REQUIRE(resp["status"] == "ok");
+  REQUIRE(resp["responses"].size() == 6);
+  REQUIRE(resp["responses"][0]["status"] == "ok");
+  REQUIRE(resp["responses"][1]["status"] == "ok");
+  REQUIRE(resp["responses"][2]["status"] == "error");
+  REQUIRE(resp["responses"][3]["entity"]["watts"] == 40);
+  REQUIRE(resp["responses"][4]["status"] == "error");
+  REQUIRE(resp["responses"][5]["status"] == "error");
+
+  // stopOnError stops after the first failing request
+  json stopping = {
+      {"command", "batch"},
+      {"stopOnError", true},
+      {"requests", json::array({
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "name"}, {"value", "status"}},
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "watts"}, {"value", "bright"}},
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "name"}, {"value", "Never"}},
+                   })}};
+
+  auto stopped = json::parse(router.handleRequest(stopping.dump()));
+  REQUIRE(stopped["status"] == "error");
+  REQUIRE(stopped["failedIndex"] == 1);
+  REQUIRE(stopped["responses"].size() == 2);
+
+  auto lamp = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"lamp1"})"));
+  REQUIRE(lamp["entity"]["name"] == "status");
+
+  // Only errors stop it: not_found does not, nor a field reading "error",
+  // while the router's own errors (unknown commands) do.
+  json stoppingLater = {
+      {"command", "batch"},
+      {"stopOnError", true},
+      {"requests", json::array({
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "name"}, {"value", "error"}},
+                       {{"command", "queryEntity"}, {"id", "ghost"}},
+                       {{"command", "queryEntity"}, {"id", "lamp1"}},
+                       {{"command", "dim"}, {"id", "lamp1"}},
+                       {{"command", "setField"}, {"id", "lamp1"}, {"field", "name"}, {"value", "Never"}},
+                   })}};
+
+  stopped = json::parse(router.handleRequest(stoppingLater.dump()));
+  REQUIRE(stopped["failedIndex"] == 3);
+  REQUIRE(stopped["responses"].size() == 4);
+  REQUIRE(stopped["responses"][1]["status"] == "not_found");
+  REQUIRE(stopped["responses"][2]["entity"]["name"] == "error");
+
+  // A malformed batch is an error
+  auto malformed = json::parse(router.handleRequest(R"({"command":"batch","requests":{}})"));
+  REQUIRE(malformed["status"] == "error");
+}
+
+TEST_CASE("ToorCraftRouter dispatches registered commands with checked arguments")
+{
+  auto &router = ToorCraftRouter::instance();
+
+  router.registerCommand("echo",
+                         {{"text", ToorCraftRouter::ArgType::String}, {"loud", ToorCraftRouter::ArgType::Boolean, false}},
+                         [](const json &request)
+                         {
+                           std::string text = request["text"];
+                           if (request.contains("loud") && request["loud"] == true)
+                             text += "!";
+                           return json{{"status", "ok"}, {"echo", text}}.dump();
+                         });
+
+  auto ok = json::parse(router.handleRequest(R"({"command":"echo","text":"hi","loud":true})"));
+  REQUIRE(ok["status"] == "ok");
+  REQUIRE(ok["echo"] == "hi!");
+
+  auto nullOptional = json::parse(router.handleRequest(R"({"command":"echo","text":"hi","loud":null})"));
+  REQUIRE(nullOptional["echo"] == "hi");
+
+  auto missing = json::parse(router.handleRequest(R"({"command":"echo"})"));
+  REQUIRE(missing["status"] == "error");
+  REQUIRE(missing["message"] == "Missing or invalid 'text'");
+
+  auto wrongType = json::parse(router.handleRequest(R"({"command":"echo","text":"hi","loud":"yes"})"));
+  REQUIRE(wrongType["message"] == "Missing or invalid 'loud'");
+
+  auto unknown = json::parse(router.handleRequest(R"({"command":"shout"})"));
+  REQUIRE(unknown["message"] == "Unknown command: shout");
+
+  // Batches reach registered commands too.
+  auto batch = json::parse(router.handleRequest(R"({"command":"batch","requests":[{"command":"echo","text":"a"}]})"));
+  REQUIRE(batch["responses"][0]["echo"] == "a");
+}
+
+TEST_CASE("ToorCraftRouter classifies read-only requests")
+{
+  auto &router = ToorCraftRouter::instance();
+
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"queryEntity","id":"x"})")));
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"getTree"})")));
+  REQUIRE_FALSE(router.isReadOnly(json::parse(R"({"command":"setField","id":"x","field":"f","value":"v"})")));
+  REQUIRE_FALSE(router.isReadOnly(json::parse(R"({"command":"deleteEntity","id":"x"})")));
+
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"batch","requests":[{"command":"getRoot"},{"command":"getSchemaList"}]})")));
+  REQUIRE_FALSE(router.isReadOnly(json::parse(R"({"command":"batch","requests":[{"command":"getRoot"},{"command":"createEntity"}]})")));
+
+  router.registerCommand("peek", {}, [](const json &)
+                         { return json{{"status", "ok"}}.dump(); }, true);
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"peek"})")));
+  REQUIRE(json::parse(router.handleParsedRequest(json::parse(R"({"command":"peek"})")))["status"] == "ok");
+}
+
+TEST_CASE("ToorCraftRouter answers entity queries")
+{
+  auto &router = ToorCraftRouter::instance();
+
+  json schemaReq = {
+      {"command", "loadSchemas"},
+      {"schemas", {{"shelf.yaml", R"(
+entity_name: Shelf
+children:
+  items:
+    entity: Item
+fields:
+  label:
+    type: string
+)"},
+                   {"item.yaml", R"(
+entity_name: Item
+fields:
+  name:
+    type: string
+    unique: true
+  price:
+    type: float
+  stock:
+    type: integer
+  substitute:
+    type: reference
+    target: Item
+)"}}}};
+  REQUIRE(json::parse(router.handleRequest(schemaReq.dump()))["status"] == "ok");
+
+  json dataReq = {
+      {"command", "loadData"},
+      {"data", {{"shop.yaml", R"(
+shelfA:
+  _schema: Shelf
+  label: A
+hammer:
+  _schema: Item
+  _parentid: shelfA
+  name: Hammer
+  price: 12.5
+  stock: 3
+  substitute: saw
+nails:
+  _schema: Item
+  _parentid: shelfA
+  name: Nails
+  price: 2
+  stock: 500
+  substitute: saw
+saw:
+  _schema: Item
+  name: Saw
+  price: 30
+  stock: 0
+)"}}}};
+  REQUIRE(json::parse(router.handleRequest(dataReq.dump()))["status"] == "ok");
+
+  auto inStock = json::parse(router.handleRequest(
+      R"({"command":"query","schema":"Item","where":[{"field":"stock","op":"gt","value":0}],"orderBy":[{"field":"price","descending":true}]})"));
+  REQUIRE(inStock["status"] == "ok");
+  REQUIRE(inStock["count"] == 2);
+  REQUIRE(inStock["ids"] == json::array({"hammer", "nails"}));
+
+  auto cheapest = json::parse(router.handleRequest(
+      R"({"command":"query","parent":"shelfA","orderBy":"price","limit":1,"fields":["name","price","_parentid"]})"));
+  REQUIRE(cheapest["status"] == "ok");
+  REQUIRE(cheapest["entities"] == json::parse(R"([{"id":"nails","name":"Nails","price":2.0,"_parentid":"shelfA"}])"));
+
+  auto items = json::parse(router.handleRequest(R"({"command":"getEntitiesBySchema","schema":"Item"})"));
+  REQUIRE(items["status"] == "ok");
+  REQUIRE(items["count"] == 3);
+  std::vector<std::string> itemIds = items["ids"];
+  std::sort(itemIds.begin(), itemIds.end());
+  REQUIRE(itemIds == std::vector<std::string>{"hammer", "nails", "saw"});
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"getEntitiesBySchema","schema":"Tool"})"))["status"] == "error");
+
+  auto saw = json::parse(router.handleRequest(R"({"command":"findByField","schema":"Item","field":"name","value":"Saw"})"));
+  REQUIRE(saw["status"] == "ok");
+  REQUIRE(saw["ids"] == json::array({"saw"}));
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"findByField","schema":"Item","field":"price","value":2})"))["status"] == "error");
+  auto clash = json::parse(router.handleRequest(R"({"command":"setField","id":"hammer","field":"name","value":"Saw"})"));
+  REQUIRE(clash["status"] == "error");
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"queryEntity","id":"hammer"})"))["entity"]["name"] == "Hammer");
+
+  auto sawReferrers = json::parse(router.handleRequest(R"({"command":"getReferrers","id":"saw"})"));
+  REQUIRE(sawReferrers["status"] == "ok");
+  REQUIRE(sawReferrers["referrers"] == json::parse(R"([{"id":"hammer","field":"substitute"},{"id":"nails","field":"substitute"}])"));
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"getReferrers","id":"saw"})")));
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"getReferrers","id":"drill"})"))["status"] == "error");
+
+  REQUIRE(router.isReadOnly(json::parse(R"({"command":"query"})")));
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"query","limit":"two"})"))["status"] == "error");
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"query","schema":"Item","where":[{"field":"colour","value":"red"}]})"))["status"] == "error");
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"query","fields":[1]})"))["status"] == "error");
+
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"deleteEntity","id":"saw"})"))["status"] == "ok");
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"getReferrers","id":"saw"})"))["count"] == 0);
+  auto hammer = json::parse(router.handleRequest(R"({"command":"queryEntity","id":"hammer"})"));
+  REQUIRE(hammer["entity"]["substitute"].is_null());
+  REQUIRE(hammer["entity"]["state"] == "Modified");
+
+  REQUIRE_FALSE(router.isReadOnly(json::parse(R"({"command":"purgeDeleted"})")));
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"deleteEntity","id":"shelfA"})"))["status"] == "ok");
+  auto purged = json::parse(router.handleRequest(R"({"command":"purgeDeleted"})"));
+  REQUIRE(purged["status"] == "ok");
+  REQUIRE(purged["ids"] == json::array({"hammer", "nails", "saw", "shelfA"}));
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"queryEntity","id":"saw"})"))["status"] == "not_found");
+  REQUIRE(json::parse(router.handleRequest(R"({"command":"purgeDeleted"})"))["count"] == 0);
+}